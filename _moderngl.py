@@ -37,6 +37,7 @@ class Uniform:
         self.name = None
         self.matrix = None
         self.ctx = None
+        self.program = None
         self.extra = None
 
     def __repr__(self):
@@ -92,8 +93,8 @@ class Uniform:
         )
 
     def write(self, data: Any):
-        self.ctx._write_uniform(
-            self.program_obj, self.location, self.gl_type, self.array_length, self.element_size, data,
+        return self.ctx._write_uniform(
+            self.program_obj, self.location, self.gl_type, self.array_length, self.element_size, data, self.program,
         )
 
 
@@ -384,7 +385,7 @@ def make_attribute(name, gl_type, program_obj, location, array_length):
     return res
 
 
-def make_uniform(name, gl_type, program_obj, location, array_length, ctx):
+def make_uniform(name, gl_type, program_obj, location, array_length, ctx, program):
     tmp = UNIFORM_LOOKUP_TABLE.get(gl_type, (False, 1, 4, "1i"))
     matrix, dimension, element_size, fmt = tmp
     res = Uniform()
@@ -398,6 +399,7 @@ def make_uniform(name, gl_type, program_obj, location, array_length, ctx):
     res.dimension = dimension
     res.element_size = element_size
     res.ctx = ctx
+    res.program = program
     return res
 
 
@@ -443,6 +445,7 @@ class Spv:
     UINT64 = 1 << 3
     FLOAT32 = 1 << 4
     FLOAT64 = 1 << 5
+    BOOL = 1 << 6
 
     VEC2 = 1 << 10
     VEC3 = 1 << 11
@@ -678,19 +681,100 @@ def parse_spv_inputs(program: int, spv: bytes) -> Dict[int, Attribute]:
     }
 
 
-class InvalidObject:
-    pass
+def parse_spv_specialization_constants(spv: bytes) -> Dict[int, Tuple[str, int, Any]]:
+    ui32 = struct.Struct("I")
+    token = lambda i: ui32.unpack(spv[i * 4 : i * 4 + 4])[0]
+    num_tokens = len(spv) // 4
 
+    if token(0) != 0x07230203 or len(spv) % 4 != 0:
+        raise ValueError("invalid spv")
 
-def resolve_includes(ctx, source):
-    def include(match):
-        name = match.group(1)
-        content = ctx.includes.get(name)
-        if content is None:
-            raise KeyError(f'cannot include "{name}"')
-        return content
+    idx = 5
+
+    extracted_names: Dict[int, str] = {}  # id : name
+    extracted_spec_ids: Dict[int, int] = {}  # id : constant_id
+    extracted_types: Dict[int, Tuple[int, int]] = {}  # type_id : (spv_type, byte_size)
+    extracted_constants: Dict[int, Tuple[int, Any]] = {}  # id : (type_id, default)
+
+    while idx < num_tokens:
+        args, opcode = token(idx) >> 16, token(idx) & 0xFFFF
+        if opcode == 5:  # OpName
+            name_start, name_end = (idx + 2) * 4, (idx + args) * 4
+            extracted_names[token(idx + 1)] = spv[name_start:name_end].rstrip(b"\x00").decode()
+
+        if opcode == 71 and token(idx + 2) == 1:  # OpDecorate SpecId
+            extracted_spec_ids[token(idx + 1)] = token(idx + 3)
+
+        if opcode == 20:  # OpTypeBool
+            extracted_types[token(idx + 1)] = (Spv.BOOL, 4)
+
+        if opcode == 21:  # OpTypeInt
+            bsz = token(idx + 2) // 8
+            if token(idx + 3) == 1:
+                extracted_types[token(idx + 1)] = (Spv.INT32 if bsz == 4 else Spv.INT64, bsz)
+            else:
+                extracted_types[token(idx + 1)] = (Spv.UINT32 if bsz == 4 else Spv.UINT64, bsz)
+
+        if opcode == 22:  # OpTypeFloat
+            bsz = token(idx + 2) // 8
+            extracted_types[token(idx + 1)] = (Spv.FLOAT32 if bsz == 4 else Spv.FLOAT64, bsz)
 
-    import re
+        if opcode in (48, 49):  # OpSpecConstantTrue, OpSpecConstantFalse
+            extracted_constants[token(idx + 2)] = (token(idx + 1), opcode == 48)
 
-    source = re.sub(r'#include\s+"([^"]+)"', include, source)
-    return source
+        if opcode == 50:  # OpSpecConstant
+            content_start, content_end = (idx + 3) * 4, (idx + args) * 4
+            extracted_constants[token(idx + 2)] = (token(idx + 1), spv[content_start:content_end])
+
+        idx += args
+
+    SPEC_CONSTANT_FORMAT = {
+        Spv.INT32: "i",
+        Spv.INT64: "q",
+        Spv.UINT32: "I",
+        Spv.UINT64: "Q",
+        Spv.FLOAT32: "f",
+        Spv.FLOAT64: "d",
+    }
+
+    # Only the constants decorated with a SpecId can be specialized
+    result: Dict[int, Tuple[str, int, Any]] = {}
+    for ids, constant_id in extracted_spec_ids.items():
+        if ids not in extracted_constants:
+            continue
+
+        type_id, default = extracted_constants[ids]
+        typ, bsz = extracted_types.get(type_id, (Spv.UNKNOWN, 4))
+        if typ in SPEC_CONSTANT_FORMAT:
+            default = struct.unpack(SPEC_CONSTANT_FORMAT[typ], default[:bsz])[0]
+
+        result[constant_id] = (extracted_names.get(ids, ""), typ, default)
+
+    return result
+
+
+def pack_spv_specialization_constants(constants: Dict[int, Tuple[str, int, Any]], values: Dict[int, Any]) -> Tuple[Tuple[int, int], ...]:
+    result = []
+    for constant_id, value in values.items():
+        if constant_id not in constants:
+            continue
+
+        typ = constants[constant_id][1]
+        if typ == Spv.BOOL:
+            bits = 1 if value else 0
+        elif typ == Spv.INT32:
+            bits = struct.unpack("I", struct.pack("i", value))[0]
+        elif typ == Spv.UINT32:
+            bits = struct.unpack("I", struct.pack("I", value))[0]
+        elif typ == Spv.FLOAT32:
+            bits = struct.unpack("I", struct.pack("f", value))[0]
+        else:
+            raise ValueError(f"specialization constant {constant_id} is not a 32-bit scalar")
+
+        result.append((constant_id, bits))
+
+    return tuple(sorted(result))
+
+
+class InvalidObject:
+    pass
@@ -1,6 +1,6 @@
 from __future__ import annotations
 
-from typing import Any, Deque, Dict, Generator, List, Optional, Protocol, Set, Tuple, Union
+from typing import Any, Callable, Deque, Dict, Generator, List, MutableMapping, Optional, Protocol, Set, Tuple, Union
 
 class ConvertibleToShaderSource(Protocol):
     def to_shader_source(self) -> str | bytes: ...
@@ -1055,6 +1055,22 @@ class Context:
         Returns:
             int: Number of objects deleted
         """
+    def clear_shader_cache(self) -> None:
+        """
+        Deletes the cached shader objects and resets :py:attr:`shader_cache_stats`.
+
+        Linked programs are not affected.
+        """
+    def reload_programs(self) -> int:
+        """
+        Recompiles the programs that include a changed entry of :py:attr:`includes`.
+
+        The new OpenGL program replaces the old one in place, so vertex arrays keep working.
+        Members fetched before the reload are updated to point at the new program.
+
+        Returns:
+            int: Number of programs reloaded
+        """
     line_width: float
     """
     Set the default line width.
@@ -1510,8 +1526,28 @@ class Context:
         }
     """
 
-    includes: Dict[str, str]
-    """Mapping used for include statements."""
+    includes: MutableMapping[str, str]
+    """
+    Mapping used for include statements.
+
+    Lines of the form ``#include "name"`` are replaced with the named source.
+    Includes can be nested and every name is included at most once per shader.
+    Changing an entry marks every program that included it as stale.
+    """
+
+    shader_cache_stats: Dict[str, int]
+    """
+    The ``size``, ``hits`` and ``misses`` of the shader object cache.
+
+    Shader objects compiled from GLSL sources are cached by stage and final source.
+    A cached shader object is deleted when the last program using it is released.
+    """
+
+    stale_programs: Tuple[Union["Program", "ComputeShader"], ...]
+    """The programs waiting for :py:meth:`reload_programs`."""
+
+    auto_reload: bool
+    """Reload the stale programs as soon as :py:attr:`includes` changes."""
 
     mglo: Any
     """Internal representation for debug purposes only."""
@@ -1654,6 +1690,22 @@ class Context:
         """
     def finish(self) -> None:
         """Wait for all drawing commands to finish."""
+    def reset_framebuffer_state(self) -> None:
+        """
+        Forget the framebuffer state applied to the OpenGL context.
+
+        The context remembers the bound framebuffer, viewport, scissor and masks
+        and only changes what differs when a framebuffer is used or cleared.
+        Using the screen or a detected framebuffer always applies its full state.
+        Call this after changing any of them with raw OpenGL calls or another library,
+        the next use or render applies the full framebuffer state again.
+
+        Example::
+
+            imgui_renderer.render(imgui.get_draw_data())
+            ctx.reset_framebuffer_state()
+            offscreen.use()
+        """
     def copy_buffer(
         self,
         dst: Buffer,
@@ -1685,10 +1737,88 @@ class Context:
             - downsample framebuffers. (it will allow to read the framebuffer's content)
             - downsample a framebuffer directly to a texture.
 
+        The copy ignores the scissor, the scissor test stays disabled until
+        a framebuffer with a scissor is used or rendered to.
+
         Args:
             dst (Framebuffer or Texture): Destination framebuffer or texture.
             src (Framebuffer): Source framebuffer.
         """
+    def resolve(
+        self,
+        dst: Framebuffer,
+        src: Framebuffer,
+        attachments: Union[str, Tuple[int, ...]] = "all",
+        depth: bool = True,
+        filter: str = "nearest",
+    ) -> None:
+        """
+        Resolve or blit the attachments of a framebuffer into another one.
+
+        Every color attachment is blitted into the color attachment with the same index,
+        the depth is blitted together with the first one. Multisample framebuffers
+        can only be resolved into framebuffers of the same size, other framebuffers are scaled.
+        The scissor of the framebuffers does not apply.
+
+        Args:
+            dst (Framebuffer): Destination framebuffer.
+            src (Framebuffer): Source framebuffer.
+
+        Keyword Args:
+            attachments (tuple): Color attachment indices or ``'all'``.
+            depth (bool): Blit the depth attachment as well.
+            filter (str): ``'nearest'`` or ``'linear'``, the depth is always blitted with ``'nearest'``.
+
+        Example::
+
+            # resolve a multisample G-buffer
+            ctx.resolve(gbuffer, gbuffer_msaa)
+        """
+    def render_tiled(
+        self,
+        size: Tuple[int, int],
+        render_fn: Callable[[Framebuffer, Tuple[int, int, int, int], Tuple[float, ...]], Any],
+        out: Any,
+        tile: Tuple[int, int] = (4096, 4096),
+        components: int = 3,
+        dtype: str = "f1",
+        buffers: int = 3,
+    ) -> None:
+        """
+        Render an image larger than a framebuffer can be in tiles.
+
+        One tile sized framebuffer is reused for every tile, the tile size is limited by
+        ``GL_MAX_RENDERBUFFER_SIZE`` and ``GL_MAX_VIEWPORT_DIMS``.
+        For every tile ``render_fn(framebuffer, viewport, matrix)`` is called with the tile framebuffer bound.
+        The ``viewport`` is the ``(x, y, width, height)`` of the tile in the image.
+        The ``matrix`` is a column major 4x4 matrix mapping the clip space of the whole image
+        to the clip space of the tile, it should be applied after the projection.
+
+        Tiles are read back with :py:meth:`Framebuffer.read_async` and copied into their place
+        in ``out`` as soon as they are ready, so only a few tiles are held in memory.
+        The output has the layout of :py:meth:`Framebuffer.read` with an alignment of 1, the bottom row first.
+
+        Args:
+            size (tuple): The width and height of the image.
+            render_fn (callable): Renders a tile.
+            out: A writable buffer such as a ``numpy.memmap`` or a seekable file object.
+
+        Keyword Args:
+            tile (tuple): The maximum width and height of a tile.
+            components (int): The number of components to read.
+            dtype (str): Data type.
+            buffers (int): The number of tiles read back at the same time.
+
+        Example::
+
+            def render(fbo, viewport, matrix):
+                fbo.clear()
+                program['tile'].write(struct.pack('16f', *matrix))
+                vao.render()
+
+            image = np.memmap('render.raw', dtype='u1', mode='w+', shape=(30000, 30000, 3))
+            ctx.render_tiled((30000, 30000), render, image)
+        """
     def detect_framebuffer(self, glo: Optional[int] = None) -> Framebuffer:
         """
         Detect a framebuffer.
@@ -1935,7 +2065,7 @@ class Context:
         This method also supports arguments for :py:meth:`Context.simple_vertex_array`.
 
         Args:
-            program (Program): The program used when rendering
+            program (Program): The program or :py:class:`ProgramPipeline` used when rendering
             content (list): A list of (buffer, format, attributes).
                             See :ref:`buffer-format-label`.
 
@@ -2003,6 +2133,19 @@ class Context:
         Returns:
             :py:class:`VertexArray` object
         """
+    def vertex_format(self, fmt: str) -> "VertexFormat":
+        """
+        Parse a buffer format once and return the interned :py:class:`VertexFormat`.
+
+        Calling this again with the same string returns the same object.
+        See :ref:`buffer-format-label`.
+
+        Args:
+            fmt (str): The buffer format.
+
+        Returns:
+            :py:class:`VertexFormat` object
+        """
     def program(
         self,
         vertex_shader: str | bytes | ConvertibleToShaderSource,
@@ -2013,6 +2156,7 @@ class Context:
         varyings: Tuple[str, ...] = (),
         fragment_outputs: Optional[Dict[str, int]] = None,
         varyings_capture_mode: str = "interleaved",
+        specialization: Optional[Dict[int, Union[bool, int, float]]] = None,
     ) -> Program:
         """
         Create a :py:class:`Program` object.
@@ -2024,6 +2168,12 @@ class Context:
         shader outputs to a framebuffer attachment numbers. This can also be done
         by using ``layout(location=N)`` in the fragment shader.
 
+        ``specialization`` maps SPIR-V specialization constant ids (``layout(constant_id=N)``)
+        to their values. Values are converted to the type declared in the shader.
+        Programs created with the same sources and constant values are cached and reused:
+        every caller gets the same :py:class:`Program` object, so uniform values and
+        :py:meth:`Program.release` affect all of them.
+
         Args:
             vertex_shader (str): The vertex shader source.
             fragment_shader (str): The fragment shader source.
@@ -2032,9 +2182,74 @@ class Context:
             tess_evaluation_shader (str): The tessellation evaluation shader source.
             varyings (list): A list of varyings.
             fragment_outputs (dict): A dictionary of fragment outputs.
+            specialization (dict): SPIR-V specialization constant values by constant id.
+        Returns:
+            :py:class:`Program` object
+        """
+    def shader_stage(
+        self,
+        kind: str,
+        source: str | bytes | ConvertibleToShaderSource,
+        specialization: Optional[Dict[int, Union[bool, int, float]]] = None,
+    ) -> Program:
+        """
+        Create a separable :py:class:`Program` containing a single shader stage.
+
+        Shader stages are combined with :py:meth:`Context.pipeline` without relinking.
+        Their uniforms are set the same way as for regular programs.
+
+        Args:
+            kind (str): ``vertex``, ``fragment``, ``geometry``, ``tess_control`` or ``tess_evaluation``.
+            source (str): The shader source.
+            specialization (dict): SPIR-V specialization constant values by constant id.
         Returns:
             :py:class:`Program` object
         """
+    def pipeline(self, *stages: Program) -> "ProgramPipeline":
+        """
+        Create a :py:class:`ProgramPipeline` object from shader stages.
+
+        The stages must be created with :py:meth:`Context.shader_stage`
+        and there must be at most one stage of each kind.
+        The pipeline keeps its stages alive until it is released.
+
+        Args:
+            stages (Program): The shader stages.
+        Returns:
+            :py:class:`ProgramPipeline` object
+        """
+    def program_family(
+        self,
+        sources: Dict[str, str],
+        defines_schema: Optional[Dict[str, Any]] = None,
+        varyings: Tuple[str, ...] = (),
+        fragment_outputs: Optional[Dict[str, int]] = None,
+        attributes: Optional[Tuple[str, ...]] = None,
+        varyings_capture_mode: str = "interleaved",
+        cache_size: Optional[int] = 64,
+    ) -> "ProgramFamily":
+        """
+        Create a :py:class:`ProgramFamily` object.
+
+        A program family compiles variants of the same shader sources
+        differing only by ``#define`` values. Variants are compiled on first use.
+
+        Each entry of ``defines_schema`` maps a define name to its allowed values.
+        The first allowed value is the default. A single value is used as the default
+        and accepts any value. ``True`` is defined as ``1`` and ``False`` or ``None``
+        leave the name undefined.
+
+        Args:
+            sources (dict): The shader sources keyed by stage name (``vertex_shader``, ``fragment_shader``, ...).
+            defines_schema (dict): The allowed values for each define.
+            varyings (list): A list of varyings.
+            fragment_outputs (dict): A dictionary of fragment outputs.
+            attributes (list): Attribute names by location.
+            varyings_capture_mode (str): ``interleaved`` or ``separate``.
+            cache_size (int): The number of variants to keep. ``None`` keeps all variants.
+        Returns:
+            :py:class:`ProgramFamily` object
+        """
     def query(
         self,
         samples: bool = False,
@@ -2051,6 +2266,87 @@ class Context:
             time (bool): Query ``GL_TIME_ELAPSED`` or not.
             primitives (bool): Query ``GL_PRIMITIVES_GENERATED`` or not.
         """
+    def transform_feedback(self, buffers: List[Any], streams: int = 1) -> "TransformFeedback":
+        """
+        Create a :py:class:`TransformFeedback` object owning its output bindings.
+
+        Items are buffers or ``(buffer, offset)`` or ``(buffer, offset, size)`` tuples.
+        Offsets must be a multiple of 4. Requires OpenGL 4.0.
+
+        Args:
+            buffers (list): The output buffers.
+
+        Keyword Args:
+            streams (int): The number of vertex streams written by the geometry shader, up to 4.
+
+        Returns:
+            :py:class:`TransformFeedback` object
+        """
+    def mesh_pool(
+        self,
+        program: Program,
+        fmt: str,
+        attributes: Union[str, List[str]],
+        vertices: int = 4096,
+        indices: int = 16384,
+        index_element_size: int = 4,
+        content: Any = (),
+        mode: Optional[int] = None,
+    ) -> "MeshPool":
+        """
+        Create a :py:class:`MeshPool` packing meshes of the same format into shared buffers.
+
+        Args:
+            program (Program): The program used by the vertex array.
+            fmt (str): The buffer format of the meshes.
+            attributes (list): The attributes reading the meshes.
+
+        Keyword Args:
+            vertices (int): The initial vertex capacity.
+            indices (int): The initial index capacity.
+            index_element_size (int): byte size of each index: 1, 2 or 4.
+            content (list): Extra vertex array content such as per instance data.
+            mode (int): The default primitive type.
+
+        Returns:
+            :py:class:`MeshPool` object
+        """
+    def feedback_loop(
+        self,
+        program: Program,
+        buffers: Tuple[Buffer, Buffer],
+        fmt: str,
+        attributes: Union[str, List[str]],
+        mode: Optional[int] = None,
+        vertices: int = -1,
+        content: Any = (),
+    ) -> "FeedbackLoop":
+        """
+        Create a :py:class:`FeedbackLoop` stepping a transform program between two buffers.
+
+        Args:
+            program (Program): The transform program, its varyings must match ``fmt``.
+            buffers (tuple): The two buffers, the first one holds the initial state.
+            fmt (str): The buffer format of the state.
+            attributes (list): The attributes reading the state.
+
+        Keyword Args:
+            mode (int): The primitive type, POINTS by default.
+            vertices (int): The number of vertices in the initial state.
+            content (list): Extra vertex array content shared by both directions.
+
+        Returns:
+            :py:class:`FeedbackLoop` object
+        """
+    def record(self) -> "CommandList":
+        """
+        Create a :py:class:`CommandList` recording the following rendering calls.
+
+        Recording stops when the ``with`` block is left or :py:meth:`CommandList.end` is called.
+
+        Returns:
+            :py:class:`CommandList` object
+        """
     def scope(
         self,
         framebuffer: Optional[Framebuffer] = None,
@@ -2060,6 +2356,7 @@ class Context:
         storage_buffers: Tuple[Tuple[Buffer, int], ...] = (),
         samplers: Tuple[Tuple["Sampler", int], ...] = (),
         enable: Optional[int] = None,
+        discard_on_end: Tuple[Union[int, str], ...] = (),
     ) -> "Scope":
         """
         Create a :py:class:`Scope` object.
@@ -2074,6 +2371,8 @@ class Context:
             storage_buffers (tuple): Tuple of (buffer, binding) tuples.
             samplers (tuple): Tuple of sampler bindings
             enable (int): Flags to enable for this vao such as depth testing and blending
+            discard_on_end (tuple): Attachments of the framebuffer invalidated when leaving,
+                color attachment indices, ``'depth'`` or ``'stencil'``.
         """
     def simple_framebuffer(
         self,
@@ -2100,18 +2399,31 @@ class Context:
     def framebuffer(
         self,
         color_attachments: Any = (),
-        depth_attachment: Optional[Union[Texture, "Renderbuffer"]] = None,
+        depth_attachment: Optional[Any] = None,
     ) -> Framebuffer:
         """
         A :py:class:`Framebuffer` is a collection of buffers that can be \
         used as the destination for rendering. The buffers for Framebuffer \
         objects reference images from either Textures or Renderbuffers.
 
+        A :py:class:`TextureArray`, :py:class:`TextureCube` or :py:class:`Texture3D`
+        is attached as a layered image, a geometry shader selects the layer of
+        each primitive with ``gl_Layer``. Either all attachments are layered or none.
+        A ``(texture, layer)`` tuple attaches a single layer, cube map face or 3D texture slice.
+
         Args:
             color_attachments (list): A list of :py:class:`Texture` or
                                         :py:class:`Renderbuffer` objects.
             depth_attachment (Renderbuffer or Texture): The depth attachment.
 
+        Example::
+
+            # render all six faces of a cube map in one pass
+            fbo = ctx.framebuffer(ctx.texture_cube((256, 256), 4), ctx.depth_texture_cube((256, 256)))
+
+            # render into the third layer of a texture array
+            fbo = ctx.framebuffer((texture_array, 2))
+
         Returns:
             :py:class:`Framebuffer` object
         """
@@ -2160,14 +2472,22 @@ class Context:
         Returns:
             :py:class:`Renderbuffer` object
         """
-    def compute_shader(self, source: str | bytes | ConvertibleToShaderSource) -> "ComputeShader":
+    def compute_shader(
+        self,
+        source: str | bytes | ConvertibleToShaderSource,
+        specialization: Optional[Dict[int, Union[bool, int, float]]] = None,
+    ) -> "ComputeShader":
         """
         A :py:class:`ComputeShader` is a Shader Stage that is used entirely \
         for computing arbitrary information. While it can do rendering, it \
         is generally used for tasks not directly related to drawing.
 
+        Compute shaders with the same source and specialization constant values are cached,
+        every caller gets the same object and shares its uniform values.
+
         Args:
             source (str): The source of the compute shader.
+            specialization (dict): SPIR-V specialization constant values by constant id.
 
         Returns:
             :py:class:`ComputeShader` object
@@ -2492,6 +2812,49 @@ class Framebuffer:
             viewport (tuple): The viewport.
             color (tuple): Optional tuple replacing the red, green, blue and alpha arguments
         """
+    def clear_attachments(self, values: Dict[Union[int, str], Any]) -> None:
+        """
+        Clear attachments to separate values.
+
+        Keys are color attachment indices, ``'depth'`` and ``'stencil'``.
+        Color values are tuples of up to 4 components, missing components are zero.
+        Integer attachments are cleared with integer values, other attachments with floats.
+        Attachments not listed keep their content.
+
+        Like :py:meth:`clear` the :py:attr:`color_mask`, :py:attr:`depth_mask`
+        and :py:attr:`scissor` of the framebuffer are respected.
+
+        Args:
+            values (dict): The clear value of each attachment.
+
+        Example::
+
+            # object ids in attachment 1 are reset to -1
+            fbo.clear_attachments({0: (0.0, 0.0, 0.0, 1.0), 1: (-1,), 'depth': 1.0})
+        """
+    def invalidate(
+        self,
+        attachments: Optional[Tuple[Union[int, str], ...]] = None,
+        viewport: Optional[Union[Tuple[int, int], Tuple[int, int, int, int]]] = None,
+    ) -> None:
+        """
+        Tell the driver the content of attachments is no longer needed.
+
+        The driver can skip storing invalidated attachments to memory,
+        which saves bandwidth on tiled and software rasterizers.
+        The content of invalidated attachments is undefined until written again.
+        Does nothing when the driver does not support invalidation.
+
+        Args:
+            attachments (tuple): Color attachment indices, ``'depth'`` or ``'stencil'``.
+                All attachments are invalidated by default.
+            viewport (tuple): Only invalidate the given region.
+
+        Example::
+
+            # the depth of an intermediate pass is never read
+            fbo.invalidate(['depth'])
+        """
     def use(self) -> None:
         """Bind the framebuffer. Sets the target for rendering commands."""
     def read(
@@ -2502,6 +2865,10 @@ class Framebuffer:
         alignment: int = 1,
         dtype: str = "f1",
         clamp: bool = False,
+        flip_y: bool = False,
+        swizzle: Optional[str] = None,
+        out_dtype: Optional[str] = None,
+        out_components: Optional[int] = None,
     ) -> bytes:
         """
         Read the content of the framebuffer.
@@ -2516,6 +2883,8 @@ class Framebuffer:
             data = fbo.read(attachment=-1)
             # Read the lower left 10 x 10 pixels from the first color attachment
             data = fbo.read(viewport=(0, 0, 10, 10))
+            # Read a float attachment as top-down 8 bit BGR
+            data = fbo.read(components=4, dtype='f4', flip_y=True, swizzle='bgr', out_dtype='f1')
 
         Args:
             viewport (tuple): The viewport.
@@ -2526,6 +2895,10 @@ class Framebuffer:
             alignment (int): The byte alignment of the pixels.
             dtype (str): Data type.
             clamp (bool): Clamps floating point values to ``[0.0, 1.0]``
+            flip_y (bool): Return the top row first.
+            swizzle (str): The output channels such as ``'bgr'``, picked from ``'rgba'``.
+            out_dtype (str): The output data type, ``f4`` values are clamped and scaled into ``f1``.
+            out_components (int): Keep the first components only.
 
         Returns:
             bytes
@@ -2539,7 +2912,11 @@ class Framebuffer:
         alignment: int = 1,
         dtype: str = "f1",
         write_offset: int = 0,
-    ) -> None:
+        flip_y: bool = False,
+        swizzle: Optional[str] = None,
+        out_dtype: Optional[str] = None,
+        out_components: Optional[int] = None,
+    ) -> int:
         """
         Read the content of the framebuffer into a buffer.
 
@@ -2553,10 +2930,172 @@ class Framebuffer:
             alignment (int): The byte alignment of the pixels.
             dtype (str): Data type.
             write_offset (int): The write offset.
+            flip_y (bool): Write the top row first.
+            swizzle (str): The output channels such as ``'bgr'``, picked from ``'rgba'``.
+            out_dtype (str): The output data type, ``f4`` values are clamped and scaled into ``f1``.
+            out_components (int): Keep the first components only.
+
+        Returns:
+            int: The number of bytes written.
+        """
+    def read_async(
+        self,
+        viewport: Optional[Union[Tuple[int, int], Tuple[int, int, int, int]]] = None,
+        components: int = 3,
+        attachment: int = 0,
+        alignment: int = 1,
+        dtype: str = "f1",
+        clamp: bool = False,
+        buffers: int = 3,
+    ) -> "AsyncRead":
+        """
+        Start reading the content of the framebuffer into a pixel pack buffer without waiting.
+
+        The framebuffer keeps a ring of ``buffers`` pixel pack buffers reused from call to call.
+        A returned :py:class:`AsyncRead` is valid until its buffer is reused.
+
+        Args:
+            viewport (tuple): The viewport.
+            components (int): The number of components to read.
+
+        Keyword Args:
+            attachment (int): The color attachment, -1 reads the depth buffer.
+            alignment (int): The byte alignment of the pixels.
+            dtype (str): Data type.
+            clamp (bool): Clamps floating point values into ``[0.0, 1.0]``.
+            buffers (int): The number of pixel pack buffers in the ring.
+
+        Returns:
+            :py:class:`AsyncRead` object
+        """
+    def pick(
+        self,
+        points: Any,
+        attachment: Union[int, str] = 0,
+        components: Optional[int] = None,
+        dtype: Optional[str] = None,
+    ) -> bytes:
+        """
+        Read the pixels under a list of points or small rects.
+
+        Points are ``(x, y)`` tuples and rects are ``(x, y, width, height)`` tuples.
+        All of them are read into one pixel pack buffer and arrive after a single wait.
+        The pixels of the rects are returned one after the other, rows are not padded.
+
+        The components and dtype default to the ones of the color attachment.
+        ``'depth'`` reads ``f4`` depth values and ``'depth_stencil'`` reads
+        ``u4`` values with the depth in the upper 24 bits and the stencil in the lower 8 bits.
+
+        Args:
+            points (list): The points or rects to read.
+            attachment (int): The color attachment, ``'depth'`` or ``'depth_stencil'``.
+
+        Keyword Args:
+            components (int): The number of components to read.
+            dtype (str): Data type.
+
+        Example::
+
+            ids = np.frombuffer(fbo.pick(cursors, attachment=1, dtype='u4'), dtype='u4')
+        """
+    def capture_stream(
+        self,
+        file: Any,
+        format: str = "rgb24",
+        flip: bool = True,
+        depth: int = 3,
+        attachment: int = 0,
+    ) -> "CaptureStream":
+        """
+        Create a :py:class:`CaptureStream` writing raw video frames of this framebuffer.
+
+        Args:
+            file: A binary file object or a file descriptor such as the stdin of ffmpeg.
+
+        Keyword Args:
+            format (str): ``rgb24`` or ``yuv420p``.
+            flip (bool): Write the top row first as video encoders expect.
+            depth (int): The number of frames in flight.
+            attachment (int): The color attachment.
+
+        Returns:
+            :py:class:`CaptureStream` object
         """
     def release(self) -> None:
         """Release the ModernGL object."""
 
+class AsyncRead:
+    """
+    A pending framebuffer read started by :py:meth:`Framebuffer.read_async`.
+
+    The pixels are copied into a pixel pack buffer on the GPU and fenced.
+    Reading them maps the buffer, waiting for the fence if necessary.
+    """
+
+    size: int
+    """int: The number of bytes read."""
+
+    done: bool
+    """bool: True if the GPU finished copying the pixels."""
+
+    ctx: "Context"
+    """The context this object belongs to"""
+
+    extra: Any
+    """Attribute for storing user defined objects"""
+
+    def wait(self, timeout: Optional[float] = None) -> bool:
+        """
+        Wait for the GPU to finish copying the pixels.
+
+        Args:
+            timeout (float): The timeout in seconds, None waits forever.
+
+        Returns:
+            bool: False if the timeout expired.
+        """
+    def read(self) -> bytes:
+        """Wait for the pixels and return them."""
+    def read_into(self, buffer: Any, write_offset: int = 0) -> None:
+        """
+        Wait for the pixels and copy them into a writable buffer such as a numpy array.
+
+        Args:
+            buffer (bytearray): The buffer that will receive the pixels.
+
+        Keyword Args:
+            write_offset (int): The write offset.
+        """
+
+class CaptureStream:
+    """
+    A capture stream writes the frames of a framebuffer to a file or a pipe.
+
+    Frames are converted on the GPU, read back asynchronously
+    and written by a background thread while rendering continues.
+    """
+
+    format: str
+    """str: ``rgb24`` or ``yuv420p``."""
+
+    frames: int
+    """int: The number of captured frames."""
+
+    ctx: "Context"
+    """The context this object belongs to"""
+
+    extra: Any
+    """Attribute for storing user defined objects"""
+
+    def __enter__(self) -> "CaptureStream": ...
+    def __exit__(self, *args): ...
+    def capture(self) -> None:
+        """Capture the current content of the framebuffer."""
+    def close(self) -> None:
+        """Write the frames in flight, stop the writer thread and release the GPU resources."""
+    def release(self) -> None:
+        """Stop the writer thread and release the GPU resources, dropping the frames in flight."""
+
 class Program:
     """
     A Program object represents fully processed executable code in the OpenGL Shading Language, \
@@ -2650,6 +3189,9 @@ class Program:
     is_transform: bool
     """If this is a tranform program (no fragment shader)."""
 
+    stage: Optional[str]
+    """The shader stage of a separable program created with :py:meth:`Context.shader_stage`."""
+
     geometry_input: int
     """
     The geometry input primitive.
@@ -2707,6 +3249,49 @@ class Program:
     def release(self) -> None:
         """Release the ModernGL object."""
 
+def pack_draw_commands(
+    counts: Any,
+    instances: Any = 1,
+    first: Any = 0,
+    base_vertex: Any = 0,
+    base_instance: Any = 0,
+    indexed: bool = False,
+) -> bytes:
+    """
+    Pack indirect draw commands for :py:meth:`VertexArray.render_indirect`.
+
+    Every field is either a single integer or an int32 buffer with one value per command.
+
+    Args:
+        counts: The number of vertices or indices of each draw.
+
+    Keyword Args:
+        instances: The number of instances of each draw.
+        first: The first vertex or index of each draw.
+        base_vertex: The value added to the indices of each draw. Requires ``indexed``.
+        base_instance: The first instance of each draw.
+        indexed (bool): Pack ``DrawElementsIndirectCommand`` structures.
+
+    Returns:
+        bytes
+    """
+
+def quantize(data: Any, fmt: str) -> bytes:
+    """
+    Convert float32 data into the layout described by a buffer format.
+
+    The data is read as rows, every attribute of the format takes as many floats as it has components
+    and padding takes none. Integer values are rounded and clamped to the range of the type,
+    normalized types are scaled first.
+
+    Args:
+        data (buffer): A float32 buffer such as a numpy array with dtype ``float32``.
+        fmt (str): The buffer format, for example ``'3f2 x2 ni10'``.
+
+    Returns:
+        bytes
+    """
+
 def detect_format(
     program: Program,
     attributes: Any,
@@ -2716,6 +3301,8 @@ def detect_format(
     Detect format for vertex attributes.
 
     The format returned does not contain padding.
+    With the default mode the result is an interned :py:class:`VertexFormat`,
+    memoized per program and attribute names.
 
     Args:
         program (Program): The program.
@@ -2725,6 +3312,218 @@ def detect_format(
         str
     """
 
+class ProgramPipeline:
+    """
+    A program pipeline combines separable shader stages without linking them into a program.
+
+    Pipelines can be used in place of a :py:class:`Program` when creating a :py:class:`VertexArray`
+    or passed to :py:meth:`VertexArray.render` to draw with different stages.
+
+    A ProgramPipeline object cannot be instantiated directly, it requires a context.
+    Use :py:meth:`Context.pipeline` to create one.
+    """
+
+    def __getitem__(self, kind: str) -> Program:
+        """Get the shader stage of the given kind."""
+    def release(self) -> None:
+        """Release the ModernGL object."""
+    stages: Dict[str, Program]
+    """The shader stages by kind."""
+
+    is_transform: bool
+    """Always ``False``."""
+
+    mglo: Any
+    """Internal representation for debug purposes only."""
+
+    ctx: "Context"
+    """The context this object belongs to"""
+
+    extra: Any
+    """Attribute for storing user defined objects"""
+
+    glo: int
+    """
+    The internal OpenGL object.
+
+    This values is provided for debug purposes only.
+    """
+
+class ProgramFamily:
+    """
+    A set of :py:class:`Program` variants compiled from the same sources with different defines.
+
+    Variants are compiled on first request and kept in a least recently used cache.
+    Defines are only injected into the stages referencing them, stages sharing
+    the same final source also share the compiled shader object through the
+    context shader cache.
+
+    A ProgramFamily object cannot be instantiated directly, it requires a context.
+    Use :py:meth:`Context.program_family` to create one.
+    """
+
+    def __getitem__(self, defines: Dict[str, Any]) -> Program:
+        """Get the variant for the given defines."""
+    def __len__(self) -> int:
+        """The number of compiled variants in the cache."""
+    def __contains__(self, defines: Dict[str, Any]) -> bool:
+        """Check if the variant for the given defines is compiled."""
+    def get(self, defines: Optional[Dict[str, Any]] = None, **kwargs: Any) -> Program:
+        """
+        Get a variant, compiling it on first use.
+
+        Missing defines take their default value.
+        When the cache is full the least recently used variant is dropped from it.
+        Programs still referenced elsewhere stay valid and follow the gc_mode.
+
+        Args:
+            defines (dict): The define values.
+
+        Keyword Args:
+            **kwargs: The define values.
+
+        Returns:
+            :py:class:`Program` object
+        """
+    def release(self) -> None:
+        """Release all variants and the shader objects no other program uses."""
+    defines: Dict[str, Any]
+    """The default define values."""
+
+    variants: Tuple[Dict[str, Any], ...]
+    """The define values of the compiled variants from least to most recently used."""
+
+    cache_size: Optional[int]
+    """The maximum number of variants kept."""
+
+    ctx: "Context"
+    """The context this object belongs to"""
+
+    extra: Any
+    """Attribute for storing user defined objects"""
+
+class TransformFeedback:
+    """
+    A transform feedback object owns the output bindings of :py:meth:`VertexArray.transform`.
+
+    Transform calls into the same object append to the outputs until :py:meth:`end` is called.
+    The number of captured vertices stays on the GPU, :py:meth:`VertexArray.render_feedback`
+    draws them without reading it back.
+
+    A TransformFeedback object cannot be instantiated directly, it requires a context.
+    Use :py:meth:`Context.transform_feedback` to create one.
+    """
+
+    outputs: List[Buffer]
+    """list: The output buffers."""
+
+    active: bool
+    """bool: True after a transform call until :py:meth:`end` is called."""
+
+    streams: int
+    """int: The number of vertex streams with a primitive counter."""
+
+    glo: int
+    """int: The internal OpenGL object."""
+
+    ctx: "Context"
+    """The context this object belongs to"""
+
+    extra: Any
+    """Attribute for storing user defined objects"""
+
+    def end(self) -> None:
+        """End capturing. The next transform call starts at the beginning of the outputs again."""
+    def primitives_written(self, stream: int = 0, wait: bool = False) -> Optional[int]:
+        """
+        The number of primitives written to a stream during the last capture.
+
+        Returns ``None`` if the GPU has not finished yet and ``wait`` is False.
+
+        Keyword Args:
+            stream (int): The vertex stream.
+            wait (bool): Block until the result is available.
+        """
+    def write_primitives_written(self, buffer: Buffer, offset: int = 0, stream: int = 0) -> None:
+        """
+        Write the number of primitives written to a stream into a buffer as an uint32.
+
+        The GPU copies the value when it becomes available, the CPU does not wait.
+        Requires OpenGL 4.4.
+
+        Args:
+            buffer (Buffer): The destination buffer.
+
+        Keyword Args:
+            offset (int): The byte offset, a multiple of 4.
+            stream (int): The vertex stream.
+        """
+    def release(self) -> None:
+        """Release the ModernGL object."""
+
+class FeedbackLoop:
+    """
+    A feedback loop runs a transform program back and forth between two buffers.
+
+    The vertex count of every step is taken from the previous one on the GPU.
+
+    A FeedbackLoop object cannot be instantiated directly, it requires a context.
+    Use :py:meth:`Context.feedback_loop` to create one.
+    """
+
+    buffers: Tuple[Buffer, Buffer]
+    """tuple: The two buffers."""
+
+    vertex_arrays: Tuple["VertexArray", "VertexArray"]
+    """tuple: The vertex arrays reading each buffer."""
+
+    feedbacks: Tuple[TransformFeedback, TransformFeedback]
+    """tuple: The transform feedbacks writing the other buffer."""
+
+    current: Buffer
+    """Buffer: The buffer holding the latest state."""
+
+    previous: Buffer
+    """Buffer: The buffer the next step writes to."""
+
+    ctx: "Context"
+    """The context this object belongs to"""
+
+    extra: Any
+    """Attribute for storing user defined objects"""
+
+    def step(self, steps: int = 1) -> None:
+        """
+        Run the transform program ``steps`` times, swapping the buffers after each one.
+
+        Args:
+            steps (int): The number of steps.
+        """
+    def render_current(
+        self,
+        vertex_array: Union["VertexArray", Tuple["VertexArray", "VertexArray"]],
+        mode: Optional[int] = None,
+        instances: int = -1,
+        binding: int = 0,
+    ) -> None:
+        """
+        Render the current state.
+
+        A vertex array is rendered through a cached copy reading :py:attr:`current`
+        at the ``binding`` content entry, the vertex array itself is not changed.
+        A pair of vertex arrays reading the two buffers is indexed instead.
+
+        Args:
+            vertex_array: A VertexArray or a pair of them.
+
+        Keyword Args:
+            mode (int): The primitive type.
+            instances (int): The number of instances.
+            binding (int): The vertex buffer binding reading the state.
+        """
+    def release(self) -> None:
+        """Release the ModernGL object and the objects it created."""
+
 class Query:
     """This class represents a Query object."""
 
@@ -3027,6 +3826,131 @@ class Scope:
     extra: Any
     """Attribute for storing user defined objects"""
 
+class MeshPool:
+    """
+    A mesh pool appends meshes of the same vertex format into shared vertex and index buffers.
+
+    Every mesh is drawn from a single vertex array with :py:meth:`VertexArray.render_base_vertex`.
+
+    A MeshPool object cannot be instantiated directly, it requires a context.
+    Use :py:meth:`Context.mesh_pool` to create one.
+    """
+
+    vertex_array: "VertexArray"
+    """VertexArray: The vertex array drawing every mesh, released and replaced when the buffers grow."""
+
+    vertex_buffer: Buffer
+    """Buffer: The shared vertex buffer, released and replaced when it grows."""
+
+    index_buffer: Buffer
+    """Buffer: The shared index buffer, released and replaced when it grows."""
+
+    num_vertices: int
+    """int: The number of vertices in use."""
+
+    num_indices: int
+    """int: The number of indices in use."""
+
+    ctx: "Context"
+    """The context this object belongs to"""
+
+    extra: Any
+    """Attribute for storing user defined objects"""
+
+    def add(self, vertices: Any, indices: Any) -> Tuple[int, int, int]:
+        """
+        Append a mesh and return its ``(first_index, index_count, base_vertex)`` handle.
+
+        When the buffers are full they are replaced by larger ones, the previous
+        :py:attr:`vertex_array`, :py:attr:`vertex_buffer` and :py:attr:`index_buffer`
+        are released. Read these attributes again after adding meshes instead of keeping them.
+
+        Args:
+            vertices (bytes): The vertex data matching the format of the pool.
+            indices (bytes): The index data relative to the first vertex of the mesh.
+        """
+    def render(self, mesh: Tuple[int, int, int], instances: int = 1, base_instance: int = 0, mode: Optional[int] = None) -> None:
+        """
+        Render a mesh returned by :py:meth:`add`.
+
+        Args:
+            mesh (tuple): The mesh handle.
+
+        Keyword Args:
+            instances (int): The number of instances.
+            base_instance (int): The first instance read by instanced attributes.
+            mode (int): The primitive type, the pool's mode by default.
+        """
+    def clear(self) -> None:
+        """Forget every mesh, the buffers are kept."""
+    def release(self) -> None:
+        """Release the vertex array and the buffers."""
+
+class VertexFormat(str):
+    """
+    A pre-parsed buffer format, interned per context.
+
+    It compares and hashes like the format string and can be used anywhere a format string is accepted.
+    Vertex arrays created with it skip parsing the format.
+
+    A VertexFormat object cannot be instantiated directly, it requires a context.
+    Use :py:meth:`Context.vertex_format` to create one.
+    """
+
+    @property
+    def stride(self) -> int:
+        """int: The size of a single vertex in bytes, including padding."""
+    @property
+    def divisor(self) -> int:
+        """int: 0 for per vertex, 1 for per instance and ``0x7fffffff`` for per render attributes."""
+    @property
+    def attributes(self) -> int:
+        """int: The number of attributes, padding excluded."""
+
+class CommandList:
+    """
+    A command list stores a sequence of rendering calls and replays them with a single call.
+
+    While recording, render calls, uniform writes, buffer bindings, framebuffer use, clear and invalidate,
+    compute dispatches, texture and sampler use, texture invalidate and scopes are stored instead of
+    executed and return an integer handle. Calls that change the context state or draw without being
+    recorded raise an :py:class:`Error` while recording.
+
+    A CommandList object cannot be instantiated directly, it requires a context.
+    Use :py:meth:`Context.record` to create one.
+    """
+
+    def __enter__(self) -> "CommandList": ...
+    def __exit__(self, *args: Tuple[Any]): ...
+    def __len__(self) -> int:
+        """The number of recorded commands."""
+    def end(self) -> None:
+        """Stop recording."""
+    def execute(self) -> None:
+        """Replay the recorded calls."""
+    def set_uniform(self, handle: int, data: Any) -> None:
+        """Replace the data of a recorded uniform write. The size must not change."""
+    def set_render(
+        self,
+        handle: int,
+        vertices: Optional[int] = None,
+        first: Optional[int] = None,
+        instances: Optional[int] = None,
+    ) -> None:
+        """Change the arguments of a recorded render call. Arguments left as ``None`` are unchanged."""
+    def set_buffer_offset(self, handle: int, offset: int) -> None:
+        """Change the offset of a recorded uniform or storage buffer binding."""
+    def release(self) -> None:
+        """Release the ModernGL object."""
+    mglo: Any
+    """Internal representation for debug purposes only."""
+
+    ctx: "Context"
+    """The context this object belongs to"""
+
+    extra: Any
+    """Attribute for storing user defined objects"""
+
 class Texture3D:
     """
     A Texture is an OpenGL object that contains one or more images that all have the same image format.
@@ -4232,6 +5156,16 @@ class Texture:
             base (int): The base level
             max_level (int): The maximum levels to generate
         """
+    def invalidate(self, level: int = 0) -> None:
+        """
+        Tell the driver the content of the texture is no longer needed.
+
+        The content of the level is undefined until written again.
+        Does nothing when the driver does not support invalidation.
+
+        Keyword Args:
+            level (int): The mipmap level.
+        """
     def use(self, location: int = 0) -> None:
         """
         Bind the texture to a texture unit.
@@ -4406,10 +5340,13 @@ class VertexArray:
         vertices: int = -1,
         first: int = 0,
         instances: int = -1,
-    ) -> None:
+        program: Union[Program, ProgramPipeline, None] = None,
+    ) -> Optional[int]:
         """
         The render primitive (mode) must be the same as the input primitive of the GeometryShader.
 
+        While a :py:class:`CommandList` is recording the call is stored and its handle is returned.
+
         Args:
             mode (int): By default :py:data:`TRIANGLES` will be used.
             vertices (int): The number of vertices to transform.
@@ -4417,6 +5354,57 @@ class VertexArray:
         Keyword Args:
             first (int): The index of the first vertex to start with.
             instances (int): The number of instances.
+            program (ProgramPipeline): Render with this program or pipeline instead of the vertex array's own.
+                                       Its attribute locations must match.
+        """
+    def render_base_vertex(
+        self,
+        mode: Optional[int] = None,
+        vertices: int = -1,
+        first: int = 0,
+        base_vertex: int = 0,
+        instances: int = 1,
+        base_instance: int = 0,
+        program: Union[Program, ProgramPipeline, None] = None,
+    ) -> None:
+        """
+        Render a range of the vertex array with an offset added to the indices and instances.
+
+        Args:
+            mode (int): By default :py:data:`TRIANGLES` will be used.
+            vertices (int): The number of vertices or indices to draw.
+
+        Keyword Args:
+            first (int): The first vertex or index.
+            base_vertex (int): The value added to the indices. Requires an index buffer.
+            instances (int): The number of instances.
+            base_instance (int): The first instance read by instanced attributes.
+                                 Requires OpenGL 4.2.
+            program (ProgramPipeline): Render with this program or pipeline instead of the vertex array's own.
+        """
+    def render_multi(
+        self,
+        firsts: Any,
+        counts: Any,
+        base_vertices: Any = None,
+        mode: Optional[int] = None,
+        program: Union[Program, ProgramPipeline, None] = None,
+    ) -> None:
+        """
+        Render several ranges of the vertex array with a single multi-draw call.
+
+        The ranges are given as int32 buffers such as numpy arrays with dtype ``int32``.
+        For indexed vertex arrays the firsts are offsets into the index buffer.
+
+        Args:
+            firsts (buffer): The first vertex or index of each draw.
+            counts (buffer): The number of vertices or indices of each draw.
+
+        Keyword Args:
+            base_vertices (buffer): The value added to the indices of each draw.
+                                    Requires an index buffer.
+            mode (int): By default :py:data:`TRIANGLES` will be used.
+            program (ProgramPipeline): Render with this program or pipeline instead of the vertex array's own.
         """
     def render_indirect(
         self,
@@ -4424,11 +5412,19 @@ class VertexArray:
         mode: Optional[int] = None,
         count: int = -1,
         first: int = 0,
+        count_buffer: Optional[Buffer] = None,
+        count_offset: int = 0,
+        max_count: int = -1,
+        stride: int = 0,
     ) -> None:
         """
         The render primitive (mode) must be the same as the input primitive of the GeometryShader.
 
-        The draw commands are 5 integers: (count, instanceCount, firstIndex, baseVertex, baseInstance).
+        The draw commands are 4 integers without an index buffer: (count, instanceCount, first, baseInstance)
+        and 5 integers with an index buffer: (count, instanceCount, firstIndex, baseVertex, baseInstance).
+
+        With a count buffer the number of draws is read from it on the GPU.
+        This requires OpenGL 4.6 or ``ARB_indirect_parameters``.
 
         Args:
             buffer (Buffer): Indirect drawing commands.
@@ -4437,10 +5433,14 @@ class VertexArray:
 
         Keyword Args:
             first (int): The index of the first indirect draw command.
+            count_buffer (Buffer): A buffer holding the number of draws as an integer.
+            count_offset (int): The byte offset of the draw count in the count buffer.
+            max_count (int): The maximum number of draws when using a count buffer.
+            stride (int): The distance between commands in bytes.
         """
     def transform(
         self,
-        buffer: Union[Buffer, List[Buffer]],
+        buffer: Union[Buffer, List[Buffer], "TransformFeedback"],
         mode: Optional[int] = None,
         vertices: int = -1,
         first: int = 0,
@@ -4454,6 +5454,9 @@ class VertexArray:
         The transform primitive (mode) must be the same as
         the input primitive of the GeometryShader.
 
+        A :py:class:`TransformFeedback` keeps capturing across calls until it is ended,
+        the ``buffer_offset`` is ignored in that case.
+
         Args:
             buffer (Buffer): The buffer to store the output.
             mode (int): By default :py:data:`POINTS` will be used.
@@ -4464,6 +5467,30 @@ class VertexArray:
             instances (int): The number of instances.
             buffer_offset (int): Byte offset for the output buffer
         """
+    def render_feedback(
+        self,
+        feedback: "TransformFeedback",
+        mode: Optional[int] = None,
+        instances: int = -1,
+        stream: int = 0,
+        program: Union[Program, ProgramPipeline, None] = None,
+    ) -> None:
+        """
+        Render the vertices captured by an ended :py:class:`TransformFeedback`.
+
+        The vertex count is taken from the transform feedback object on the GPU.
+        More than one instance requires OpenGL 4.2.
+
+        Args:
+            feedback (TransformFeedback): The transform feedback object.
+
+        Keyword Args:
+            mode (int): By default :py:data:`TRIANGLES` will be used.
+            instances (int): The number of instances.
+            stream (int): Render the vertices captured from this vertex stream.
+            program (ProgramPipeline): Render with this program or pipeline instead of the vertex array's own.
+                                       Its attribute locations must match.
+        """
     def bind(
         self,
         attribute: int,
@@ -4490,5 +5517,33 @@ class VertexArray:
             divisor (int): The divisor.
             normalize (bool): The normalize parameter, if applicable.
         """
+    def bind_vertex_buffer(self, binding: int, buffer: Buffer, offset: int = 0, stride: Optional[int] = None) -> None:
+        """
+        Replace the buffer of a vertex buffer binding without redefining the attribute formats.
+
+        Every entry of the vertex array content has its own binding, numbered in order.
+        Requires OpenGL 4.3. Without an index buffer the vertex count is updated to match.
+
+        Args:
+            binding (int): The index of the content entry.
+            buffer (Buffer): The new buffer.
+
+        Keyword Args:
+            offset (int): The byte offset of the first vertex.
+            stride (int): The byte stride. By default the stride of the entry's format is kept.
+        """
+    def bind_vertex_buffers(self, buffers: List[Any], first: int = 0) -> None:
+        """
+        Replace the buffers of consecutive vertex buffer bindings with a single call.
+
+        Items are buffers or ``(buffer, offset)`` or ``(buffer, offset, stride)`` tuples.
+        Requires OpenGL 4.3, uses ``glBindVertexBuffers`` when available.
+
+        Args:
+            buffers (list): The new buffers.
+
+        Keyword Args:
+            first (int): The first binding to replace.
+        """
     def release(self) -> None:
         """Release the ModernGL object."""
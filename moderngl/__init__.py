@@ -1,8 +1,16 @@
+import os
+import queue
+import re
+import threading
 import warnings
-from collections import deque
+import weakref
+from collections import OrderedDict, deque
+from collections.abc import MutableMapping
 
 from _moderngl import Attribute, Error, InvalidObject, StorageBlock, Subroutine, Uniform, UniformBlock, Varying
+from _moderngl import pack_spv_specialization_constants as _pack_spv_constants
 from _moderngl import parse_spv_inputs as _parse_spv
+from _moderngl import parse_spv_specialization_constants as _parse_spv_constants
 
 try:
     from moderngl import mgl
@@ -75,10 +83,10 @@ class Buffer:
         self.mglo.clear(size, offset, chunk)
 
     def bind_to_uniform_block(self, binding=0, offset=0, size=-1):
-        self.mglo.bind_to_uniform_block(binding, offset, size)
+        return self.mglo.bind_to_uniform_block(binding, offset, size)
 
     def bind_to_storage_buffer(self, binding=0, offset=0, size=-1):
-        self.mglo.bind_to_storage_buffer(binding, offset, size)
+        return self.mglo.bind_to_storage_buffer(binding, offset, size)
 
     def orphan(self, size=-1):
         self.mglo.orphan(size)
@@ -136,11 +144,159 @@ class Query:
         return self.mglo.elapsed
 
 
+class TransformFeedback:
+    def __init__(self):
+        self.mglo = None
+        self._outputs = None
+        self._glo = None
+        self.ctx = None
+        self.extra = None
+        raise TypeError()
+
+    def __del__(self):
+        if not hasattr(self, "ctx"):
+            return
+
+        if self.ctx.gc_mode == "auto":
+            self.release()
+        elif self.ctx.gc_mode == "context_gc":
+            self.ctx.objects.append(self.mglo)
+
+    @property
+    def outputs(self):
+        return self._outputs
+
+    @property
+    def active(self):
+        return self.mglo.active
+
+    @property
+    def streams(self):
+        return self.mglo.streams
+
+    @property
+    def glo(self):
+        return self._glo
+
+    def end(self):
+        self.mglo.end()
+
+    def primitives_written(self, stream=0, wait=False):
+        return self.mglo.primitives_written(stream, wait)
+
+    def write_primitives_written(self, buffer, offset=0, stream=0):
+        self.mglo.write_primitives_written(buffer.mglo, offset, stream)
+
+    def release(self):
+        if not isinstance(self.mglo, InvalidObject):
+            self._outputs = None
+            self.mglo.release()
+            self.mglo = InvalidObject()
+
+
+class FeedbackLoop:
+    def __init__(self):
+        self.mglo = None
+        self._buffers = None
+        self._vertex_arrays = None
+        self._feedbacks = None
+        self._vertices = None
+        self._render_arrays = None
+        self.ctx = None
+        self.extra = None
+        raise TypeError()
+
+    def __del__(self):
+        if not hasattr(self, "ctx"):
+            return
+
+        if self.ctx.gc_mode == "auto":
+            self.release()
+        elif self.ctx.gc_mode == "context_gc":
+            self.ctx.objects.append(self.mglo)
+
+    @property
+    def buffers(self):
+        return self._buffers
+
+    @property
+    def vertex_arrays(self):
+        return self._vertex_arrays
+
+    @property
+    def feedbacks(self):
+        return self._feedbacks
+
+    @property
+    def current(self):
+        return self._buffers[self.mglo.current]
+
+    @property
+    def previous(self):
+        return self._buffers[1 - self.mglo.current]
+
+    def step(self, steps=1):
+        self.mglo.step(steps)
+
+    def render_current(self, vertex_array, mode=None, instances=-1, binding=0):
+        current = self.mglo.current
+        if isinstance(vertex_array, (list, tuple)):
+            vertex_array = vertex_array[current]
+        else:
+            copy = self._render_array(vertex_array, binding)[current]
+            copy.scope = vertex_array.scope
+            vertex_array = copy
+
+        if self.mglo.stepped:
+            vertex_array.render_feedback(self._feedbacks[1 - current], mode, instances)
+        else:
+            vertex_array.render(mode, self._vertices, instances=instances)
+
+    def _render_array(self, vertex_array, binding):
+        # The vertex array is left unchanged, two copies reading the loop buffers at the binding are cached
+        key = (vertex_array, binding)
+        if key not in self._render_arrays:
+            content = list(vertex_array._content)
+            if not 0 <= binding < len(content):
+                raise Error(f"invalid vertex buffer binding {binding}")
+
+            copies = []
+            for buffer in self._buffers:
+                content[binding] = (buffer, *content[binding][1:])
+                copies.append(self.ctx._vertex_array(
+                    vertex_array._program,
+                    content,
+                    vertex_array._index_buffer,
+                    vertex_array._index_element_size,
+                    skip_errors=True,
+                    mode=vertex_array._mode,
+                ))
+            self._render_arrays[key] = copies
+
+        return self._render_arrays[key]
+
+    def release(self):
+        if not isinstance(self.mglo, InvalidObject):
+            self.mglo.release()
+            self.mglo = InvalidObject()
+            for obj in self._feedbacks + self._vertex_arrays:
+                obj.release()
+            for copies in self._render_arrays.values():
+                for obj in copies:
+                    obj.release()
+            self._buffers = None
+            self._vertex_arrays = None
+            self._feedbacks = None
+            self._render_arrays = None
+
+
 class ComputeShader:
     def __init__(self):
         self.mglo = None
         self._members = {}
         self._glo = None
+        self._sources = None
+        self._recipe = None
         self.ctx = None
         self.extra = None
         raise TypeError()
@@ -187,6 +343,8 @@ class Framebuffer:
         self.mglo = None
         self._color_attachments = None
         self._depth_attachment = None
+        self._readbacks = None
+        self._pick_readback = None
         self._size = (None, None)
         self._samples = None
         self._glo = None
@@ -287,35 +445,444 @@ class Framebuffer:
 
         self.mglo.clear(red, green, blue, alpha, depth, viewport)
 
+    def clear_attachments(self, values):
+        colors = []
+        depth = None
+        stencil = None
+        for key, value in values.items():
+            if key == "depth":
+                depth = float(value)
+            elif key == "stencil":
+                stencil = int(value)
+            else:
+                index = int(key)
+                kind = "f"
+                source = self._color_image(index)
+                if source is not None:
+                    kind = source.dtype[0]
+                    kind = kind if kind in "iu" else "f"
+                value = tuple(value)
+                if len(value) > 4:
+                    raise Error("a clear value has at most 4 components")
+                cast = float if kind == "f" else int
+                colors.append((index, kind, tuple(cast(x) for x in value) + (0,) * (4 - len(value))))
+        self.mglo.clear_attachments(tuple(colors), depth, stencil)
+
+    def invalidate(self, attachments=None, viewport=None):
+        if viewport is not None:
+            viewport = tuple(viewport)
+
+        self.mglo.invalidate(self._attachment_indices(attachments), viewport)
+
+    def _color_image(self, index):
+        if not self._color_attachments or not 0 <= index < len(self._color_attachments):
+            return None
+        attachment = self._color_attachments[index]
+        return attachment[0] if type(attachment) is tuple else attachment
+
+    def _attachment_indices(self, attachments):
+        if attachments is None:
+            count = len(self._color_attachments) if self._color_attachments else 1
+            return tuple(range(count)) + (-1, -2)
+
+        indices = []
+        for attachment in attachments:
+            if attachment == "depth":
+                indices.append(-1)
+            elif attachment == "stencil":
+                indices.append(-2)
+            elif isinstance(attachment, int):
+                indices.append(attachment)
+            else:
+                raise Error(f"invalid attachment {attachment!r}")
+        return tuple(indices)
+
     def use(self):
         self.ctx.fbo = self
         self.mglo.use()
 
-    def read(self, viewport=None, components=3, attachment=0, alignment=1, dtype="f1", clamp=False):
+    def read(
+        self,
+        viewport=None,
+        components=3,
+        attachment=0,
+        alignment=1,
+        dtype="f1",
+        clamp=False,
+        flip_y=False,
+        swizzle=None,
+        out_dtype=None,
+        out_components=None,
+    ):
         if viewport is None:
             viewport = (0, 0, self.width, self.height)
         if len(viewport) == 2:
             viewport = (0, 0, *viewport)
-        res, mem = mgl.writable_bytes(mgl.expected_size(viewport[2], viewport[3], 1, components, alignment, dtype))
-        self.mglo.read_into(mem, viewport, components, attachment, alignment, clamp, dtype, 0)
+
+        size_components = components
+        if swizzle is not None:
+            size_components = len(swizzle)
+        elif out_components is not None:
+            size_components = out_components
+
+        size = mgl.expected_size(viewport[2], viewport[3], 1, size_components, alignment, out_dtype or dtype)
+        res, mem = mgl.writable_bytes(size)
+        options = (flip_y, swizzle, out_dtype, -1 if out_components is None else out_components)
+        self.mglo.read_into(mem, viewport, components, attachment, alignment, clamp, dtype, 0, *options)
         return res
 
     def read_into(
-        self, buffer, viewport=None, components=3, attachment=0, alignment=1, dtype="f1", clamp=False, write_offset=0
+        self,
+        buffer,
+        viewport=None,
+        components=3,
+        attachment=0,
+        alignment=1,
+        dtype="f1",
+        clamp=False,
+        write_offset=0,
+        flip_y=False,
+        swizzle=None,
+        out_dtype=None,
+        out_components=None,
     ):
         if type(buffer) is Buffer:
             buffer = buffer.mglo
 
-        return self.mglo.read_into(buffer, viewport, components, attachment, alignment, clamp, dtype, write_offset)
+        options = (flip_y, swizzle, out_dtype, -1 if out_components is None else out_components)
+        return self.mglo.read_into(buffer, viewport, components, attachment, alignment, clamp, dtype, write_offset, *options)
+
+    def read_async(self, viewport=None, components=3, attachment=0, alignment=1, dtype="f1", clamp=False, buffers=3):
+        if viewport is not None and len(viewport) == 2:
+            viewport = (0, 0, *viewport)
+
+        if self._readbacks is None:
+            self._readbacks = deque()
+
+        # The oldest pixel pack buffer is reused once the ring is full
+        if len(self._readbacks) < buffers:
+            mglo, _ = self.ctx.mglo.readback()
+        else:
+            mglo = self._readbacks.popleft()
+        self._readbacks.append(mglo)
+
+        res = AsyncRead.__new__(AsyncRead)
+        res.mglo = mglo
+        res._size, res._generation = self.mglo.read_async(mglo, viewport, components, attachment, alignment, clamp, dtype)
+        res.ctx = self.ctx
+        res.extra = None
+        return res
+
+    def pick(self, points, attachment=0, components=None, dtype=None):
+        rects = tuple((int(p[0]), int(p[1]), 1, 1) if len(p) == 2 else tuple(int(x) for x in p) for p in points)
+        if not rects:
+            return b""
+
+        if attachment == "depth":
+            attachment, components, dtype = -1, 1, dtype or "f4"
+        elif attachment == "depth_stencil":
+            attachment, components, dtype = -2, 1, "u4"
+        else:
+            num_colors = len(self._color_attachments) if self._color_attachments else 1
+            if isinstance(attachment, str) or not 0 <= attachment < num_colors:
+                raise Error(f"the framebuffer has no color attachment {attachment!r}")
+            source = self._color_image(attachment)
+            components = components or (source.components if source is not None else 4)
+            dtype = dtype or (source.dtype if source is not None else "f1")
+
+        if self._pick_readback is None:
+            self._pick_readback, _ = self.ctx.mglo.readback()
+
+        size, _ = self.mglo.pick(self._pick_readback, rects, components, attachment, dtype)
+        res, mem = mgl.writable_bytes(size)
+        self._pick_readback.read_into(mem, 0)
+        return res
+
+    def capture_stream(self, file, format="rgb24", flip=True, depth=3, attachment=0):
+        if format not in ("rgb24", "yuv420p"):
+            raise Error("the format must be rgb24 or yuv420p")
+
+        width, height = self.size
+        if format == "yuv420p" and (width % 2 or height % 2):
+            raise Error("yuv420p requires an even width and height")
+
+        source = None
+        if self._color_attachments:
+            source = self._color_attachments[attachment]
+            if type(source) is not Texture or source.samples:
+                source = None
+
+        if source is None and attachment:
+            raise Error("only single sample texture attachments can be captured besides the first one")
+
+        res = CaptureStream.__new__(CaptureStream)
+        res._framebuffer = self
+        res._format = format
+        res._depth = max(depth, 1)
+        res._pending = deque()
+        res._frames = 0
+        res._errors = []
+        res.ctx = self.ctx
+        res.extra = None
+
+        # The first color attachment is copied into a texture unless it can be sampled directly
+        res._copy = source is None
+        if res._copy:
+            source = self.ctx.texture((width, height), 4)
+        res._source = source
+
+        output_height = height + height // 2 if format == "yuv420p" else height
+        res._output = self.ctx.texture((width, output_height), 1 if format == "yuv420p" else 4)
+        res._output_fbo = self.ctx.framebuffer([res._output])
+        res._program = self.ctx.program(
+            vertex_shader=_CAPTURE_VERTEX_SHADER,
+            fragment_shader=_CAPTURE_FRAGMENT_SHADER % ("1" if format == "yuv420p" else "0"),
+        )
+        res._program["Source"] = 0
+        res._program["Flip"] = bool(flip)
+        res._vertex_array = self.ctx.vertex_array(res._program, [])
+
+        res._file = file
+        res._queue = queue.Queue(res._depth)
+        res._thread = threading.Thread(target=CaptureStream._write_frames, args=(res._queue, file, res._errors), daemon=True)
+        res._thread.start()
+        return res
 
     def release(self):
         if not isinstance(self.mglo, InvalidObject):
             self._color_attachments = None
             self._depth_attachment = None
+            if self._readbacks is not None:
+                for readback in self._readbacks:
+                    readback.release()
+                self._readbacks = None
+            if self._pick_readback is not None:
+                self._pick_readback.release()
+                self._pick_readback = None
             self.mglo.release()
             self.mglo = InvalidObject()
 
 
+class AsyncRead:
+    def __init__(self):
+        self.mglo = None
+        self._size = None
+        self._generation = None
+        self.ctx = None
+        self.extra = None
+        raise TypeError()
+
+    def _check(self):
+        if self.mglo.generation != self._generation:
+            raise Error("the pixel pack buffer was reused by a newer read_async call")
+
+    @property
+    def size(self):
+        return self._size
+
+    @property
+    def done(self):
+        self._check()
+        return self.mglo.done()
+
+    def wait(self, timeout=None):
+        self._check()
+        return self.mglo.wait(-1 if timeout is None else int(timeout * 1e9))
+
+    def read(self):
+        self._check()
+        res, mem = mgl.writable_bytes(self._size)
+        self.mglo.read_into(mem, 0)
+        return res
+
+    def read_into(self, buffer, write_offset=0):
+        self._check()
+        self.mglo.read_into(buffer, write_offset)
+
+
+_CAPTURE_VERTEX_SHADER = """
+    #version 330
+
+    void main() {
+        vec2 vertex = vec2(float(gl_VertexID & 1), float((gl_VertexID >> 1) & 1)) * 4.0 - 1.0;
+        gl_Position = vec4(vertex, 0.0, 1.0);
+    }
+"""
+
+_CAPTURE_FRAGMENT_SHADER = """
+    #version 330
+
+    #define YUV420P %s
+
+    uniform sampler2D Source;
+    uniform bool Flip;
+
+    out vec4 color;
+
+    vec3 fetch(ivec2 size, int x, int y) {
+        return texelFetch(Source, ivec2(x, Flip ? size.y - 1 - y : y), 0).rgb;
+    }
+
+    void main() {
+        ivec2 size = textureSize(Source, 0);
+        ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+    #if YUV420P
+        // The output is the Y plane followed by the U and V planes as a single stream of bytes
+        int index = pixel.y * size.x + pixel.x;
+        int luma_size = size.x * size.y;
+        int chroma_size = luma_size / 4;
+
+        if (index < luma_size) {
+            vec3 rgb = fetch(size, index %% size.x, index / size.x);
+            color = vec4((16.0 + dot(rgb, vec3(65.481, 128.553, 24.966))) / 255.0);
+            return;
+        }
+
+        int plane = (index - luma_size) / chroma_size;
+        int chroma = (index - luma_size) %% chroma_size;
+        int x = chroma %% (size.x / 2) * 2;
+        int y = chroma / (size.x / 2) * 2;
+        vec3 rgb = (fetch(size, x, y) + fetch(size, x + 1, y) + fetch(size, x, y + 1) + fetch(size, x + 1, y + 1)) / 4.0;
+
+        if (plane == 0) {
+            color = vec4((128.0 + dot(rgb, vec3(-37.797, -74.203, 112.0))) / 255.0);
+        } else {
+            color = vec4((128.0 + dot(rgb, vec3(112.0, -93.786, -18.214))) / 255.0);
+        }
+    #else
+        color = vec4(fetch(size, pixel.x, pixel.y), 1.0);
+    #endif
+    }
+"""
+
+
+class CaptureStream:
+    def __init__(self):
+        self._framebuffer = None
+        self._format = None
+        self._depth = None
+        self._pending = None
+        self._frames = 0
+        self._errors = None
+        self._copy = None
+        self._source = None
+        self._output = None
+        self._output_fbo = None
+        self._program = None
+        self._vertex_array = None
+        self._file = None
+        self._queue = None
+        self._thread = None
+        self.ctx = None
+        self.extra = None
+        raise TypeError()
+
+    def __del__(self):
+        if not hasattr(self, "ctx"):
+            return
+
+        # The writer thread is stopped whatever the gc_mode is, the objects it uses follow their own policy
+        if self.ctx.gc_mode == "auto":
+            self.release()
+        else:
+            self._stop()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    @property
+    def format(self):
+        return self._format
+
+    @property
+    def frames(self):
+        return self._frames
+
+    def capture(self):
+        if self._thread is None:
+            raise Error("the capture stream was closed")
+
+        if self._errors:
+            raise self._errors[0]
+
+        # Frames are handed to the writer once the ring of pixel pack buffers is full
+        while len(self._pending) >= self._depth:
+            self._queue.put(self._pending.popleft().read())
+
+        if self._copy:
+            self.ctx.copy_framebuffer(self._source, self._framebuffer)
+
+        # The scope is created for every frame so it restores the framebuffer and flags in use right now
+        scope = self.ctx.scope(self._output_fbo, enable_only=0)
+        try:
+            with scope:
+                self._source.use(0)
+                self._vertex_array.render(self.ctx.TRIANGLES, 3)
+        finally:
+            scope.release()
+
+        components = 1 if self._format == "yuv420p" else 3
+        self._pending.append(self._output_fbo.read_async(components=components, buffers=self._depth))
+        self._frames += 1
+
+    def close(self):
+        if self._thread is None:
+            return
+
+        while self._pending:
+            self._queue.put(self._pending.popleft().read())
+
+        self.release()
+
+        if self._errors:
+            raise self._errors[0]
+
+    def release(self):
+        if self._thread is None:
+            return
+
+        # Frames still in the pixel pack buffers are dropped
+        self._pending.clear()
+        self._stop()
+
+        for obj in (self._vertex_array, self._program, self._output_fbo, self._output):
+            obj.release()
+        if self._copy:
+            self._source.release()
+        self._source = None
+
+    def _stop(self):
+        if self._thread is not None:
+            self._queue.put(None)
+            self._thread.join()
+            self._thread = None
+
+    # The writer thread does not reference the stream so an unclosed stream can still be collected
+    @staticmethod
+    def _write_frames(frames, file, errors):
+        while True:
+            frame = frames.get()
+            if frame is None:
+                break
+
+            if errors:
+                continue
+
+            try:
+                if type(file) is int:
+                    view = memoryview(frame)
+                    while view:
+                        view = view[os.write(file, view):]
+                else:
+                    file.write(frame)
+            except Exception as error:
+                errors.append(error)
+
+
 class Program:
     def __init__(self):
         self.mglo = None
@@ -326,6 +893,9 @@ class Program:
         self._is_transform = None
         self._attribute_locations = None
         self._attribute_types = None
+        self._stage = None
+        self._sources = None
+        self._recipe = None
         self.ctx = None
         self.extra = None
         raise TypeError()
@@ -352,6 +922,10 @@ class Program:
     def is_transform(self):
         return self._is_transform
 
+    @property
+    def stage(self):
+        return self._stage
+
     @property
     def geometry_input(self):
         return self._geom[0]
@@ -381,6 +955,159 @@ class Program:
             self.mglo = InvalidObject()
 
 
+class ProgramPipeline:
+    def __init__(self):
+        self.mglo = None
+        self._stages = None
+        self._attribute_locations = None
+        self._attribute_types = None
+        self._glo = None
+        self.ctx = None
+        self.extra = None
+        raise TypeError()
+
+    def __del__(self):
+        if not hasattr(self, "ctx"):
+            return
+
+        if self.ctx.gc_mode == "auto":
+            self.release()
+        elif self.ctx.gc_mode == "context_gc":
+            self.ctx.objects.append(self.mglo)
+
+    def __getitem__(self, kind):
+        return self._stages[kind]
+
+    @property
+    def stages(self):
+        return dict(self._stages)
+
+    @property
+    def is_transform(self):
+        return False
+
+    @property
+    def glo(self):
+        return self._glo
+
+    def release(self):
+        if not isinstance(self.mglo, InvalidObject):
+            self._stages = None
+            self.mglo.release()
+            self.mglo = InvalidObject()
+
+
+class ProgramFamily:
+    def __init__(self):
+        self._sources = None
+        self._schema = None
+        self._usage = None
+        self._options = None
+        self._variants = None
+        self._cache_size = None
+        self.ctx = None
+        self.extra = None
+        raise TypeError()
+
+    def __getitem__(self, defines):
+        return self.get(defines)
+
+    def __len__(self):
+        return len(self._variants)
+
+    def __contains__(self, defines):
+        return self._key(defines) in self._variants
+
+    @property
+    def defines(self):
+        return {name: allowed[0] for name, allowed in self._schema.items()}
+
+    @property
+    def variants(self):
+        return tuple(dict(zip(self._schema, key)) for key in self._variants)
+
+    @property
+    def cache_size(self):
+        return self._cache_size
+
+    def _key(self, defines):
+        for name in defines:
+            if name not in self._schema:
+                raise KeyError(f"unknown define {name!r}")
+
+        key = []
+        for name, allowed in self._schema.items():
+            value = defines.get(name, allowed[0])
+            if len(allowed) > 1 and value not in allowed:
+                raise ValueError(f"invalid value {value!r} for define {name!r}")
+            key.append(value)
+
+        return tuple(key)
+
+    def _source(self, slot, key):
+        source = self._sources[slot]
+        if source is None:
+            return None
+
+        lines = []
+        for name, value in zip(self._schema, key):
+            if name not in self._usage[slot] or value is False or value is None:
+                continue
+            lines.append(f"#define {name} {int(value) if value is True else value}\n")
+
+        if not lines:
+            return source
+
+        # The defines must follow the #version directive, which may come after comments
+        version = re.search(r"^[ \t]*#[ \t]*version\b.*$", source, re.MULTILINE)
+        if version is not None:
+            end = version.end()
+            return source[:end] + "\n" + "".join(lines) + source[end + 1 :]
+
+        return "".join(lines) + source
+
+    def _compile(self, key):
+        # Includes may have changed since the last variant was compiled
+        self._usage = self.ctx._define_usage(self._sources, self._schema)
+
+        varyings, fragment_outputs, attributes, varyings_capture_mode = self._options
+        return self.ctx._program(
+            tuple(self._source(slot, key) for slot in range(5)),
+            varyings,
+            fragment_outputs,
+            attributes,
+            varyings_capture_mode,
+        )
+
+    def get(self, defines=None, **kwargs):
+        if defines is None:
+            defines = {}
+
+        defines = {**defines, **kwargs}
+        key = self._key(defines)
+
+        res = self._variants.get(key)
+        if res is not None:
+            self._variants.move_to_end(key)
+            return res
+
+        res = self._compile(key)
+        res._recipe = lambda: self._compile(key)
+
+        self._variants[key] = res
+        if self._cache_size is not None and len(self._variants) > self._cache_size:
+            # The caller may still hold the evicted program, it is freed by gc_mode
+            self._variants.popitem(last=False)
+
+        return res
+
+    def release(self):
+        if self._variants is not None:
+            for program in self._variants.values():
+                program.release()
+            self._variants.clear()
+
+
 class Renderbuffer:
     def __init__(self):
         self.mglo = None
@@ -587,6 +1314,56 @@ class Scope:
             self.mglo = InvalidObject()
 
 
+class CommandList:
+    def __init__(self):
+        self.mglo = None
+        self.ctx = None
+        self.extra = None
+        raise TypeError()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.end()
+
+    def __len__(self):
+        return self.mglo.size()
+
+    def __del__(self):
+        if not hasattr(self, "ctx"):
+            return
+
+        # A list collected while recording must not keep the context recording, whatever the gc_mode is
+        if not isinstance(self.mglo, InvalidObject):
+            self.mglo.end()
+
+        if self.ctx.gc_mode == "auto":
+            self.release()
+        elif self.ctx.gc_mode == "context_gc":
+            self.ctx.objects.append(self.mglo)
+
+    def end(self):
+        self.mglo.end()
+
+    def execute(self):
+        self.mglo.execute()
+
+    def set_uniform(self, handle, data):
+        self.mglo.set_uniform(handle, data)
+
+    def set_render(self, handle, vertices=None, first=None, instances=None):
+        self.mglo.set_render(handle, vertices, first, instances)
+
+    def set_buffer_offset(self, handle, offset):
+        self.mglo.set_buffer_offset(handle, offset)
+
+    def release(self):
+        if not isinstance(self.mglo, InvalidObject):
+            self.mglo.release()
+            self.mglo = InvalidObject()
+
+
 class Texture:
     def __init__(self):
         self.mglo = None
@@ -707,6 +1484,9 @@ class Texture:
     def build_mipmaps(self, base=0, max_level=1000):
         self.mglo.build_mipmaps(base, max_level)
 
+    def invalidate(self, level=0):
+        self.mglo.invalidate(level)
+
     def use(self, location=0):
         self.mglo.use(location)
 
@@ -1079,6 +1859,7 @@ class VertexArray:
         self._program = None
         self._index_buffer = None
         self._content = None
+        self._vertex_buffers = None
         self._index_element_size = None
         self._glo = None
         self._mode = None
@@ -1144,25 +1925,68 @@ class VertexArray:
     def glo(self):
         return self._glo
 
-    def render(self, mode=None, vertices=-1, first=0, instances=-1):
+    def render(self, mode=None, vertices=-1, first=0, instances=-1, program=None):
         if mode is None:
             mode = self._mode
 
+        program = None if program is None else program.mglo
+
         if self.scope:
             with self.scope:
-                self.mglo.render(mode, vertices, first, instances)
+                return self.mglo.render(mode, vertices, first, instances, program)
         else:
-            self.mglo.render(mode, vertices, first, instances)
+            return self.mglo.render(mode, vertices, first, instances, program)
 
-    def render_indirect(self, buffer, mode=None, count=-1, first=0):
+    def render_base_vertex(self, mode=None, vertices=-1, first=0, base_vertex=0, instances=1, base_instance=0, program=None):
         if mode is None:
             mode = self._mode
 
+        if vertices < 0:
+            vertices = self.vertices
+
+        program = None if program is None else program.mglo
+        args = (mode, vertices, first, base_vertex, instances, base_instance, program)
+
         if self.scope:
             with self.scope:
-                self.mglo.render_indirect(buffer.mglo, mode, count, first)
+                self.mglo.render_base_vertex(*args)
         else:
-            self.mglo.render_indirect(buffer.mglo, mode, count, first)
+            self.mglo.render_base_vertex(*args)
+
+    def render_multi(self, firsts, counts, base_vertices=None, mode=None, program=None):
+        if mode is None:
+            mode = self._mode
+
+        program = None if program is None else program.mglo
+
+        if self.scope:
+            with self.scope:
+                self.mglo.render_multi(mode, firsts, counts, base_vertices, program)
+        else:
+            self.mglo.render_multi(mode, firsts, counts, base_vertices, program)
+
+    def render_indirect(
+        self,
+        buffer,
+        mode=None,
+        count=-1,
+        first=0,
+        count_buffer=None,
+        count_offset=0,
+        max_count=-1,
+        stride=0,
+    ):
+        if mode is None:
+            mode = self._mode
+
+        count_buffer = None if count_buffer is None else count_buffer.mglo
+        args = (buffer.mglo, mode, count, first, count_buffer, count_offset, max_count, stride)
+
+        if self.scope:
+            with self.scope:
+                self.mglo.render_indirect(*args)
+        else:
+            self.mglo.render_indirect(*args)
 
     def transform(self, buffer, mode=None, vertices=-1, first=0, instances=-1, buffer_offset=0):
         if mode is None:
@@ -1170,6 +1994,8 @@ class VertexArray:
 
         if isinstance(buffer, (list, tuple)):
             outputs = [buf.mglo for buf in buffer]
+        elif type(buffer) is TransformFeedback:
+            outputs = buffer.mglo
         else:
             outputs = [buffer.mglo]
 
@@ -1179,18 +2005,206 @@ class VertexArray:
         else:
             self.mglo.transform(outputs, mode, vertices, first, instances, buffer_offset)
 
+    def render_feedback(self, feedback, mode=None, instances=-1, stream=0, program=None):
+        if mode is None:
+            mode = self._mode
+
+        program = None if program is None else program.mglo
+
+        if self.scope:
+            with self.scope:
+                self.mglo.render_feedback(feedback.mglo, mode, instances, stream, program)
+        else:
+            self.mglo.render_feedback(feedback.mglo, mode, instances, stream, program)
+
     def bind(self, attribute, cls, buffer, fmt, offset=0, stride=0, divisor=0, normalize=False):
         self.mglo.bind(attribute, cls, buffer.mglo, fmt, offset, stride, divisor, normalize)
 
+    def bind_vertex_buffer(self, binding, buffer, offset=0, stride=None):
+        self.mglo.bind_vertex_buffer(binding, buffer.mglo, offset, -1 if stride is None else stride)
+        self._vertex_buffers[binding] = buffer
+
+    def bind_vertex_buffers(self, buffers, first=0):
+        bindings = []
+        for item in buffers:
+            if type(item) is Buffer:
+                item = (item,)
+            buffer, offset, stride = tuple(item) + (0, None)[len(item) - 1:]
+            bindings.append((buffer.mglo, offset, -1 if stride is None else stride))
+        self.mglo.bind_vertex_buffers(first, tuple(bindings))
+        for i, item in enumerate(buffers):
+            self._vertex_buffers[first + i] = item if type(item) is Buffer else item[0]
+
     def release(self):
         if not isinstance(self.mglo, InvalidObject):
             self._program = None
             self._index_buffer = None
             self._content = None
+            self._vertex_buffers = None
             self.mglo.release()
             self.mglo = InvalidObject()
 
 
+class MeshPool:
+    def __init__(self):
+        self._program = None
+        self._format = None
+        self._attributes = None
+        self._content = None
+        self._vertex_buffer = None
+        self._index_buffer = None
+        self._index_element_size = None
+        self._vertex_array = None
+        self._num_vertices = 0
+        self._num_indices = 0
+        self._mode = None
+        self.ctx = None
+        self.extra = None
+        raise TypeError()
+
+    @property
+    def vertex_array(self):
+        return self._vertex_array
+
+    @property
+    def vertex_buffer(self):
+        return self._vertex_buffer
+
+    @property
+    def index_buffer(self):
+        return self._index_buffer
+
+    @property
+    def num_vertices(self):
+        return self._num_vertices
+
+    @property
+    def num_indices(self):
+        return self._num_indices
+
+    def add(self, vertices, indices):
+        vertices = memoryview(vertices).cast("B")
+        indices = memoryview(indices).cast("B")
+        stride = self._format.stride
+
+        if len(vertices) % stride or len(indices) % self._index_element_size:
+            raise Error("the vertices and indices do not match the vertex format and index element size")
+
+        vertex_offset = self._num_vertices * stride
+        index_offset = self._num_indices * self._index_element_size
+        self._reserve(vertex_offset + len(vertices), index_offset + len(indices))
+
+        self._vertex_buffer.write(vertices, vertex_offset)
+        self._index_buffer.write(indices, index_offset)
+
+        mesh = (self._num_indices, len(indices) // self._index_element_size, self._num_vertices)
+        self._num_vertices += len(vertices) // stride
+        self._num_indices += mesh[1]
+        return mesh
+
+    def render(self, mesh, instances=1, base_instance=0, mode=None):
+        first_index, index_count, base_vertex = mesh
+        self._vertex_array.render_base_vertex(mode, index_count, first_index, base_vertex, instances, base_instance)
+
+    def clear(self):
+        self._num_vertices = 0
+        self._num_indices = 0
+
+    def _reserve(self, vertex_bytes, index_bytes):
+        vertex_buffer = self._vertex_buffer
+        index_buffer = self._index_buffer
+
+        # Buffers grow geometrically, the used part is copied on the GPU and the vertex array is rebuilt once
+        if vertex_bytes > vertex_buffer.size:
+            vertex_buffer = self.ctx.buffer(reserve=max(vertex_bytes, vertex_buffer.size * 2))
+            if self._num_vertices:
+                self.ctx.copy_buffer(vertex_buffer, self._vertex_buffer, self._num_vertices * self._format.stride)
+
+        if index_bytes > index_buffer.size:
+            index_buffer = self.ctx.buffer(reserve=max(index_bytes, index_buffer.size * 2))
+            if self._num_indices:
+                self.ctx.copy_buffer(index_buffer, self._index_buffer, self._num_indices * self._index_element_size)
+
+        if vertex_buffer is not self._vertex_buffer or index_buffer is not self._index_buffer:
+            self._build(vertex_buffer, index_buffer)
+
+    def _build(self, vertex_buffer, index_buffer):
+        scope = None
+        if self._vertex_array is not None:
+            scope = self._vertex_array.scope
+            self._vertex_array.release()
+        if self._vertex_buffer is not None and self._vertex_buffer is not vertex_buffer:
+            self._vertex_buffer.release()
+        if self._index_buffer is not None and self._index_buffer is not index_buffer:
+            self._index_buffer.release()
+
+        self._vertex_buffer = vertex_buffer
+        self._index_buffer = index_buffer
+        self._vertex_array = self.ctx.vertex_array(
+            self._program,
+            [(vertex_buffer, self._format, *self._attributes), *self._content],
+            index_buffer=index_buffer,
+            index_element_size=self._index_element_size,
+            mode=self._mode,
+        )
+        self._vertex_array.scope = scope
+
+    def release(self):
+        if self._vertex_array is not None:
+            self._vertex_array.release()
+            self._vertex_buffer.release()
+            self._index_buffer.release()
+            self._vertex_array = None
+            self._vertex_buffer = None
+            self._index_buffer = None
+
+
+class VertexFormat(str):
+    def __init__(self):
+        self.mglo = None
+        self._stride = None
+        self._divisor = None
+        self._attributes = None
+        raise TypeError()
+
+    @property
+    def stride(self):
+        return self._stride
+
+    @property
+    def divisor(self):
+        return self._divisor
+
+    @property
+    def attributes(self):
+        return self._attributes
+
+
+class Includes(MutableMapping):
+    def __init__(self, ctx):
+        self._ctx = ctx
+
+    def __getitem__(self, name):
+        return self._ctx.mglo.includes[name]
+
+    def __setitem__(self, name, source):
+        self._ctx.mglo.includes[name] = source
+        self._ctx._includes_changed(name)
+
+    def __delitem__(self, name):
+        del self._ctx.mglo.includes[name]
+        self._ctx._includes_changed(name)
+
+    def __iter__(self):
+        return iter(self._ctx.mglo.includes)
+
+    def __len__(self):
+        return len(self._ctx.mglo.includes)
+
+    def __repr__(self):
+        return repr(self._ctx.mglo.includes)
+
+
 class Context:
     _valid_gc_modes = [None, "context_gc", "auto"]
 
@@ -1284,6 +2298,12 @@ class Context:
         self.extra = None
         self._gc_mode = None
         self._objects = deque()
+        self._specialized_programs = weakref.WeakValueDictionary()
+        self._includes = None
+        self._vertex_formats = {}
+        self._include_dependents = {}
+        self._stale_programs = weakref.WeakSet()
+        self.auto_reload = False
         raise TypeError()
 
     def __del__(self):
@@ -1305,6 +2325,13 @@ class Context:
     def objects(self):
         return self._objects
 
+    @property
+    def shader_cache_stats(self):
+        return self.mglo.shader_cache_stats()
+
+    def clear_shader_cache(self):
+        self.mglo.clear_shader_cache()
+
     def gc(self):
         count = 0
         # Keep iterating until there are no more objects.
@@ -1494,7 +2521,71 @@ class Context:
 
     @property
     def includes(self):
-        return self.mglo.includes
+        if self._includes is None:
+            self._includes = Includes(self)
+
+        return self._includes
+
+    @property
+    def stale_programs(self):
+        return tuple(self._stale_programs)
+
+    def _includes_changed(self, name):
+        self.mglo.invalidate_includes(name)
+        self._stale_programs.update(self._include_dependents.pop(name, ()))
+        if self.auto_reload:
+            self.reload_programs()
+
+    def _define_usage(self, sources, schema):
+        # A define is only injected into the stages that mention it, so stages unaffected
+        # by a define compile to identical sources and share their shader objects.
+        # Includes stay in the variant sources to keep them tracked for hot-reload.
+        usage = []
+        for source in sources:
+            tokens = set()
+            if source is not None:
+                tokens = set(re.findall(r"[A-Za-z_][A-Za-z0-9_]*", self.mglo.preprocess(source)[0]))
+            usage.append(tokens.intersection(schema))
+        return tuple(usage)
+
+    def _track_includes(self, program):
+        for source in program._sources:
+            if isinstance(source, str):
+                for name in self.mglo.preprocess(source)[1]:
+                    self._include_dependents.setdefault(name, weakref.WeakSet()).add(program)
+
+    def reload_programs(self):
+        reloaded = 0
+        for program in tuple(self._stale_programs):
+            if isinstance(program.mglo, InvalidObject):
+                self._stale_programs.discard(program)
+                continue
+
+            # The new GL program is swapped into the existing object so vertex arrays keep working
+            res = program._recipe()
+            program.mglo.swap(res.mglo)
+
+            # Members already handed out are updated in place to point at the new program
+            for name, member in res._members.items():
+                if isinstance(member, Uniform):
+                    member.program = program.mglo
+                previous = program._members.get(name)
+                if type(previous) is type(member):
+                    extra = previous.extra
+                    previous.__dict__.update(member.__dict__)
+                    previous.extra = extra
+                    res._members[name] = previous
+
+            for name in ("_members", "_subroutines", "_geom", "_glo", "_attribute_locations", "_attribute_types", "_sources"):
+                if hasattr(res, name):
+                    setattr(program, name, getattr(res, name))
+            res.release()
+
+            self._stale_programs.discard(program)
+            self._track_includes(program)
+            reloaded += 1
+
+        return reloaded
 
     def clear(self, red=0.0, green=0.0, blue=0.0, alpha=0.0, depth=1.0, viewport=None, color=None):
         if color is not None:
@@ -1520,17 +2611,96 @@ class Context:
     def finish(self):
         self.mglo.finish()
 
+    def reset_framebuffer_state(self):
+        self.mglo.reset_framebuffer_state()
+
     def copy_buffer(self, dst: Buffer, src: Buffer, size=-1, read_offset=0, write_offset=0):
         self.mglo.copy_buffer(dst.mglo, src.mglo, size, read_offset, write_offset)
 
     def copy_framebuffer(self, dst, src):
         self.mglo.copy_framebuffer(dst.mglo, src.mglo)
 
+    def resolve(self, dst, src, attachments="all", depth=True, filter="nearest"):
+        if filter not in ("nearest", "linear"):
+            raise Error("the filter must be nearest or linear")
+
+        if attachments != "all":
+            attachments = tuple(int(attachment) for attachment in attachments)
+        else:
+            attachments = None
+
+        self.mglo.resolve(dst.mglo, src.mglo, attachments, depth, filter == "linear")
+
+    def render_tiled(self, size, render_fn, out, tile=(4096, 4096), components=3, dtype="f1", buffers=3):
+        width, height = size
+        limit = min(self.info["GL_MAX_RENDERBUFFER_SIZE"], *self.info["GL_MAX_VIEWPORT_DIMS"])
+        tile_width = min(tile[0], width, limit)
+        tile_height = min(tile[1], height, limit)
+        pixel_size = mgl.expected_size(1, 1, 1, components, 1, dtype)
+        row_size = width * pixel_size
+
+        if hasattr(out, "seek"):
+            start = out.tell()
+
+            def write(offset, data):
+                out.seek(start + offset)
+                out.write(data)
+
+        else:
+            view = memoryview(out).cast("B")
+            if view.nbytes < row_size * height:
+                raise Error(f"the output is too small, {row_size * height} bytes are required")
+
+            def write(offset, data):
+                view[offset:offset + len(data)] = data
+
+        # Tiles are copied row by row into their place in the output once their readback is done
+        def drain():
+            read, (x, y, w, h) = pending.popleft()
+            data = memoryview(read.read())
+            tile_row_size = w * pixel_size
+            for row in range(h):
+                write((y + row) * row_size + x * pixel_size, data[row * tile_row_size:(row + 1) * tile_row_size])
+
+        previous = self.fbo
+        fbo = self.simple_framebuffer((tile_width, tile_height), components, dtype=dtype)
+        pending = deque()
+
+        try:
+            for y in range(0, height, tile_height):
+                for x in range(0, width, tile_width):
+                    w = min(tile_width, width - x)
+                    h = min(tile_height, height - y)
+                    fbo.use()
+                    fbo.viewport = (0, 0, w, h)
+
+                    # Maps the clip space of the whole image to the clip space of the tile
+                    matrix = (
+                        width / w, 0.0, 0.0, 0.0,
+                        0.0, height / h, 0.0, 0.0,
+                        0.0, 0.0, 1.0, 0.0,
+                        (width - 2 * x - w) / w, (height - 2 * y - h) / h, 0.0, 1.0,
+                    )
+                    render_fn(fbo, (x, y, w, h), matrix)
+
+                    if len(pending) == buffers:
+                        drain()
+                    pending.append((fbo.read_async((w, h), components, dtype=dtype, buffers=buffers), (x, y, w, h)))
+
+            while pending:
+                drain()
+        finally:
+            fbo.release()
+            if previous is not None:
+                previous.use()
+
     def detect_framebuffer(self, glo=None):
         res = Framebuffer.__new__(Framebuffer)
         res.mglo, res._size, res._samples, res._glo = self.mglo.detect_framebuffer(glo)
         res._color_attachments = None
         res._depth_attachment = None
+        res._readbacks = None
+        res._pick_readback = None
         res.ctx = self
         res._is_reference = True
         res.extra = None
@@ -1658,6 +2828,7 @@ class Context:
         for buffer, layout, *attribs in content:
             if layout is None:
                 layout = detect_format(program, attribs)
+            layout = self.vertex_format(layout)
             if skip_errors:
                 attribs = [
                     types.get(x, None) if type(x) is int else types.get(locations.get(x, -1), None)
@@ -1665,7 +2836,7 @@ class Context:
                 ]
             else:
                 attribs = [types[x] if type(x) is int else types[locations[x]] for x in attribs]
-            mgl_content.append((buffer.mglo, layout, *attribs))
+            mgl_content.append((buffer.mglo, layout.mglo, *attribs))
 
         res = VertexArray.__new__(VertexArray)
         res.mglo, res._glo = self.mglo.vertex_array(
@@ -1677,6 +2848,7 @@ class Context:
         res._program = program
         res._index_buffer = index_buffer
         res._content = content
+        res._vertex_buffers = [buffer for buffer, *_ in content]
         res._index_element_size = index_element_size
         if mode is not None:
             res._mode = mode
@@ -1687,6 +2859,87 @@ class Context:
         res.scope = None
         return res
 
+    def transform_feedback(self, buffers, streams=1):
+        outputs = []
+        for item in buffers:
+            if type(item) is Buffer:
+                item = (item,)
+            buffer, offset, size = tuple(item) + (0, -1)[len(item) - 1:]
+            outputs.append((buffer.mglo, offset, size))
+
+        res = TransformFeedback.__new__(TransformFeedback)
+        res.mglo, res._glo = self.mglo.transform_feedback(tuple(outputs), streams)
+        res._outputs = [item if type(item) is Buffer else item[0] for item in buffers]
+        res.ctx = self
+        res.extra = None
+        return res
+
+    def feedback_loop(self, program, buffers, fmt, attributes, mode=None, vertices=-1, content=()):
+        if isinstance(attributes, str):
+            attributes = (attributes,)
+        if mode is None:
+            mode = self.POINTS
+
+        first, second = buffers
+        vertex_arrays = (
+            self.vertex_array(program, [(first, fmt, *attributes), *content], mode=mode),
+            self.vertex_array(program, [(second, fmt, *attributes), *content], mode=mode),
+        )
+        feedbacks = (self.transform_feedback([second]), self.transform_feedback([first]))
+
+        res = FeedbackLoop.__new__(FeedbackLoop)
+        res.mglo = self.mglo.feedback_loop(
+            vertex_arrays[0].mglo,
+            vertex_arrays[1].mglo,
+            feedbacks[0].mglo,
+            feedbacks[1].mglo,
+            mode,
+            vertices,
+        )
+        res._buffers = (first, second)
+        res._vertex_arrays = vertex_arrays
+        res._feedbacks = feedbacks
+        res._vertices = vertices
+        res._render_arrays = {}
+        res.ctx = self
+        res.extra = None
+        return res
+
+    def mesh_pool(self, program, fmt, attributes, vertices=4096, indices=16384, index_element_size=4, content=(), mode=None):
+        if isinstance(attributes, str):
+            attributes = (attributes,)
+
+        res = MeshPool.__new__(MeshPool)
+        res._program = program
+        res._format = self.vertex_format(fmt)
+        res._attributes = tuple(attributes)
+        res._content = tuple(content)
+        res._vertex_buffer = None
+        res._index_buffer = None
+        res._index_element_size = index_element_size
+        res._vertex_array = None
+        res._num_vertices = 0
+        res._num_indices = 0
+        res._mode = mode
+        res.ctx = self
+        res.extra = None
+        res._build(
+            self.buffer(reserve=max(vertices, 1) * res._format.stride),
+            self.buffer(reserve=max(indices, 1) * index_element_size),
+        )
+        return res
+
+    def vertex_format(self, fmt):
+        res = self._vertex_formats.get(fmt)
+        if res is None:
+            res = VertexFormat.__new__(VertexFormat, fmt)
+            res.mglo = self.mglo.vertex_format(fmt)
+            res._stride = res.mglo.size
+            res._divisor = res.mglo.divisor
+            res._attributes = res.mglo.attributes
+            self._vertex_formats[fmt] = res
+        return res
+
     def simple_vertex_array(self, program, buffer, *attributes, index_buffer=None, index_element_size=4, mode=None):
         if type(buffer) is list:
             raise SyntaxError("Change simple_vertex_array to vertex_array")
@@ -1705,6 +2958,7 @@ class Context:
         fragment_outputs=None,
         attributes=None,
         varyings_capture_mode="interleaved",
+        specialization=None,
     ):
         if varyings_capture_mode not in ("interleaved", "separate"):
             raise ValueError("varyings_capture_mode must be interleaved or separate")
@@ -1723,6 +2977,67 @@ class Context:
         if isinstance(fragment_shader, str):
             fragment_shader = fragment_shader.strip()
 
+        shaders = (vertex_shader, fragment_shader, geometry_shader, tess_control_shader, tess_evaluation_shader)
+
+        if specialization is None:
+            return self._program(shaders, varyings, fragment_outputs, attributes, varyings_capture_mode)
+
+        # Specialized programs are cached per constant values
+        key = None
+        if all(shader is None or isinstance(shader, (str, bytes)) for shader in shaders):
+            key = (
+                shaders,
+                varyings,
+                tuple(sorted(fragment_outputs.items())),
+                attributes if attributes is None else tuple(attributes),
+                varyings_capture_mode,
+                tuple(sorted(specialization.items())),
+            )
+            res = self._specialized_programs.get(key)
+            if res is not None and not isinstance(res.mglo, InvalidObject):
+                return res
+
+        res = self._program(
+            shaders,
+            varyings,
+            fragment_outputs,
+            attributes,
+            varyings_capture_mode,
+            specialization=specialization,
+        )
+
+        if key is not None:
+            self._specialized_programs[key] = res
+
+        return res
+
+    def _program(
+        self,
+        shaders,
+        varyings,
+        fragment_outputs,
+        attributes,
+        varyings_capture_mode,
+        specialization=None,
+        separable=False,
+    ):
+        vertex_shader, fragment_shader, geometry_shader, tess_control_shader, tess_evaluation_shader = shaders
+
+        def recipe():
+            return self._program(
+                shaders,
+                varyings,
+                fragment_outputs,
+                attributes,
+                varyings_capture_mode,
+                specialization,
+                separable,
+            )
+
+        constants = None
+        if specialization is not None:
+            constants = _specialization_constants(shaders + (None,), specialization)
+
         res = Program.__new__(Program)
         res.mglo, _members, res._subroutines, res._geom, res._glo = self.mglo.program(
             vertex_shader,
@@ -1734,6 +3049,8 @@ class Context:
             varyings,
             fragment_outputs,
             varyings_capture_mode == "interleaved",
+            constants,
+            separable,
         )
         res._members, res._attribute_locations, res._attribute_types = _members
 
@@ -1748,6 +3065,99 @@ class Context:
                 res._attribute_locations[name] = i
 
         res._is_transform = fragment_shader is None
+        res._stage = None
+        res._sources = shaders
+        res._recipe = recipe
+        res.ctx = self
+        res.extra = None
+        self._track_includes(res)
+        return res
+
+    def shader_stage(self, kind, source, specialization=None):
+        stages = ("vertex", "fragment", "geometry", "tess_control", "tess_evaluation")
+        if kind not in stages:
+            raise ValueError(f"invalid shader stage {kind!r}")
+
+        if isinstance(source, str):
+            source = source.strip()
+
+        shaders = tuple(source if stage == kind else None for stage in stages)
+        res = self._program(shaders, (), {}, None, "interleaved", specialization=specialization, separable=True)
+        res._is_transform = False
+        res._stage = kind
+        return res
+
+    def pipeline(self, *stages):
+        kinds = ("vertex", "fragment", "geometry", "tess_control", "tess_evaluation")
+        programs = {}
+        for stage in stages:
+            if stage._stage is None:
+                raise ValueError("pipelines are composed of programs created with Context.shader_stage")
+            if stage._stage in programs:
+                raise ValueError(f"duplicate {stage._stage} stage")
+            programs[stage._stage] = stage
+
+        res = ProgramPipeline.__new__(ProgramPipeline)
+        res.mglo, res._glo = self.mglo.pipeline(
+            tuple(programs[kind].mglo if kind in programs else None for kind in kinds)
+        )
+        res._stages = programs
+        res._attribute_locations = {}
+        res._attribute_types = {}
+        if "vertex" in programs:
+            res._attribute_locations = programs["vertex"]._attribute_locations
+            res._attribute_types = programs["vertex"]._attribute_types
+        res.ctx = self
+        res.extra = None
+        return res
+
+    def program_family(
+        self,
+        sources,
+        defines_schema=None,
+        varyings=(),
+        fragment_outputs=None,
+        attributes=None,
+        varyings_capture_mode="interleaved",
+        cache_size=64,
+    ):
+        if varyings_capture_mode not in ("interleaved", "separate"):
+            raise ValueError("varyings_capture_mode must be interleaved or separate")
+
+        slots = ("vertex_shader", "fragment_shader", "geometry_shader", "tess_control_shader", "tess_evaluation_shader")
+        for name in sources:
+            if name not in slots:
+                raise ValueError(f"invalid shader stage {name!r}")
+
+        schema = {}
+        for name, allowed in (defines_schema or {}).items():
+            if isinstance(allowed, (list, tuple, range)):
+                allowed = tuple(allowed)
+                if not allowed:
+                    raise ValueError(f"define {name!r} has no allowed values")
+            else:
+                allowed = (allowed,)
+            schema[name] = allowed
+
+        stage_sources = []
+        for slot in slots:
+            source = sources.get(slot)
+            if source is not None:
+                if not isinstance(source, str):
+                    raise ValueError("program families require GLSL source strings")
+                source = source.strip()
+            stage_sources.append(source)
+
+        if type(varyings) is str:
+            varyings = (varyings,)
+
+        res = ProgramFamily.__new__(ProgramFamily)
+        res._sources = tuple(stage_sources)
+        res._schema = schema
+        res._usage = self._define_usage(stage_sources, schema)
+        res._options = (tuple(varyings), fragment_outputs or {}, attributes, varyings_capture_mode)
+        res._variants = OrderedDict()
+        res._cache_size = cache_size
         res.ctx = self
         res.extra = None
         return res
@@ -1774,6 +3184,7 @@ class Context:
         storage_buffers=(),
         samplers=(),
         enable=None,
+        discard_on_end=(),
     ):
         if enable is not None:
             enable_only = enable
@@ -1795,6 +3206,7 @@ class Context:
             mgl_uniform_buffers,
             mgl_storage_buffers,
             samplers,
+            framebuffer._attachment_indices(discard_on_end),
         )
         res.ctx = self
         res._framebuffer = framebuffer
@@ -1805,6 +3217,13 @@ class Context:
         res.extra = None
         return res
 
+    def record(self):
+        res = CommandList.__new__(CommandList)
+        res.mglo = self.mglo.record()
+        res.ctx = self
+        res.extra = None
+        return res
+
     def simple_framebuffer(self, size, components=4, samples=0, dtype="f1"):
         return self.framebuffer(
             self.renderbuffer(size, components, samples=samples, dtype=dtype),
@@ -1812,16 +3231,28 @@ class Context:
         )
 
     def framebuffer(self, color_attachments=(), depth_attachment=None):
-        if type(color_attachments) is Texture or type(color_attachments) is Renderbuffer:
+        if type(color_attachments) in (Texture, Renderbuffer, TextureArray, TextureCube, Texture3D):
+            color_attachments = (color_attachments,)
+
+        # A single (texture, layer) tuple selects one layer of a texture
+        if type(color_attachments) is tuple and len(color_attachments) == 2 and type(color_attachments[1]) is int:
             color_attachments = (color_attachments,)
 
-        ca_mglo = tuple(x.mglo for x in color_attachments)
-        da_mglo = None if depth_attachment is None else depth_attachment.mglo
+        def attachment_mglo(attachment):
+            if type(attachment) is tuple:
+                image, layer = attachment
+                return (image.mglo, layer)
+            return attachment.mglo
+
+        ca_mglo = tuple(attachment_mglo(x) for x in color_attachments)
+        da_mglo = None if depth_attachment is None else attachment_mglo(depth_attachment)
 
         res = Framebuffer.__new__(Framebuffer)
         res.mglo, res._size, res._samples, res._glo = self.mglo.framebuffer(ca_mglo, da_mglo)
         res._color_attachments = tuple(color_attachments)
         res._depth_attachment = depth_attachment
+        res._readbacks = None
+        res._pick_readback = None
         res.ctx = self
         res._is_reference = False
         res.extra = None
@@ -1832,6 +3263,8 @@ class Context:
         res.mglo, res._size, res._samples, res._glo = self.mglo.empty_framebuffer(size, layers, samples)
         res._color_attachments = ()
         res._depth_attachment = None
+        res._readbacks = None
+        res._pick_readback = None
         res.ctx = self
         res._is_reference = False
         res.extra = None
@@ -1861,7 +3294,18 @@ class Context:
         res.extra = None
         return res
 
-    def compute_shader(self, source):
+    def compute_shader(self, source, specialization=None):
+        key = None
+        constants = None
+        if specialization is not None:
+            if isinstance(source, (str, bytes)):
+                key = (source, tuple(sorted(specialization.items())))
+                res = self._specialized_programs.get(key)
+                if res is not None and not isinstance(res.mglo, InvalidObject):
+                    return res
+
+            constants = _specialization_constants((None, None, None, None, None, source), specialization)
+
         res = ComputeShader.__new__(ComputeShader)
         res.mglo, _members, _, _, res._glo = self.mglo.program(
             None,
@@ -1873,11 +3317,19 @@ class Context:
             (),
             {},
             False,
+            constants,
         )
         res._members = _members[0]
+        res._sources = (source,)
+        res._recipe = lambda: self.compute_shader(source, specialization)
 
         res.ctx = self
         res.extra = None
+        self._track_includes(res)
+
+        if key is not None:
+            self._specialized_programs[key] = res
+
         return res
 
     def sampler(
@@ -1940,6 +3392,7 @@ class Context:
         if _store.default_context is self:
             _store.default_context = None
         if not isinstance(self.mglo, InvalidObject):
+            self.mglo.clear_shader_cache()
             self.mglo.release()
             self.mglo = InvalidObject()
 
@@ -1967,6 +3420,12 @@ def create_context(require=None, standalone=False, share=False, **settings):
     ctx.extra = None
     ctx._gc_mode = None
     ctx._objects = deque()
+    ctx._specialized_programs = weakref.WeakValueDictionary()
+    ctx._includes = None
+    ctx._vertex_formats = {}
+    ctx._include_dependents = {}
+    ctx._stale_programs = weakref.WeakSet()
+    ctx.auto_reload = False
 
     if ctx.version_code < require:
         raise ValueError("Requested OpenGL version {0}, got version {1}".format(require, ctx.version_code))
@@ -1997,6 +3456,12 @@ def init_context(loader=None):
     ctx.extra = None
     ctx._gc_mode = None
     ctx._objects = deque()
+    ctx._specialized_programs = weakref.WeakValueDictionary()
+    ctx._includes = None
+    ctx._vertex_formats = {}
+    ctx._include_dependents = {}
+    ctx._stale_programs = weakref.WeakSet()
+    ctx.auto_reload = False
 
     ctx._screen = ctx.detect_framebuffer(0)
     ctx.fbo = ctx.detect_framebuffer()
@@ -2014,7 +3479,41 @@ def create_standalone_context(**kwargs):
     return create_context(standalone=True, **kwargs)
 
 
+def _specialization_constants(shaders, specialization):
+    result = []
+    found = set()
+    for shader in shaders:
+        constants = None
+        if isinstance(shader, bytes) and int.from_bytes(shader[:4], "little") == 0x07230203:
+            reflected = _parse_spv_constants(shader)
+            constants = _pack_spv_constants(reflected, specialization)
+            found.update(reflected)
+        result.append(constants)
+
+    for constant_id in specialization:
+        if constant_id not in found:
+            raise KeyError(f"unknown specialization constant {constant_id}")
+
+    return tuple(result)
+
+
+def pack_draw_commands(counts, instances=1, first=0, base_vertex=0, base_instance=0, indexed=False):
+    return mgl.pack_draw_commands(counts, instances, first, base_vertex, base_instance, indexed)
+
+
+def quantize(data, fmt):
+    return mgl.quantize(data, fmt)
+
+
 def detect_format(program, attributes, mode="mgl"):
+    if mode == "mgl":
+        if type(program) is ProgramPipeline:
+            program = program._stages.get("vertex", program)
+        # Formats are detected natively and memoized per program and attribute names
+        if type(program) is Program and not isinstance(program.mglo, InvalidObject):
+            fmt = program.mglo.detect_format(tuple(attributes), program._attribute_locations, program._attribute_types)
+            return program.ctx.vertex_format(fmt)
+
     def fmt(attr):
         # Translate shape format into attribute format
         mgl_fmt = {"d": "f8", "I": "u"}
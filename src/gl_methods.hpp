@@ -2587,5 +2587,14 @@ GLMethods load_gl_methods(PyObject * loader) {
 
     #undef load
 
+    // Indirect count drawing is core in OpenGL 4.6 and available on older drivers as ARB_indirect_parameters
+    if (!res.MultiDrawArraysIndirectCount) {
+        res.MultiDrawArraysIndirectCount = (PFNGLMULTIDRAWARRAYSINDIRECTCOUNTPROC)load_opengl_function(loader, method, "glMultiDrawArraysIndirectCountARB");
+    }
+
+    if (!res.MultiDrawElementsIndirectCount) {
+        res.MultiDrawElementsIndirectCount = (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)load_opengl_function(loader, method, "glMultiDrawElementsIndirectCountARB");
+    }
+
     return res;
 };
@@ -10,17 +10,23 @@
 static PyObject * helper;
 static PyObject * moderngl_error;
 static PyTypeObject * MGLBuffer_type;
+static PyTypeObject * MGLCommandList_type;
 static PyTypeObject * MGLContext_type;
+static PyTypeObject * MGLFeedbackLoop_type;
 static PyTypeObject * MGLFramebuffer_type;
 static PyTypeObject * MGLProgram_type;
+static PyTypeObject * MGLProgramPipeline_type;
 static PyTypeObject * MGLQuery_type;
+static PyTypeObject * MGLReadback_type;
 static PyTypeObject * MGLRenderbuffer_type;
 static PyTypeObject * MGLScope_type;
 static PyTypeObject * MGLTexture_type;
 static PyTypeObject * MGLTextureArray_type;
 static PyTypeObject * MGLTextureCube_type;
 static PyTypeObject * MGLTexture3D_type;
+static PyTypeObject * MGLTransformFeedback_type;
 static PyTypeObject * MGLVertexArray_type;
+static PyTypeObject * MGLVertexFormat_type;
 static PyTypeObject * MGLSampler_type;
 
 enum MGLEnableFlag {
@@ -52,7 +58,11 @@ static const int SHADER_TYPE[] = {
     GL_COMPUTE_SHADER,
 };
 
+// The number of expanded sources memoized per context, hot-reloaded sources would grow it without limit
+static const int INCLUDE_CACHE_SIZE = 256;
+
 struct MGLBuffer;
+struct MGLCommandList;
 struct MGLContext;
 struct MGLFramebuffer;
 struct MGLProgram;
@@ -82,13 +92,35 @@ struct MGLBuffer {
     bool external;
 };
 
+struct Rect {
+    int x, y, width, height;
+};
+
+// The framebuffer state last applied to the GL context, valid is false when it is unknown
+struct MGLFramebufferState {
+    int framebuffer_obj;
+    Rect viewport;
+    Rect scissor;
+    bool scissor_enabled;
+    char color_mask[64];
+    bool depth_mask;
+    bool valid;
+};
+
 struct MGLContext {
     PyObject_HEAD
     PyObject * ctx;
     PyObject * extensions;
     MGLFramebuffer * default_framebuffer;
     MGLFramebuffer * bound_framebuffer;
+    MGLFramebufferState framebuffer_state;
     PyObject * includes;
+    PyObject * include_cache;
+    MGLCommandList * recording;
+    struct MGLTransformFeedback * capturing;
+    PyObject * shader_cache;
+    long long shader_cache_hits;
+    long long shader_cache_misses;
     int version_code;
     int max_samples;
     int max_integer_samples;
@@ -113,10 +145,6 @@ struct MGLContext {
     bool released;
 };
 
-struct Rect {
-    int x, y, width, height;
-};
-
 static Rect rect(int x, int y, int width, int height) {
     Rect rect;
     rect.x = x;
@@ -224,6 +252,17 @@ struct MGLFramebuffer {
     bool released;
 };
 
+struct MGLReadback {
+    PyObject_HEAD
+    MGLContext * context;
+    int buffer_obj;
+    Py_ssize_t capacity;
+    Py_ssize_t size;
+    GLsync sync;
+    long long generation;
+    bool released;
+};
+
 struct MGLProgram {
     PyObject_HEAD
     MGLContext * context;
@@ -232,10 +271,21 @@ struct MGLProgram {
     int program_obj;
     int geometry_vertices;
     int num_varyings;
+    PyObject * vertex_formats;
+    PyObject * cached_shaders;
+    int pipelines;
     bool compute;
     bool released;
 };
 
+struct MGLProgramPipeline {
+    PyObject_HEAD
+    MGLContext * context;
+    MGLProgram * stages[5];
+    int pipeline_obj;
+    bool released;
+};
+
 enum MGLQueryKeys {
     SAMPLES_PASSED,
     ANY_SAMPLES_PASSED,
@@ -258,6 +308,32 @@ struct MGLQuery {
     bool released;
 };
 
+struct MGLTransformFeedback {
+    PyObject_HEAD
+    MGLContext * context;
+    PyObject * outputs;
+    int transform_feedback_obj;
+    int query_obj[4];
+    int num_streams;
+    int program_obj;
+    int primitive_mode;
+    bool active;
+    bool captured;
+    bool released;
+};
+
+struct MGLFeedbackLoop {
+    PyObject_HEAD
+    MGLContext * context;
+    struct MGLVertexArray * vertex_arrays[2];
+    MGLTransformFeedback * feedbacks[2];
+    int current;
+    int mode;
+    int output_mode;
+    int vertices;
+    bool released;
+};
+
 struct MGLRenderbuffer {
     PyObject_HEAD
     MGLContext * context;
@@ -297,10 +373,12 @@ struct MGLScope {
     BufferBinding * uniform_buffers;
     BufferBinding * storage_buffers;
     SamplerBinding * samplers;
+    unsigned discard_attachments[66];
     int num_textures;
     int num_uniform_buffers;
     int num_storage_buffers;
     int num_samplers;
+    int num_discard_attachments;
     int enable_flags;
     int old_enable_flags;
     bool released;
@@ -380,19 +458,45 @@ struct MGLTextureCube {
     bool released;
 };
 
+struct MGLVertexBinding {
+    int size;
+    int stride;
+    int divisor;
+    int vertices;
+};
+
 struct MGLVertexArray {
     PyObject_HEAD
     MGLContext * context;
     MGLProgram * program;
+    MGLProgramPipeline * pipeline;
     MGLBuffer * index_buffer;
+    MGLVertexBinding * bindings;
+    int num_bindings;
     int index_element_size;
     int index_element_type;
     int vertex_array_obj;
     int num_vertices;
     int num_instances;
+    bool attrib_binding;
     bool released;
 };
 
+// Without an index buffer the vertex count is limited by the smallest per-vertex binding
+static void MGLVertexArray_update_vertices(MGLVertexArray * self) {
+    if (self->index_buffer != (MGLBuffer *)Py_None) {
+        return;
+    }
+
+    self->num_vertices = -1;
+    for (int i = 0; i < self->num_bindings; ++i) {
+        MGLVertexBinding & binding = self->bindings[i];
+        if (!binding.divisor && (self->num_vertices < 0 || binding.vertices < self->num_vertices)) {
+            self->num_vertices = binding.vertices;
+        }
+    }
+}
+
 struct MGLSampler {
     PyObject_HEAD
     MGLContext * context;
@@ -410,6 +514,224 @@ struct MGLSampler {
     bool released;
 };
 
+enum MGLCommandType {
+    MGL_COMMAND_RENDER,
+    MGL_COMMAND_UNIFORM,
+    MGL_COMMAND_BIND_BUFFER,
+    MGL_COMMAND_BIND_TEXTURE,
+    MGL_COMMAND_BIND_SAMPLER,
+    MGL_COMMAND_USE_FRAMEBUFFER,
+    MGL_COMMAND_CLEAR,
+    MGL_COMMAND_CLEAR_ATTACHMENTS,
+    MGL_COMMAND_INVALIDATE_FRAMEBUFFER,
+    MGL_COMMAND_INVALIDATE_TEXTURE,
+    MGL_COMMAND_COMPUTE,
+    MGL_COMMAND_SCOPE_BEGIN,
+    MGL_COMMAND_SCOPE_END,
+};
+
+struct AttachmentClear {
+    int index;
+    int kind;
+    union {
+        float f[4];
+        int i[4];
+        unsigned u[4];
+    } value;
+};
+
+struct MGLRenderCommand {
+    MGLVertexArray * vertex_array;
+    PyObject * program;
+    int mode;
+    int vertices;
+    int first;
+    int instances;
+};
+
+struct MGLUniformCommand {
+    MGLProgram * program;
+    int location;
+    int gl_type;
+    int array_length;
+    int size;
+    Py_ssize_t data;
+};
+
+struct MGLBindBufferCommand {
+    int target;
+    int binding;
+    int buffer_obj;
+    Py_ssize_t offset;
+    Py_ssize_t size;
+};
+
+struct MGLBindTextureCommand {
+    int target;
+    int texture_obj;
+    int unit;
+};
+
+struct MGLBindSamplerCommand {
+    int sampler_obj;
+    int unit;
+};
+
+struct MGLClearCommand {
+    MGLFramebuffer * framebuffer;
+    float color[4];
+    float depth;
+    Rect viewport;
+    bool has_viewport;
+};
+
+struct MGLClearAttachmentsCommand {
+    MGLFramebuffer * framebuffer;
+    int num_colors;
+    Py_ssize_t colors;
+    float depth;
+    int stencil;
+    bool has_depth;
+    bool has_stencil;
+};
+
+struct MGLInvalidateFramebufferCommand {
+    MGLFramebuffer * framebuffer;
+    int num_attachments;
+    Py_ssize_t attachments;
+    Rect viewport;
+    bool has_viewport;
+};
+
+struct MGLInvalidateTextureCommand {
+    int texture_obj;
+    int level;
+};
+
+struct MGLComputeCommand {
+    MGLProgram * program;
+    unsigned x;
+    unsigned y;
+    unsigned z;
+};
+
+struct MGLCommand {
+    int type;
+    union {
+        MGLRenderCommand render;
+        MGLUniformCommand uniform;
+        MGLBindBufferCommand bind_buffer;
+        MGLBindTextureCommand bind_texture;
+        MGLBindSamplerCommand bind_sampler;
+        MGLFramebuffer * framebuffer;
+        MGLClearCommand clear;
+        MGLClearAttachmentsCommand clear_attachments;
+        MGLInvalidateFramebufferCommand invalidate_framebuffer;
+        MGLInvalidateTextureCommand invalidate_texture;
+        MGLComputeCommand compute;
+        MGLScope * scope;
+    };
+};
+
+struct MGLCommandList {
+    PyObject_HEAD
+    MGLContext * context;
+    PyObject * objects;
+    MGLCommand * commands;
+    int num_commands;
+    int max_commands;
+    char * data;
+    Py_ssize_t data_size;
+    Py_ssize_t data_capacity;
+    bool released;
+};
+
+// While a command list is recording the calls below are parsed, appended to it and return a command handle
+// The objects used by the commands are kept alive by the command list
+
+static MGLCommand * record_command(MGLContext * context, int type, PyObject * object) {
+    MGLCommandList * self = context->recording;
+    if (self->num_commands == self->max_commands) {
+        self->max_commands = MGL_MAX(self->max_commands * 2, 64);
+        self->commands = (MGLCommand *)PyMem_Realloc(self->commands, self->max_commands * sizeof(MGLCommand));
+    }
+    MGLCommand * command = &self->commands[self->num_commands++];
+    memset(command, 0, sizeof(MGLCommand));
+    command->type = type;
+    if (object) {
+        PyList_Append(self->objects, object);
+    }
+    return command;
+}
+
+static PyObject * record_handle(MGLContext * context) {
+    return PyLong_FromLong(context->recording->num_commands - 1);
+}
+
+// Variable sized parameters are copied into the data of the command list and referenced by offset
+static Py_ssize_t record_data(MGLContext * context, const void * data, Py_ssize_t size) {
+    MGLCommandList * self = context->recording;
+    if (self->data_size + size > self->data_capacity) {
+        self->data_capacity = MGL_MAX(self->data_capacity * 2, self->data_size + size);
+        self->data = (char *)PyMem_Realloc(self->data, self->data_capacity);
+    }
+    Py_ssize_t offset = self->data_size;
+    memcpy(self->data + offset, data, size);
+    self->data_size += size;
+    return offset;
+}
+
+static PyObject * record_render(MGLVertexArray * vertex_array, int mode, int vertices, int first, int instances, PyObject * program) {
+    MGLCommand * command = record_command(vertex_array->context, MGL_COMMAND_RENDER, (PyObject *)vertex_array);
+    command->render.vertex_array = vertex_array;
+    command->render.program = program;
+    command->render.mode = mode;
+    command->render.vertices = vertices;
+    command->render.first = first;
+    command->render.instances = instances;
+
+    PyList_Append(vertex_array->context->recording->objects, program);
+    return record_handle(vertex_array->context);
+}
+
+static PyObject * record_uniform(MGLContext * context, MGLProgram * program, int location, int gl_type, int array_length, Py_buffer * view) {
+    MGLCommand * command = record_command(context, MGL_COMMAND_UNIFORM, (PyObject *)program);
+    command->uniform.program = program;
+    command->uniform.location = location;
+    command->uniform.gl_type = gl_type;
+    command->uniform.array_length = array_length;
+    command->uniform.size = (int)view->len;
+    command->uniform.data = record_data(context, view->buf, view->len);
+    return record_handle(context);
+}
+
+static PyObject * record_bind_buffer(MGLContext * context, PyObject * buffer, int target, int binding, int buffer_obj, Py_ssize_t offset, Py_ssize_t size) {
+    MGLCommand * command = record_command(context, MGL_COMMAND_BIND_BUFFER, buffer);
+    command->bind_buffer.target = target;
+    command->bind_buffer.binding = binding;
+    command->bind_buffer.buffer_obj = buffer_obj;
+    command->bind_buffer.offset = offset;
+    command->bind_buffer.size = size;
+    return record_handle(context);
+}
+
+static PyObject * record_bind_texture(MGLContext * context, PyObject * texture, int target, int texture_obj, int unit) {
+    MGLCommand * command = record_command(context, MGL_COMMAND_BIND_TEXTURE, texture);
+    command->bind_texture.target = target;
+    command->bind_texture.texture_obj = texture_obj;
+    command->bind_texture.unit = unit;
+    return record_handle(context);
+}
+
+// Context setters and the draw calls without a command type cannot be replayed, they must not silently run while recording
+static bool check_not_recording(MGLContext * context) {
+    if (context->recording) {
+        MGLError_Set("this call cannot be recorded into a command list");
+        return false;
+    }
+    return true;
+}
+
 static void clean_glsl_name(char * name, int & name_len) {
     if (name_len && name[name_len - 1] == ']') {
         name_len -= 1;
@@ -561,6 +883,7 @@ FormatInfo FormatIterator::info() {
 
 FormatNode * FormatIterator::next() {
     node.count = 0;
+    bool normalize = false;
     while (true) {
         char chr = *ptr++;
         switch (chr) {
@@ -578,6 +901,18 @@ FormatNode * FormatIterator::next() {
                 break;
 
             case 'f':
+                // f11 packs three unsigned floats into 32 bits
+                if (ptr[0] == '1' && ptr[1] == '1') {
+                    ptr += 2;
+                    if ((*ptr && *ptr != ' ' && *ptr != '/') || (node.count && node.count != 3)) {
+                        return InvalidFormat;
+                    }
+                    node.count = 3;
+                    node.size = 4;
+                    node.type = GL_UNSIGNED_INT_10F_11F_11F_REV;
+                    node.normalize = false;
+                    return &node;
+                }
                 if (node.count == 0) {
                     node.count = 1;
                 }
@@ -628,10 +963,22 @@ FormatNode * FormatIterator::next() {
                 return &node;
 
             case 'i':
+                // i10 packs four signed integers into 32 bits (10:10:10:2)
+                if (ptr[0] == '1' && ptr[1] == '0') {
+                    ptr += 2;
+                    if ((*ptr && *ptr != ' ' && *ptr != '/') || (node.count && node.count != 4)) {
+                        return InvalidFormat;
+                    }
+                    node.count = 4;
+                    node.size = 4;
+                    node.type = GL_INT_2_10_10_10_REV;
+                    node.normalize = normalize;
+                    return &node;
+                }
                 if (node.count == 0) {
                     node.count = 1;
                 }
-                node.normalize = false;
+                node.normalize = normalize;
                 switch (*ptr++) {
                     case '1':
                         if (*ptr && *ptr != ' ' && *ptr != '/') {
@@ -667,10 +1014,22 @@ FormatNode * FormatIterator::next() {
                 return &node;
 
             case 'u':
+                // u10 packs four unsigned integers into 32 bits (10:10:10:2)
+                if (ptr[0] == '1' && ptr[1] == '0') {
+                    ptr += 2;
+                    if ((*ptr && *ptr != ' ' && *ptr != '/') || (node.count && node.count != 4)) {
+                        return InvalidFormat;
+                    }
+                    node.count = 4;
+                    node.size = 4;
+                    node.type = GL_UNSIGNED_INT_2_10_10_10_REV;
+                    node.normalize = normalize;
+                    return &node;
+                }
                 if (node.count == 0) {
                     node.count = 1;
                 }
-                node.normalize = false;
+                node.normalize = normalize;
                 switch (*ptr++) {
                     case '1':
                         if (*ptr && *ptr != ' ' && *ptr != '/') {
@@ -705,6 +1064,14 @@ FormatNode * FormatIterator::next() {
                 }
                 return &node;
 
+            case 'n':
+                // the n prefix marks integer types as normalized
+                if (normalize || (*ptr != 'i' && *ptr != 'u')) {
+                    return InvalidFormat;
+                }
+                normalize = true;
+                break;
+
             case 'x':
                 if (node.count == 0) {
                     node.count = 1;
@@ -761,6 +1128,71 @@ FormatNode * FormatIterator::next() {
     }
 }
 
+// A format string parsed once, vertex arrays read the nodes instead of iterating the string again
+struct MGLVertexFormat {
+    PyObject_HEAD
+    FormatNode * nodes;
+    FormatInfo info;
+    int num_nodes;
+};
+
+static MGLVertexFormat * parse_vertex_format(const char * format) {
+    FormatIterator it = FormatIterator(format);
+    FormatInfo info = it.info();
+
+    if (!info.valid) {
+        return NULL;
+    }
+
+    int num_nodes = 0;
+    while (it.next()) {
+        ++num_nodes;
+    }
+
+    MGLVertexFormat * res = PyObject_New(MGLVertexFormat, MGLVertexFormat_type);
+    res->nodes = (FormatNode *)PyMem_Malloc(MGL_MAX(num_nodes, 1) * sizeof(FormatNode));
+    res->num_nodes = num_nodes;
+    res->info = info;
+
+    it = FormatIterator(format);
+    for (int i = 0; i < num_nodes; ++i) {
+        res->nodes[i] = *it.next();
+    }
+
+    return res;
+}
+
+// Returns a new reference to a parsed format, str formats are parsed on the spot
+static MGLVertexFormat * get_vertex_format(PyObject * format) {
+    if (Py_TYPE(format) == MGLVertexFormat_type) {
+        Py_INCREF(format);
+        return (MGLVertexFormat *)format;
+    }
+
+    if (!PyUnicode_Check(format)) {
+        return NULL;
+    }
+
+    return parse_vertex_format(PyUnicode_AsUTF8(format));
+}
+
+static void MGLVertexFormat_dealloc(MGLVertexFormat * self) {
+    PyMem_Free(self->nodes);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject * MGLVertexFormat_get_size(MGLVertexFormat * self, void * closure) {
+    return PyLong_FromLong(self->info.size);
+}
+
+static PyObject * MGLVertexFormat_get_divisor(MGLVertexFormat * self, void * closure) {
+    return PyLong_FromLong(self->info.divisor);
+}
+
+static PyObject * MGLVertexFormat_get_attributes(MGLVertexFormat * self, void * closure) {
+    return PyLong_FromLong(self->info.nodes);
+}
+
 static int float_base_format[5] = {0, GL_RED, GL_RG, GL_RGB, GL_RGBA};
 static int int_base_format[5] = {0, GL_RED_INTEGER, GL_RG_INTEGER, GL_RGB_INTEGER, GL_RGBA_INTEGER};
 
@@ -1339,6 +1771,10 @@ static PyObject * MGLBuffer_bind_to_uniform_block(MGLBuffer * self, PyObject * a
         size = self->size - offset;
     }
 
+    if (self->context->recording) {
+        return record_bind_buffer(self->context, (PyObject *)self, GL_UNIFORM_BUFFER, binding, self->buffer_obj, offset, size);
+    }
+
     const GLMethods & gl = self->context->gl;
     gl.BindBufferRange(GL_UNIFORM_BUFFER, binding, self->buffer_obj, offset, size);
     Py_RETURN_NONE;
@@ -1365,6 +1801,10 @@ static PyObject * MGLBuffer_bind_to_storage_buffer(MGLBuffer * self, PyObject *
         size = self->size - offset;
     }
 
+    if (self->context->recording) {
+        return record_bind_buffer(self->context, (PyObject *)self, GL_SHADER_STORAGE_BUFFER, binding, self->buffer_obj, offset, size);
+    }
+
     const GLMethods & gl = self->context->gl;
     gl.BindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, self->buffer_obj, offset, size);
     Py_RETURN_NONE;
@@ -1428,10 +1868,22 @@ struct AttachmentParameters {
     int samples;
     int renderbuffer;
     int glo;
+    int target;
+    int layer;
+    int layered;
 };
 
+// Attachments are images or (image, layer) tuples, texture arrays, cube maps and 3D textures without a layer are layered
 static int attachment_parameters(PyObject * attachment, AttachmentParameters * parameters, int must_be_depth) {
-    int width = 0, height = 0, samples = 0, renderbuffer = 0, glo = 0, depth = 0;
+    int width = 0, height = 0, samples = 0, renderbuffer = 0, glo = 0, depth = 0, target = 0, layer = -1, layered = 0;
+    int layers = 0;
+
+    if (PyTuple_Check(attachment)) {
+        if (!PyArg_ParseTuple(attachment, "Oi", &attachment, &layer) || layer < 0) {
+            PyErr_Clear();
+            return 0;
+        }
+    }
 
     if (Py_TYPE(attachment) == MGLTexture_type) {
         MGLTexture * image = (MGLTexture *)attachment;
@@ -1440,7 +1892,11 @@ static int attachment_parameters(PyObject * attachment, AttachmentParameters * p
         height = image->height;
         samples = image->samples;
         glo = image->texture_obj;
+        target = samples ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
         renderbuffer = 0;
+        if (layer >= 0) {
+            return 0;
+        }
     }
 
     if (Py_TYPE(attachment) == MGLRenderbuffer_type) {
@@ -1451,6 +1907,48 @@ static int attachment_parameters(PyObject * attachment, AttachmentParameters * p
         samples = image->samples;
         glo = image->renderbuffer_obj;
         renderbuffer = 1;
+        if (layer >= 0) {
+            return 0;
+        }
+    }
+
+    if (Py_TYPE(attachment) == MGLTextureArray_type) {
+        MGLTextureArray * image = (MGLTextureArray *)attachment;
+        width = image->width;
+        height = image->height;
+        glo = image->texture_obj;
+        layers = image->layers;
+    }
+
+    if (Py_TYPE(attachment) == MGLTexture3D_type) {
+        MGLTexture3D * image = (MGLTexture3D *)attachment;
+        width = image->width;
+        height = image->height;
+        glo = image->texture_obj;
+        layers = image->depth;
+    }
+
+    if (Py_TYPE(attachment) == MGLTextureCube_type) {
+        MGLTextureCube * image = (MGLTextureCube *)attachment;
+        depth = image->depth;
+        width = image->width;
+        height = image->height;
+        glo = image->texture_obj;
+        layers = 6;
+
+        // Cube map faces are attached as 2D images of their face target
+        if (layer >= 0 && layer < 6) {
+            target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer;
+            layer = -1;
+            layers = 0;
+        }
+    }
+
+    if (layers) {
+        if (layer >= layers) {
+            return 0;
+        }
+        layered = layer < 0;
     }
 
     if (parameters->valid) {
@@ -1467,9 +1965,30 @@ static int attachment_parameters(PyObject * attachment, AttachmentParameters * p
     parameters->samples = samples;
     parameters->renderbuffer = renderbuffer;
     parameters->glo = glo;
+    parameters->target = target;
+    parameters->layer = layer;
+    parameters->layered = layered;
     return 1;
 }
 
+static void framebuffer_attach(const GLMethods & gl, int attachment, const AttachmentParameters & params) {
+    if (params.renderbuffer) {
+        gl.FramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, params.glo);
+    } else if (params.layered) {
+        gl.FramebufferTexture(GL_FRAMEBUFFER, attachment, params.glo, 0);
+    } else if (params.layer >= 0) {
+        gl.FramebufferTextureLayer(GL_FRAMEBUFFER, attachment, params.glo, 0, params.layer);
+    } else {
+        gl.FramebufferTexture2D(GL_FRAMEBUFFER, attachment, params.target, params.glo, 0);
+    }
+}
+
+// Rebinds the bound framebuffer after another one was bound temporarily
+static void MGLContext_restore_framebuffer(MGLContext * self) {
+    self->gl.BindFramebuffer(GL_FRAMEBUFFER, self->bound_framebuffer->framebuffer_obj);
+    self->framebuffer_state.framebuffer_obj = self->bound_framebuffer->framebuffer_obj;
+}
+
 static PyObject * MGLContext_framebuffer(MGLContext * self, PyObject * args) {
     PyObject * color_attachments_arg;
     PyObject * depth_attachment_arg;
@@ -1513,12 +2032,7 @@ static PyObject * MGLContext_framebuffer(MGLContext * self, PyObject * args) {
             MGLError_Set("invalid color attachment");
             return NULL;
         }
-        if (params.renderbuffer) {
-            gl.FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_RENDERBUFFER, params.glo);
-        } else {
-            int target = params.samples ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
-            gl.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, target, params.glo, 0);
-        }
+        framebuffer_attach(gl, GL_COLOR_ATTACHMENT0 + i, params);
     }
 
     if (depth_attachment_arg != Py_None) {
@@ -1526,12 +2040,7 @@ static PyObject * MGLContext_framebuffer(MGLContext * self, PyObject * args) {
             MGLError_Set("invalid depth attachment");
             return NULL;
         }
-        if (params.renderbuffer) {
-            gl.FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, params.glo);
-        } else {
-            int target = params.samples ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
-            gl.FramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, target, params.glo, 0);
-        }
+        framebuffer_attach(gl, GL_DEPTH_ATTACHMENT, params);
     }
 
     if (!params.valid) {
@@ -1545,7 +2054,7 @@ static PyObject * MGLContext_framebuffer(MGLContext * self, PyObject * args) {
 
     int status = gl.CheckFramebufferStatus(GL_FRAMEBUFFER);
 
-    gl.BindFramebuffer(GL_FRAMEBUFFER, self->bound_framebuffer->framebuffer_obj);
+    MGLContext_restore_framebuffer(self);
 
     switch (status) {
         case GL_FRAMEBUFFER_UNDEFINED:
@@ -1648,7 +2157,7 @@ static PyObject * MGLContext_empty_framebuffer(MGLContext * self, PyObject * arg
 
     int status = gl.CheckFramebufferStatus(GL_FRAMEBUFFER);
 
-    gl.BindFramebuffer(GL_FRAMEBUFFER, self->bound_framebuffer->framebuffer_obj);
+    MGLContext_restore_framebuffer(self);
 
     if (status != GL_FRAMEBUFFER_COMPLETE) {
         const char * message = "the framebuffer is not complete";
@@ -1718,6 +2227,10 @@ static PyObject * MGLFramebuffer_release(MGLFramebuffer * self, PyObject * args)
 
     if (self->framebuffer_obj) {
         self->context->gl.DeleteFramebuffers(1, (GLuint *)&self->framebuffer_obj);
+        // Deleting the bound framebuffer reverts the binding, the name can be reused
+        if (self->context->framebuffer_state.framebuffer_obj == self->framebuffer_obj) {
+            self->context->framebuffer_state.valid = false;
+        }
         Py_DECREF(self->context);
     }
 
@@ -1725,116 +2238,543 @@ static PyObject * MGLFramebuffer_release(MGLFramebuffer * self, PyObject * args)
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLFramebuffer_clear(MGLFramebuffer * self, PyObject * args) {
-    float r, g, b, a, depth;
-    PyObject * viewport_arg;
+static bool rect_equal(const Rect & a, const Rect & b) {
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
 
-    if (!PyArg_ParseTuple(args, "fffffO", &r, &g, &b, &a, &depth, &viewport_arg)) {
-        return 0;
+// Binds the framebuffer and its viewport, scissor and masks, only the state that differs from the last applied one is set
+static void MGLFramebuffer_apply(MGLFramebuffer * self) {
+    const GLMethods & gl = self->context->gl;
+    MGLFramebufferState & state = self->context->framebuffer_state;
+
+    if (!state.valid) {
+        state.framebuffer_obj = -1;
+        state.viewport = rect(-1, -1, -1, -1);
+        state.scissor = rect(-1, -1, -1, -1);
+        state.scissor_enabled = false;
+        memset(state.color_mask, -1, sizeof(state.color_mask));
+        state.depth_mask = !self->depth_mask;
+        gl.Disable(GL_SCISSOR_TEST);
+        state.valid = true;
     }
 
-    Rect viewport_rect = rect(0, 0, self->width, self->height);
-    if (viewport_arg != Py_None) {
-        if (!parse_rect(viewport_arg, &viewport_rect)) {
-            MGLError_Set("wrong values in the viewport");
-            return NULL;
+    // The draw buffers are part of the framebuffer object, they are only set when it gets bound
+    if (state.framebuffer_obj != self->framebuffer_obj) {
+        gl.BindFramebuffer(GL_FRAMEBUFFER, self->framebuffer_obj);
+        if (self->framebuffer_obj) {
+            gl.DrawBuffers(self->draw_buffers_len, self->draw_buffers);
         }
+        state.framebuffer_obj = self->framebuffer_obj;
     }
 
-    const GLMethods & gl = self->context->gl;
-
-    gl.BindFramebuffer(GL_FRAMEBUFFER, self->framebuffer_obj);
-
-    if (self->framebuffer_obj) {
-        gl.DrawBuffers(self->draw_buffers_len, self->draw_buffers);
+    if (self->viewport.width && self->viewport.height && !rect_equal(state.viewport, self->viewport)) {
+        gl.Viewport(self->viewport.x, self->viewport.y, self->viewport.width, self->viewport.height);
+        state.viewport = self->viewport;
     }
 
-    gl.ClearColor(r, g, b, a);
-    gl.ClearDepth(depth);
-
-    if (self->draw_buffers_len == 1) {
-        gl.ColorMask(self->color_mask[0] & 1, self->color_mask[0] & 2, self->color_mask[0] & 4, self->color_mask[0] & 8);
-    } else {
-        for (int i = 0; i < self->draw_buffers_len; ++i) {
+    if (state.scissor_enabled != self->scissor_enabled) {
+        if (self->scissor_enabled) {
+            gl.Enable(GL_SCISSOR_TEST);
+        } else {
+            gl.Disable(GL_SCISSOR_TEST);
+        }
+        state.scissor_enabled = self->scissor_enabled;
+    }
+
+    if (self->scissor_enabled && !rect_equal(state.scissor, self->scissor)) {
+        gl.Scissor(self->scissor.x, self->scissor.y, self->scissor.width, self->scissor.height);
+        state.scissor = self->scissor;
+    }
+
+    for (int i = 0; i < self->draw_buffers_len; ++i) {
+        if (state.color_mask[i] != self->color_mask[i]) {
             gl.ColorMaski(i, self->color_mask[i] & 1, self->color_mask[i] & 2, self->color_mask[i] & 4, self->color_mask[i] & 8);
+            state.color_mask[i] = self->color_mask[i];
         }
     }
 
-    gl.DepthMask(self->depth_mask);
+    if (state.depth_mask != self->depth_mask) {
+        gl.DepthMask(self->depth_mask);
+        state.depth_mask = self->depth_mask;
+    }
+}
+
+static void MGLFramebuffer_clear_native(MGLFramebuffer * self, const float * color, float depth, const Rect * viewport) {
+    const GLMethods & gl = self->context->gl;
+    MGLFramebufferState & state = self->context->framebuffer_state;
+
+    // The framebuffer stays bound, draws apply the bound framebuffer again if necessary
+    MGLFramebuffer_apply(self);
+
+    gl.ClearColor(color[0], color[1], color[2], color[3]);
+    gl.ClearDepth(depth);
 
     // Respect the passed in viewport even with scissor enabled
+    if (viewport) {
+        if (!state.scissor_enabled) {
+            gl.Enable(GL_SCISSOR_TEST);
+            state.scissor_enabled = true;
+        }
+        if (!rect_equal(state.scissor, *viewport)) {
+            gl.Scissor(viewport->x, viewport->y, viewport->width, viewport->height);
+            state.scissor = *viewport;
+        }
+    }
+
+    gl.Clear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+}
+
+static PyObject * MGLFramebuffer_clear(MGLFramebuffer * self, PyObject * args) {
+    float color[4];
+    float depth;
+    PyObject * viewport_arg;
+
+    if (!PyArg_ParseTuple(args, "fffffO", &color[0], &color[1], &color[2], &color[3], &depth, &viewport_arg)) {
+        return 0;
+    }
+
+    Rect viewport_rect = rect(0, 0, self->width, self->height);
     if (viewport_arg != Py_None) {
-        gl.Enable(GL_SCISSOR_TEST);
-        gl.Scissor(viewport_rect.x, viewport_rect.y, viewport_rect.width, viewport_rect.height);
-        gl.Clear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+        if (!parse_rect(viewport_arg, &viewport_rect)) {
+            MGLError_Set("wrong values in the viewport");
+            return NULL;
+        }
+    }
 
-        // restore scissor if enabled
-        if (self->scissor_enabled) {
-            gl.Scissor(
-                self->scissor.x, self->scissor.y,
-                self->scissor.width, self->scissor.height
-            );
-        } else {
-            gl.Disable(GL_SCISSOR_TEST);
+    if (self->context->recording) {
+        MGLCommand * command = record_command(self->context, MGL_COMMAND_CLEAR, (PyObject *)self);
+        command->clear.framebuffer = self;
+        memcpy(command->clear.color, color, sizeof(color));
+        command->clear.depth = depth;
+        command->clear.viewport = viewport_rect;
+        command->clear.has_viewport = viewport_arg != Py_None;
+        return record_handle(self->context);
+    }
+
+    MGLFramebuffer_clear_native(self, color, depth, viewport_arg != Py_None ? &viewport_rect : NULL);
+    Py_RETURN_NONE;
+}
+
+static void MGLFramebuffer_clear_attachments_native(MGLFramebuffer * self, int num_colors, const AttachmentClear * clears, const float * depth, const int * stencil) {
+    const GLMethods & gl = self->context->gl;
+
+    // Binds only if another framebuffer was applied, the masks and scissor of this framebuffer apply
+    MGLFramebuffer_apply(self);
+
+    for (int i = 0; i < num_colors; ++i) {
+        const AttachmentClear & clear = clears[i];
+        switch (clear.kind) {
+            case 'f':
+                gl.ClearBufferfv(GL_COLOR, clear.index, clear.value.f);
+                break;
+            case 'i':
+                gl.ClearBufferiv(GL_COLOR, clear.index, clear.value.i);
+                break;
+            case 'u':
+                gl.ClearBufferuiv(GL_COLOR, clear.index, clear.value.u);
+                break;
         }
-    } else {
-        // clear with scissor if enabled
-        if (self->scissor_enabled) {
-            gl.Enable(GL_SCISSOR_TEST);
-            gl.Scissor(
-                self->scissor.x, self->scissor.y,
-                self->scissor.width, self->scissor.height
-            );
+    }
+
+    if (depth && stencil) {
+        gl.ClearBufferfi(GL_DEPTH_STENCIL, 0, *depth, *stencil);
+    } else if (depth) {
+        gl.ClearBufferfv(GL_DEPTH, 0, depth);
+    } else if (stencil) {
+        gl.ClearBufferiv(GL_STENCIL, 0, stencil);
+    }
+}
+
+static PyObject * MGLFramebuffer_clear_attachments(MGLFramebuffer * self, PyObject * args) {
+    PyObject * colors;
+    PyObject * depth_arg;
+    PyObject * stencil_arg;
+
+    if (!PyArg_ParseTuple(args, "O!OO", &PyTuple_Type, &colors, &depth_arg, &stencil_arg)) {
+        return 0;
+    }
+
+    // Everything is parsed before clearing so invalid values do not leave the attachments half cleared
+    int num_colors = (int)PyTuple_Size(colors);
+    if (num_colors > self->draw_buffers_len) {
+        MGLError_Set("too many color attachments to clear");
+        return 0;
+    }
+
+    AttachmentClear clears[64];
+    for (int i = 0; i < num_colors; ++i) {
+        AttachmentClear & clear = clears[i];
+        PyObject * value;
+        if (!PyArg_ParseTuple(PyTuple_GetItem(colors, i), "iCO", &clear.index, &clear.kind, &value)) {
+            return 0;
+        }
+
+        if (clear.index < 0 || clear.index >= self->draw_buffers_len) {
+            MGLError_Set("the framebuffer has no color attachment %d", clear.index);
+            return 0;
+        }
+
+        int value_ok = 0;
+        switch (clear.kind) {
+            case 'f':
+                value_ok = PyArg_ParseTuple(value, "ffff", &clear.value.f[0], &clear.value.f[1], &clear.value.f[2], &clear.value.f[3]);
+                break;
+            case 'i':
+                value_ok = PyArg_ParseTuple(value, "iiii", &clear.value.i[0], &clear.value.i[1], &clear.value.i[2], &clear.value.i[3]);
+                break;
+            case 'u':
+                value_ok = PyArg_ParseTuple(value, "IIII", &clear.value.u[0], &clear.value.u[1], &clear.value.u[2], &clear.value.u[3]);
+                break;
+            default:
+                MGLError_Set("invalid clear value kind");
+                return 0;
+        }
+
+        if (!value_ok) {
+            return 0;
         }
-        gl.Clear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
     }
 
-    gl.BindFramebuffer(GL_FRAMEBUFFER, self->context->bound_framebuffer->framebuffer_obj);
+    float depth = 0.0f;
+    if (depth_arg != Py_None) {
+        depth = (float)PyFloat_AsDouble(depth_arg);
+    }
+
+    int stencil = 0;
+    if (stencil_arg != Py_None) {
+        stencil = PyLong_AsLong(stencil_arg);
+    }
+
+    if (PyErr_Occurred()) {
+        return 0;
+    }
+
+    if (self->context->recording) {
+        MGLCommand * command = record_command(self->context, MGL_COMMAND_CLEAR_ATTACHMENTS, (PyObject *)self);
+        command->clear_attachments.framebuffer = self;
+        command->clear_attachments.num_colors = num_colors;
+        command->clear_attachments.colors = record_data(self->context, clears, num_colors * sizeof(AttachmentClear));
+        command->clear_attachments.depth = depth;
+        command->clear_attachments.stencil = stencil;
+        command->clear_attachments.has_depth = depth_arg != Py_None;
+        command->clear_attachments.has_stencil = stencil_arg != Py_None;
+        return record_handle(self->context);
+    }
 
+    MGLFramebuffer_clear_attachments_native(
+        self, num_colors, clears,
+        depth_arg != Py_None ? &depth : NULL,
+        stencil_arg != Py_None ? &stencil : NULL
+    );
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLFramebuffer_use(MGLFramebuffer * self, PyObject * args) {
+// Converts color attachment indices, -1 for depth and -2 for stencil into the attachments of InvalidateFramebuffer
+static int parse_invalidate_attachments(MGLFramebuffer * self, PyObject * arg, unsigned * attachments) {
+    int num_attachments = (int)PyTuple_Size(arg);
+    if (num_attachments > self->draw_buffers_len + 2) {
+        MGLError_Set("too many attachments");
+        return -1;
+    }
+
+    for (int i = 0; i < num_attachments; ++i) {
+        int index = PyLong_AsLong(PyTuple_GetItem(arg, i));
+        if (PyErr_Occurred()) {
+            return -1;
+        }
+
+        if (index == -1) {
+            attachments[i] = self->framebuffer_obj ? GL_DEPTH_ATTACHMENT : GL_DEPTH;
+        } else if (index == -2) {
+            attachments[i] = self->framebuffer_obj ? GL_STENCIL_ATTACHMENT : GL_STENCIL;
+        } else if (index >= 0 && index < self->draw_buffers_len) {
+            attachments[i] = self->framebuffer_obj ? GL_COLOR_ATTACHMENT0 + index : GL_COLOR;
+        } else {
+            MGLError_Set("the framebuffer has no color attachment %d", index);
+            return -1;
+        }
+    }
+
+    return num_attachments;
+}
+
+// Invalidation is only a hint, it is skipped when the driver does not support it
+static void MGLFramebuffer_invalidate_attachments(MGLFramebuffer * self, int num_attachments, const unsigned * attachments, const Rect * viewport) {
     const GLMethods & gl = self->context->gl;
 
-    gl.BindFramebuffer(GL_FRAMEBUFFER, self->framebuffer_obj);
+    if (!num_attachments) {
+        return;
+    }
 
-    if (self->framebuffer_obj) {
-        gl.DrawBuffers(self->draw_buffers_len, self->draw_buffers);
+    if (gl.InvalidateNamedFramebufferData) {
+        if (viewport) {
+            gl.InvalidateNamedFramebufferSubData(self->framebuffer_obj, num_attachments, attachments, viewport->x, viewport->y, viewport->width, viewport->height);
+        } else {
+            gl.InvalidateNamedFramebufferData(self->framebuffer_obj, num_attachments, attachments);
+        }
+        return;
     }
 
-    if (self->viewport.width && self->viewport.height) {
-        gl.Viewport(
-            self->viewport.x,
-            self->viewport.y,
-            self->viewport.width,
-            self->viewport.height
-        );
+    if (!gl.InvalidateFramebuffer) {
+        return;
     }
 
-    if (self->scissor_enabled) {
-        gl.Enable(GL_SCISSOR_TEST);
-        gl.Scissor(
-            self->scissor.x, self->scissor.y,
-            self->scissor.width, self->scissor.height
-        );
+    gl.BindFramebuffer(GL_FRAMEBUFFER, self->framebuffer_obj);
+    if (viewport) {
+        gl.InvalidateSubFramebuffer(GL_FRAMEBUFFER, num_attachments, attachments, viewport->x, viewport->y, viewport->width, viewport->height);
     } else {
-        gl.Disable(GL_SCISSOR_TEST);
+        gl.InvalidateFramebuffer(GL_FRAMEBUFFER, num_attachments, attachments);
     }
+    MGLContext_restore_framebuffer(self->context);
+}
 
-    for (int i = 0; i < self->draw_buffers_len; ++i) {
-        gl.ColorMaski(i, self->color_mask[i] & 1, self->color_mask[i] & 2, self->color_mask[i] & 4, self->color_mask[i] & 8);
+static PyObject * MGLFramebuffer_invalidate(MGLFramebuffer * self, PyObject * args) {
+    PyObject * attachments_arg;
+    PyObject * viewport_arg;
+
+    if (!PyArg_ParseTuple(args, "O!O", &PyTuple_Type, &attachments_arg, &viewport_arg)) {
+        return 0;
     }
 
-    gl.DepthMask(self->depth_mask);
+    unsigned attachments[66];
+    int num_attachments = parse_invalidate_attachments(self, attachments_arg, attachments);
+    if (num_attachments < 0) {
+        return 0;
+    }
+
+    Rect viewport = {};
+    if (viewport_arg != Py_None && !parse_rect(viewport_arg, &viewport)) {
+        MGLError_Set("wrong values in the viewport");
+        return 0;
+    }
+
+    if (self->context->recording) {
+        MGLCommand * command = record_command(self->context, MGL_COMMAND_INVALIDATE_FRAMEBUFFER, (PyObject *)self);
+        command->invalidate_framebuffer.framebuffer = self;
+        command->invalidate_framebuffer.num_attachments = num_attachments;
+        command->invalidate_framebuffer.attachments = record_data(self->context, attachments, num_attachments * sizeof(unsigned));
+        command->invalidate_framebuffer.viewport = viewport;
+        command->invalidate_framebuffer.has_viewport = viewport_arg != Py_None;
+        return record_handle(self->context);
+    }
+
+    MGLFramebuffer_invalidate_attachments(self, num_attachments, attachments, viewport_arg != Py_None ? &viewport : NULL);
+    Py_RETURN_NONE;
+}
+
+static void MGLFramebuffer_use_native(MGLFramebuffer * self) {
+    // The window or another library may change the screen and detected framebuffers behind our back
+    if (self->dynamic) {
+        self->context->framebuffer_state.valid = false;
+    }
+
+    MGLFramebuffer_apply(self);
 
     Py_INCREF(self);
     Py_DECREF(self->context->bound_framebuffer);
     self->context->bound_framebuffer = self;
+}
+
+static PyObject * MGLFramebuffer_use(MGLFramebuffer * self, PyObject * args) {
+    if (self->context->recording) {
+        MGLCommand * command = record_command(self->context, MGL_COMMAND_USE_FRAMEBUFFER, (PyObject *)self);
+        command->framebuffer = self;
+        return record_handle(self->context);
+    }
 
+    MGLFramebuffer_use_native(self);
     Py_RETURN_NONE;
 }
 
+struct PixelConversion {
+    int width;
+    int height;
+    int components;
+    int out_components;
+    int channels[4];
+    bool flip_y;
+    bool identity;
+    Py_ssize_t out_stride;
+};
+
+static inline void convert_pixel_value(unsigned char value, unsigned char * out) {
+    *out = value;
+}
+
+static inline void convert_pixel_value(unsigned char value, float * out) {
+    *out = value * (1.0f / 255.0f);
+}
+
+static inline void convert_pixel_value(float value, float * out) {
+    *out = value;
+}
+
+static inline void convert_pixel_value(float value, unsigned char * out) {
+    value = value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+    *out = (unsigned char)(value * 255.0f + 0.5f);
+}
+
+// The channel count is a template parameter so the channel loop has a fixed trip count
+template <typename Source, typename Target, int OutComponents>
+static void convert_pixel_rows(const PixelConversion & conv, const char * src, char * dst) {
+    for (int y = 0; y < conv.height; ++y) {
+        int row = conv.flip_y ? conv.height - 1 - y : y;
+        const Source * in = (const Source *)src + (Py_ssize_t)row * conv.width * conv.components;
+        Target * out = (Target *)(dst + y * conv.out_stride);
+
+        for (int x = 0; x < conv.width; ++x) {
+            for (int c = 0; c < OutComponents; ++c) {
+                convert_pixel_value(in[conv.channels[c]], out + c);
+            }
+            in += conv.components;
+            out += OutComponents;
+        }
+    }
+}
+
+template <typename Source, typename Target>
+static void convert_pixels(const PixelConversion & conv, const char * src, char * dst) {
+    // Without a type or channel change the rows are copied as they are
+    if (sizeof(Source) == sizeof(Target) && conv.identity) {
+        Py_ssize_t row_size = (Py_ssize_t)conv.width * conv.components * sizeof(Source);
+        for (int y = 0; y < conv.height; ++y) {
+            int row = conv.flip_y ? conv.height - 1 - y : y;
+            memcpy(dst + y * conv.out_stride, src + row * row_size, row_size);
+        }
+        return;
+    }
+
+    switch (conv.out_components) {
+        case 1: convert_pixel_rows<Source, Target, 1>(conv, src, dst); break;
+        case 2: convert_pixel_rows<Source, Target, 2>(conv, src, dst); break;
+        case 3: convert_pixel_rows<Source, Target, 3>(conv, src, dst); break;
+        case 4: convert_pixel_rows<Source, Target, 4>(conv, src, dst); break;
+    }
+}
+
+// Binds the framebuffer for reading, negative attachments read the depth or depth and stencil buffer
+// The bound framebuffer must be restored with MGLContext_restore_framebuffer after the reads
+static void MGLFramebuffer_begin_read(MGLFramebuffer * self, int attachment, int alignment, bool clamp) {
+    const GLMethods & gl = self->context->gl;
+
+    if (clamp) {
+        gl.ClampColor(GL_CLAMP_READ_COLOR, GL_TRUE);
+    } else {
+        gl.ClampColor(GL_CLAMP_READ_COLOR, GL_FIXED_ONLY);
+    }
+
+    gl.BindFramebuffer(GL_FRAMEBUFFER, self->framebuffer_obj);
+    gl.ReadBuffer(attachment < 0 ? GL_NONE : (GL_COLOR_ATTACHMENT0 + attachment));
+    gl.PixelStorei(GL_PACK_ALIGNMENT, alignment);
+    gl.PixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+}
+
+// Reads pixels into client memory or at an offset of the bound pixel pack buffer
+static void MGLFramebuffer_read_pixels(MGLFramebuffer * self, Rect viewport, int attachment, int alignment, bool clamp, int base_format, int pixel_type, void * ptr) {
+    MGLFramebuffer_begin_read(self, attachment, alignment, clamp);
+    self->context->gl.ReadPixels(viewport.x, viewport.y, viewport.width, viewport.height, base_format, pixel_type, ptr);
+    MGLContext_restore_framebuffer(self->context);
+}
+
+// Reads the pixels into a temporary buffer then flips, swizzles and converts them into the destination
+static PyObject * MGLFramebuffer_read_converted(
+    MGLFramebuffer * self, PyObject * data, Rect viewport, int components, int attachment, int alignment, int clamp,
+    const char * dtype, Py_ssize_t write_offset, bool flip_y, const char * swizzle, const char * out_dtype, int out_components
+) {
+    if (Py_TYPE(data) == MGLBuffer_type) {
+        MGLError_Set("flip_y, swizzle, out_dtype and out_components require a client memory destination");
+        return 0;
+    }
+
+    if (!out_dtype) {
+        out_dtype = dtype;
+    }
+
+    bool float_input = !strcmp(dtype, "f4");
+    bool float_output = !strcmp(out_dtype, "f4");
+
+    if ((!float_input && strcmp(dtype, "f1")) || (!float_output && strcmp(out_dtype, "f1"))) {
+        MGLError_Set("pixel conversion supports the f1 and f4 dtypes only");
+        return 0;
+    }
+
+    PixelConversion conv = {};
+    conv.width = viewport.width;
+    conv.height = viewport.height;
+    conv.components = components;
+    conv.flip_y = flip_y;
+
+    if (swizzle) {
+        conv.out_components = (int)strlen(swizzle);
+        if (out_components != -1 && out_components != conv.out_components) {
+            MGLError_Set("the swizzle must have out_components channels");
+            return 0;
+        }
+    } else {
+        conv.out_components = out_components != -1 ? out_components : components;
+    }
+
+    if (conv.out_components < 1 || conv.out_components > 4) {
+        MGLError_Set("the output must have 1 to 4 components");
+        return 0;
+    }
+
+    const char * channel_names = "rgba";
+
+    for (int c = 0; c < conv.out_components; ++c) {
+        const char * channel = swizzle ? strchr(channel_names, swizzle[c]) : channel_names + c;
+        conv.channels[c] = channel && *channel ? (int)(channel - channel_names) : -1;
+
+        if (conv.channels[c] < 0 || conv.channels[c] >= components) {
+            MGLError_Set("the swizzle %s reads a missing component", swizzle ? swizzle : "");
+            return 0;
+        }
+    }
+
+    conv.identity = conv.out_components == components;
+    for (int c = 0; c < conv.out_components; ++c) {
+        conv.identity = conv.identity && conv.channels[c] == c;
+    }
+
+    int out_size = float_output ? 4 : 1;
+    conv.out_stride = (Py_ssize_t)conv.width * conv.out_components * out_size;
+    conv.out_stride = (conv.out_stride + alignment - 1) / alignment * alignment;
+
+    Py_buffer buffer_view;
+
+    if (PyObject_GetBuffer(data, &buffer_view, PyBUF_WRITABLE) < 0) {
+        return 0;
+    }
+
+    Py_ssize_t expected_size = conv.out_stride * conv.height;
+
+    if (buffer_view.len < write_offset + expected_size) {
+        MGLError_Set("the buffer is too small");
+        PyBuffer_Release(&buffer_view);
+        return 0;
+    }
+
+    MGLDataType * data_type = from_dtype(dtype);
+    int base_format = attachment == -1 ? GL_DEPTH_COMPONENT : data_type->base_format[components];
+
+    char * pixels = new char[(size_t)conv.width * conv.height * components * data_type->size];
+    MGLFramebuffer_read_pixels(self, viewport, attachment, 1, clamp, base_format, data_type->gl_type, pixels);
+
+    char * dst = (char *)buffer_view.buf + write_offset;
+
+    Py_BEGIN_ALLOW_THREADS
+    if (float_input) {
+        float_output ? convert_pixels<float, float>(conv, pixels, dst) : convert_pixels<float, unsigned char>(conv, pixels, dst);
+    } else {
+        float_output ? convert_pixels<unsigned char, float>(conv, pixels, dst) : convert_pixels<unsigned char, unsigned char>(conv, pixels, dst);
+    }
+    Py_END_ALLOW_THREADS
+
+    delete[] pixels;
+    PyBuffer_Release(&buffer_view);
+    return PyLong_FromSsize_t(expected_size);
+}
+
 static PyObject * MGLFramebuffer_read_into(MGLFramebuffer * self, PyObject * args) {
     PyObject * data;
     PyObject * viewport_arg;
@@ -1846,9 +2786,14 @@ static PyObject * MGLFramebuffer_read_into(MGLFramebuffer * self, PyObject * arg
     const char * dtype;
     Py_ssize_t write_offset;
 
+    int flip_y = false;
+    const char * swizzle = NULL;
+    const char * out_dtype = NULL;
+    int out_components = -1;
+
     int args_ok = PyArg_ParseTuple(
         args,
-        "OOIIIpsn",
+        "OOIIIpsn|pzzi",
         &data,
         &viewport_arg,
         &components,
@@ -1856,7 +2801,11 @@ static PyObject * MGLFramebuffer_read_into(MGLFramebuffer * self, PyObject * arg
         &alignment,
         &clamp,
         &dtype,
-        &write_offset
+        &write_offset,
+        &flip_y,
+        &swizzle,
+        &out_dtype,
+        &out_components
     );
 
     if (!args_ok) {
@@ -1897,25 +2846,20 @@ static PyObject * MGLFramebuffer_read_into(MGLFramebuffer * self, PyObject * arg
     int pixel_type = data_type->gl_type;
     int base_format = read_depth ? GL_DEPTH_COMPONENT : data_type->base_format[components];
 
+    if (flip_y || swizzle || out_dtype || out_components != -1) {
+        return MGLFramebuffer_read_converted(
+            self, data, viewport_rect, components, attachment, alignment, clamp, dtype, write_offset, flip_y, swizzle, out_dtype, out_components
+        );
+    }
+
     if (Py_TYPE(data) == MGLBuffer_type) {
 
         MGLBuffer * buffer = (MGLBuffer *)data;
 
         const GLMethods & gl = self->context->gl;
 
-        if (clamp) {
-            gl.ClampColor(GL_CLAMP_READ_COLOR, GL_TRUE);
-        } else {
-            gl.ClampColor(GL_CLAMP_READ_COLOR, GL_FIXED_ONLY);
-        }
-
         gl.BindBuffer(GL_PIXEL_PACK_BUFFER, buffer->buffer_obj);
-        gl.BindFramebuffer(GL_FRAMEBUFFER, self->framebuffer_obj);
-        gl.ReadBuffer(read_depth ? GL_NONE : (GL_COLOR_ATTACHMENT0 + attachment));
-        gl.PixelStorei(GL_PACK_ALIGNMENT, alignment);
-        gl.PixelStorei(GL_UNPACK_ALIGNMENT, alignment);
-        gl.ReadPixels(viewport_rect.x, viewport_rect.y, viewport_rect.width, viewport_rect.height, base_format, pixel_type, (void *)write_offset);
-        gl.BindFramebuffer(GL_FRAMEBUFFER, self->context->bound_framebuffer->framebuffer_obj);
+        MGLFramebuffer_read_pixels(self, viewport_rect, attachment, alignment, clamp, base_format, pixel_type, (void *)write_offset);
         gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
     } else {
@@ -1936,20 +2880,7 @@ static PyObject * MGLFramebuffer_read_into(MGLFramebuffer * self, PyObject * arg
 
         char * ptr = (char *)buffer_view.buf + write_offset;
 
-        const GLMethods & gl = self->context->gl;
-
-        if (clamp) {
-            gl.ClampColor(GL_CLAMP_READ_COLOR, GL_TRUE);
-        } else {
-            gl.ClampColor(GL_CLAMP_READ_COLOR, GL_FIXED_ONLY);
-        }
-
-        gl.BindFramebuffer(GL_FRAMEBUFFER, self->framebuffer_obj);
-        gl.ReadBuffer(read_depth ? GL_NONE : (GL_COLOR_ATTACHMENT0 + attachment));
-        gl.PixelStorei(GL_PACK_ALIGNMENT, alignment);
-        gl.PixelStorei(GL_UNPACK_ALIGNMENT, alignment);
-        gl.ReadPixels(viewport_rect.x, viewport_rect.y, viewport_rect.width, viewport_rect.height, base_format, pixel_type, ptr);
-        gl.BindFramebuffer(GL_FRAMEBUFFER, self->context->bound_framebuffer->framebuffer_obj);
+        MGLFramebuffer_read_pixels(self, viewport_rect, attachment, alignment, clamp, base_format, pixel_type, ptr);
 
         PyBuffer_Release(&buffer_view);
     }
@@ -1957,11 +2888,372 @@ static PyObject * MGLFramebuffer_read_into(MGLFramebuffer * self, PyObject * arg
     return PyLong_FromLong(expected_size);
 }
 
-static PyObject * MGLFramebuffer_get_viewport(MGLFramebuffer * self, void * closure) {
-    return Py_BuildValue("(iiii)", self->viewport.x, self->viewport.y, self->viewport.width, self->viewport.height);
-}
-
-static int MGLFramebuffer_set_viewport(MGLFramebuffer * self, PyObject * value, void * closure) {
+static PyObject * MGLFramebuffer_read_async(MGLFramebuffer * self, PyObject * args) {
+    MGLReadback * readback;
+    PyObject * viewport_arg;
+    int components;
+    int attachment;
+    int alignment;
+    int clamp;
+    const char * dtype;
+
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "O!OIIIps",
+        MGLReadback_type,
+        &readback,
+        &viewport_arg,
+        &components,
+        &attachment,
+        &alignment,
+        &clamp,
+        &dtype
+    );
+
+    if (!args_ok) {
+        return 0;
+    }
+
+    if (readback->released) {
+        MGLError_Set("the readback was released");
+        return 0;
+    }
+
+    if (alignment != 1 && alignment != 2 && alignment != 4 && alignment != 8) {
+        MGLError_Set("the alignment must be 1, 2, 4 or 8");
+        return 0;
+    }
+
+    MGLDataType * data_type = from_dtype(dtype);
+
+    if (!data_type) {
+        MGLError_Set("invalid dtype");
+        return 0;
+    }
+
+    Rect viewport_rect = rect(0, 0, self->width, self->height);
+    if (viewport_arg != Py_None) {
+        if (!parse_rect(viewport_arg, &viewport_rect)) {
+            MGLError_Set("wrong values in the viewport");
+            return NULL;
+        }
+    }
+
+    if (attachment == -1) {
+        components = 1;
+    }
+
+    Py_ssize_t size = (Py_ssize_t)viewport_rect.width * components * data_type->size;
+    size = (size + alignment - 1) / alignment * alignment;
+    size = size * viewport_rect.height;
+
+    int base_format = attachment == -1 ? GL_DEPTH_COMPONENT : data_type->base_format[components];
+
+    const GLMethods & gl = self->context->gl;
+
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer_obj);
+
+    // The pixel pack buffer is reused from frame to frame and only reallocated when it has to grow
+    if (readback->capacity < size) {
+        gl.BufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        readback->capacity = size;
+    }
+
+    MGLFramebuffer_read_pixels(self, viewport_rect, attachment, alignment, clamp, base_format, data_type->gl_type, 0);
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (readback->sync) {
+        gl.DeleteSync(readback->sync);
+    }
+
+    // Flushing makes sure the fence gets signaled without waiting on it
+    readback->sync = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl.Flush();
+
+    readback->size = size;
+    readback->generation += 1;
+    return Py_BuildValue("(nL)", size, readback->generation);
+}
+
+// Reads many small rects into one pixel pack buffer so they all arrive with a single wait
+static PyObject * MGLFramebuffer_pick(MGLFramebuffer * self, PyObject * args) {
+    MGLReadback * readback;
+    PyObject * rects_arg;
+    int components;
+    int attachment;
+    const char * dtype;
+
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "O!O!Iis",
+        MGLReadback_type,
+        &readback,
+        &PyTuple_Type,
+        &rects_arg,
+        &components,
+        &attachment,
+        &dtype
+    );
+
+    if (!args_ok) {
+        return 0;
+    }
+
+    if (readback->released) {
+        MGLError_Set("the readback was released");
+        return 0;
+    }
+
+    MGLDataType * data_type = from_dtype(dtype);
+
+    if (!data_type) {
+        MGLError_Set("invalid dtype");
+        return 0;
+    }
+
+    int base_format;
+    int pixel_type;
+    int pixel_size;
+
+    // -1 reads the depth and -2 reads the packed depth and stencil
+    if (attachment == -2) {
+        base_format = GL_DEPTH_STENCIL;
+        pixel_type = GL_UNSIGNED_INT_24_8;
+        pixel_size = 4;
+    } else if (attachment == -1) {
+        base_format = GL_DEPTH_COMPONENT;
+        pixel_type = data_type->gl_type;
+        pixel_size = data_type->size;
+    } else {
+        if (attachment < 0 || attachment >= self->draw_buffers_len) {
+            MGLError_Set("the framebuffer has no color attachment %d", attachment);
+            return 0;
+        }
+        if (components < 1 || components > 4) {
+            MGLError_Set("the components must be 1, 2, 3 or 4");
+            return 0;
+        }
+        base_format = data_type->base_format[components];
+        pixel_type = data_type->gl_type;
+        pixel_size = components * data_type->size;
+    }
+
+    int num_rects = (int)PyTuple_Size(rects_arg);
+    Rect * rects = new Rect[num_rects];
+    Py_ssize_t size = 0;
+
+    for (int i = 0; i < num_rects; ++i) {
+        if (!parse_rect(PyTuple_GetItem(rects_arg, i), &rects[i]) || rects[i].width <= 0 || rects[i].height <= 0) {
+            MGLError_Set("invalid point or rect at index %d", i);
+            delete[] rects;
+            return 0;
+        }
+        size += (Py_ssize_t)rects[i].width * rects[i].height * pixel_size;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer_obj);
+
+    if (readback->capacity < size) {
+        gl.BufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        readback->capacity = size;
+    }
+
+    MGLFramebuffer_begin_read(self, attachment, 1, false);
+
+    Py_ssize_t offset = 0;
+    for (int i = 0; i < num_rects; ++i) {
+        gl.ReadPixels(rects[i].x, rects[i].y, rects[i].width, rects[i].height, base_format, pixel_type, (void *)offset);
+        offset += (Py_ssize_t)rects[i].width * rects[i].height * pixel_size;
+    }
+
+    MGLContext_restore_framebuffer(self->context);
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    delete[] rects;
+
+    if (readback->sync) {
+        gl.DeleteSync(readback->sync);
+    }
+
+    readback->sync = gl.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl.Flush();
+
+    readback->size = size;
+    readback->generation += 1;
+    return Py_BuildValue("(nL)", size, readback->generation);
+}
+
+static PyObject * MGLContext_readback(MGLContext * self, PyObject * args) {
+    MGLReadback * readback = PyObject_New(MGLReadback, MGLReadback_type);
+    readback->buffer_obj = 0;
+    readback->capacity = 0;
+    readback->size = 0;
+    readback->sync = NULL;
+    readback->generation = 0;
+    readback->released = false;
+
+    const GLMethods & gl = self->gl;
+    gl.GenBuffers(1, (GLuint *)&readback->buffer_obj);
+
+    if (!readback->buffer_obj) {
+        MGLError_Set("cannot create buffer");
+        Py_DECREF(readback);
+        return 0;
+    }
+
+    Py_INCREF(self);
+    readback->context = self;
+
+    return Py_BuildValue("(Oi)", readback, readback->buffer_obj);
+}
+
+// Waits for the fence of the last read, a negative timeout waits forever
+static int MGLReadback_wait_sync(MGLReadback * self, long long timeout) {
+    if (!self->sync) {
+        return 1;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    GLuint64 nanoseconds = timeout < 0 ? GL_TIMEOUT_IGNORED : (GLuint64)timeout;
+    GLenum status = gl.ClientWaitSync(self->sync, GL_SYNC_FLUSH_COMMANDS_BIT, nanoseconds);
+
+    if (status == GL_WAIT_FAILED) {
+        MGLError_Set("waiting for the readback failed");
+        return -1;
+    }
+
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return 0;
+    }
+
+    gl.DeleteSync(self->sync);
+    self->sync = NULL;
+    return 1;
+}
+
+static PyObject * MGLReadback_done(MGLReadback * self, PyObject * args) {
+    if (self->released) {
+        MGLError_Set("the readback was released");
+        return 0;
+    }
+
+    if (!self->sync) {
+        Py_RETURN_TRUE;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    int status = 0;
+    gl.GetSynciv(self->sync, GL_SYNC_STATUS, 1, NULL, &status);
+    return PyBool_FromLong(status == GL_SIGNALED);
+}
+
+static PyObject * MGLReadback_wait(MGLReadback * self, PyObject * args) {
+    long long timeout;
+
+    if (!PyArg_ParseTuple(args, "L", &timeout)) {
+        return 0;
+    }
+
+    if (self->released) {
+        MGLError_Set("the readback was released");
+        return 0;
+    }
+
+    int result = MGLReadback_wait_sync(self, timeout);
+    if (result < 0) {
+        return 0;
+    }
+
+    return PyBool_FromLong(result);
+}
+
+static PyObject * MGLReadback_read_into(MGLReadback * self, PyObject * args) {
+    PyObject * data;
+    Py_ssize_t write_offset;
+
+    if (!PyArg_ParseTuple(args, "On", &data, &write_offset)) {
+        return 0;
+    }
+
+    if (self->released || !self->generation) {
+        MGLError_Set(self->released ? "the readback was released" : "nothing was read");
+        return 0;
+    }
+
+    Py_buffer buffer_view;
+
+    if (PyObject_GetBuffer(data, &buffer_view, PyBUF_WRITABLE) < 0) {
+        return 0;
+    }
+
+    if (write_offset < 0 || buffer_view.len < write_offset + self->size) {
+        MGLError_Set("the buffer is too small");
+        PyBuffer_Release(&buffer_view);
+        return 0;
+    }
+
+    if (MGLReadback_wait_sync(self, -1) < 0) {
+        PyBuffer_Release(&buffer_view);
+        return 0;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, self->buffer_obj);
+    void * map = gl.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, self->size, GL_MAP_READ_BIT);
+
+    if (map) {
+        memcpy((char *)buffer_view.buf + write_offset, map, self->size);
+        gl.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    gl.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    PyBuffer_Release(&buffer_view);
+
+    if (!map) {
+        MGLError_Set("cannot map the buffer");
+        return 0;
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLReadback_release(MGLReadback * self, PyObject * args) {
+    if (self->released) {
+        Py_RETURN_NONE;
+    }
+    self->released = true;
+
+    const GLMethods & gl = self->context->gl;
+
+    if (self->sync) {
+        gl.DeleteSync(self->sync);
+        self->sync = NULL;
+    }
+
+    gl.DeleteBuffers(1, (GLuint *)&self->buffer_obj);
+
+    Py_DECREF(self->context);
+    Py_DECREF(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLReadback_get_generation(MGLReadback * self, void * closure) {
+    return PyLong_FromLongLong(self->generation);
+}
+
+static PyObject * MGLFramebuffer_get_viewport(MGLFramebuffer * self, void * closure) {
+    return Py_BuildValue("(iiii)", self->viewport.x, self->viewport.y, self->viewport.width, self->viewport.height);
+}
+
+static int MGLFramebuffer_set_viewport(MGLFramebuffer * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self->context)) {
+        return -1;
+    }
+
     Rect viewport_rect = {};
     if (!parse_rect(value, &viewport_rect)) {
         MGLError_Set("wrong values in the viewport");
@@ -1970,14 +3262,7 @@ static int MGLFramebuffer_set_viewport(MGLFramebuffer * self, PyObject * value,
     self->viewport = viewport_rect;
 
     if (self->framebuffer_obj == self->context->bound_framebuffer->framebuffer_obj) {
-        const GLMethods & gl = self->context->gl;
-
-        gl.Viewport(
-            self->viewport.x,
-            self->viewport.y,
-            self->viewport.width,
-            self->viewport.height
-        );
+        MGLFramebuffer_apply(self);
     }
 
     return 0;
@@ -1988,6 +3273,10 @@ static PyObject * MGLFramebuffer_get_scissor(MGLFramebuffer * self, void * closu
 }
 
 static int MGLFramebuffer_set_scissor(MGLFramebuffer * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self->context)) {
+        return -1;
+    }
+
     if (value == Py_None) {
         self->scissor = rect(0, 0, self->width, self->height);
         self->scissor_enabled = false;
@@ -2002,20 +3291,7 @@ static int MGLFramebuffer_set_scissor(MGLFramebuffer * self, PyObject * value, v
     }
 
     if (self->framebuffer_obj == self->context->bound_framebuffer->framebuffer_obj) {
-        const GLMethods & gl = self->context->gl;
-
-        if (self->scissor_enabled) {
-            gl.Enable(GL_SCISSOR_TEST);
-        } else {
-            gl.Disable(GL_SCISSOR_TEST);
-        }
-
-        gl.Scissor(
-            self->scissor.x,
-            self->scissor.y,
-            self->scissor.width,
-            self->scissor.height
-        );
+        MGLFramebuffer_apply(self);
     }
 
     return 0;
@@ -2063,6 +3339,10 @@ static int parse_mask(PyObject * arg, char * value) {
 }
 
 static int MGLFramebuffer_set_color_mask(MGLFramebuffer * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self->context)) {
+        return -1;
+    }
+
     if (self->draw_buffers_len == 1) {
         if (!parse_mask(value, &self->color_mask[0])) {
             MGLError_Set("invalid color mask");
@@ -2088,10 +3368,7 @@ static int MGLFramebuffer_set_color_mask(MGLFramebuffer * self, PyObject * value
     }
 
     if (self->framebuffer_obj == self->context->bound_framebuffer->framebuffer_obj) {
-        const GLMethods & gl = self->context->gl;
-        for (int i = 0; i < self->draw_buffers_len; ++i) {
-            gl.ColorMaski(i, self->color_mask[i] & 1, self->color_mask[i] & 2, self->color_mask[i] & 4, self->color_mask[i] & 8);
-        }
+        MGLFramebuffer_apply(self);
     }
 
     return 0;
@@ -2102,6 +3379,10 @@ static PyObject * MGLFramebuffer_get_depth_mask(MGLFramebuffer * self, void * cl
 }
 
 static int MGLFramebuffer_set_depth_mask(MGLFramebuffer * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self->context)) {
+        return -1;
+    }
+
     if (value == Py_True) {
         self->depth_mask = true;
     } else if (value == Py_False) {
@@ -2112,8 +3393,7 @@ static int MGLFramebuffer_set_depth_mask(MGLFramebuffer * self, PyObject * value
     }
 
     if (self->framebuffer_obj == self->context->bound_framebuffer->framebuffer_obj) {
-        const GLMethods & gl = self->context->gl;
-        gl.DepthMask(self->depth_mask);
+        MGLFramebuffer_apply(self);
     }
 
     return 0;
@@ -2141,7 +3421,7 @@ static PyObject * MGLFramebuffer_get_bits(MGLFramebuffer * self, void * closure)
     gl.GetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_BACK_LEFT, GL_FRAMEBUFFER_ATTACHMENT_ALPHA_SIZE, &alpha_bits);
     gl.GetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_DEPTH, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depth_bits);
     gl.GetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_STENCIL, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencil_bits);
-    gl.BindFramebuffer(GL_FRAMEBUFFER, self->context->bound_framebuffer->framebuffer_obj);
+    MGLContext_restore_framebuffer(self->context);
 
     PyObject * red_obj = PyLong_FromLong(red_bits);
     PyObject * green_obj = PyLong_FromLong(green_bits);
@@ -2169,15 +3449,254 @@ static PyObject * MGLFramebuffer_get_bits(MGLFramebuffer * self, void * closure)
     return result;
 }
 
-static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
+struct MGLSourceBuffer {
+    char * data;
+    Py_ssize_t size;
+    Py_ssize_t capacity;
+};
+
+static void source_buffer_append(MGLSourceBuffer * buffer, const char * str, Py_ssize_t len) {
+    if (buffer->size + len > buffer->capacity) {
+        buffer->capacity = MGL_MAX(buffer->capacity * 2, buffer->size + len);
+        buffer->data = (char *)PyMem_Realloc(buffer->data, buffer->capacity);
+    }
+    memcpy(buffer->data + buffer->size, str, len);
+    buffer->size += len;
+}
+
+// Returns the length of the name if the line is an #include "name" directive or -1 otherwise
+static int parse_include_directive(const char * ptr, const char * end, const char ** name) {
+    while (ptr < end && (*ptr == ' ' || *ptr == '\t')) {
+        ++ptr;
+    }
+    if (ptr == end || *ptr++ != '#') {
+        return -1;
+    }
+    while (ptr < end && (*ptr == ' ' || *ptr == '\t')) {
+        ++ptr;
+    }
+    if (end - ptr < 7 || strncmp(ptr, "include", 7)) {
+        return -1;
+    }
+    ptr += 7;
+    while (ptr < end && (*ptr == ' ' || *ptr == '\t')) {
+        ++ptr;
+    }
+    if (ptr == end || *ptr++ != '"') {
+        return -1;
+    }
+    *name = ptr;
+    while (ptr < end && *ptr != '"') {
+        ++ptr;
+    }
+    if (ptr == end) {
+        return -1;
+    }
+    return (int)(ptr - *name);
+}
+
+// Expands the includes recursively, every include is expanded at most once (implicit include guard).
+// The included sources are numbered by their order in names and mapped using #line directives.
+static bool expand_includes(MGLContext * self, const char * source, Py_ssize_t size, int source_index, PyObject * names, MGLSourceBuffer * output) {
+    const char * ptr = source;
+    const char * end = source + size;
+    char directive[64];
+    int line = 1;
+
+    while (ptr < end) {
+        const char * line_end = (const char *)memchr(ptr, '\n', end - ptr);
+        const char * next = line_end ? line_end + 1 : end;
+        if (!line_end) {
+            line_end = end;
+        }
+
+        const char * name_ptr = NULL;
+        int name_len = parse_include_directive(ptr, line_end, &name_ptr);
+
+        if (name_len < 0) {
+            source_buffer_append(output, ptr, next - ptr);
+        } else {
+            PyObject * name = PyUnicode_FromStringAndSize(name_ptr, name_len);
+            if (!name) {
+                return false;
+            }
+
+            if (PySequence_Contains(names, name)) {
+                source_buffer_append(output, "\n", 1);
+                Py_DECREF(name);
+            } else {
+                PyObject * content = PyDict_GetItem(self->includes, name);
+                if (!content || !PyUnicode_Check(content)) {
+                    PyErr_Format(PyExc_KeyError, "cannot include \"%U\"", name);
+                    Py_DECREF(name);
+                    return false;
+                }
+
+                PyList_Append(names, name);
+                Py_DECREF(name);
+
+                int index = (int)PyList_Size(names);
+                source_buffer_append(output, directive, snprintf(directive, sizeof(directive), "#line 1 %d\n", index));
+
+                Py_ssize_t content_size = 0;
+                const char * content_str = PyUnicode_AsUTF8AndSize(content, &content_size);
+                if (!content_str || !expand_includes(self, content_str, content_size, index, names, output)) {
+                    return false;
+                }
+
+                if (output->size && output->data[output->size - 1] != '\n') {
+                    source_buffer_append(output, "\n", 1);
+                }
+
+                source_buffer_append(output, directive, snprintf(directive, sizeof(directive), "#line %d %d\n", line + 1, source_index));
+            }
+        }
+
+        ptr = next;
+        line += 1;
+    }
+
+    return true;
+}
+
+// Returns a new reference to the (expanded_source, included_names) tuple, expanded sources are memoized
+static PyObject * preprocess_source(MGLContext * self, PyObject * source) {
+    PyObject * cached = PyDict_GetItem(self->include_cache, source);
+    if (cached) {
+        // Reinserted as the most recently used entry
+        Py_INCREF(cached);
+        PyDict_DelItem(self->include_cache, source);
+        PyDict_SetItem(self->include_cache, source, cached);
+        return cached;
+    }
+
+    Py_ssize_t size = 0;
+    const char * source_str = PyUnicode_AsUTF8AndSize(source, &size);
+    if (!source_str) {
+        return NULL;
+    }
+
+    if (!strstr(source_str, "include")) {
+        return Py_BuildValue("(ON)", source, PyTuple_New(0));
+    }
+
+    MGLSourceBuffer output = {};
+    PyObject * names = PyList_New(0);
+
+    if (!expand_includes(self, source_str, size, 0, names, &output)) {
+        PyMem_Free(output.data);
+        Py_DECREF(names);
+        return NULL;
+    }
+
+    PyObject * expanded = PyUnicode_FromStringAndSize(output.data, output.size);
+    PyMem_Free(output.data);
+
+    PyObject * result = Py_BuildValue("(NN)", expanded, PyList_AsTuple(names));
+    Py_DECREF(names);
+
+    // Dictionaries keep the insertion order, the first entry is the least recently used one
+    if (PyDict_Size(self->include_cache) >= INCLUDE_CACHE_SIZE) {
+        PyObject * oldest = NULL;
+        PyObject * value = NULL;
+        Py_ssize_t pos = 0;
+        PyDict_Next(self->include_cache, &pos, &oldest, &value);
+        Py_INCREF(oldest);
+        PyDict_DelItem(self->include_cache, oldest);
+        Py_DECREF(oldest);
+    }
+
+    PyDict_SetItem(self->include_cache, source, result);
+    return result;
+}
+
+static PyObject * MGLContext_preprocess(MGLContext * self, PyObject * args) {
+    PyObject * source;
+
+    if (!PyArg_ParseTuple(args, "U", &source)) {
+        return 0;
+    }
+
+    return preprocess_source(self, source);
+}
+
+static PyObject * stale_cache_keys(PyObject * cache, PyObject * name) {
+    PyObject * stale = PyList_New(0);
+
+    PyObject * key = NULL;
+    PyObject * value = NULL;
+    Py_ssize_t pos = 0;
+
+    // Cached values are tuples or lists with the names of the included sources as the second item
+    while (PyDict_Next(cache, &pos, &key, &value)) {
+        PyObject * included = PySequence_Fast_GET_ITEM(value, 1);
+        if (name == Py_None ? PyTuple_Size(included) > 0 : PySequence_Contains(included, name)) {
+            PyList_Append(stale, key);
+        }
+    }
+
+    return stale;
+}
+
+static PyObject * MGLContext_invalidate_includes(MGLContext * self, PyObject * args) {
+    PyObject * name;
+
+    if (!PyArg_ParseTuple(args, "O", &name)) {
+        return 0;
+    }
+
+    PyObject * stale = stale_cache_keys(self->include_cache, name);
+    for (int i = 0; i < PyList_Size(stale); ++i) {
+        PyDict_DelItem(self->include_cache, PyList_GetItem(stale, i));
+    }
+    Py_DECREF(stale);
+
+    // Shader objects compiled from outdated includes can never be hit again
+    stale = stale_cache_keys(self->shader_cache, name);
+    for (int i = 0; i < PyList_Size(stale); ++i) {
+        PyObject * key = PyList_GetItem(stale, i);
+        self->gl.DeleteShader(PyLong_AsLong(PyList_GET_ITEM(PyDict_GetItem(self->shader_cache, key), 0)));
+        PyDict_DelItem(self->shader_cache, key);
+    }
+    Py_DECREF(stale);
+
+    Py_RETURN_NONE;
+}
+
+// Cached shader objects are deleted with the last program using them, entries dropped from the cache are skipped
+static void release_cached_shaders(MGLContext * self, PyObject * cached_shaders) {
+    for (int i = 0; i < PyList_Size(cached_shaders); ++i) {
+        PyObject * key = PyTuple_GetItem(PyList_GetItem(cached_shaders, i), 0);
+        int shader_obj = PyLong_AsLong(PyTuple_GetItem(PyList_GetItem(cached_shaders, i), 1));
+        PyObject * entry = PyDict_GetItem(self->shader_cache, key);
+
+        if (!entry || PyLong_AsLong(PyList_GET_ITEM(entry, 0)) != shader_obj) {
+            continue;
+        }
+
+        long users = PyLong_AsLong(PyList_GET_ITEM(entry, 2)) - 1;
+        if (users) {
+            PyList_SetItem(entry, 2, PyLong_FromLong(users));
+        } else {
+            self->gl.DeleteShader(shader_obj);
+            PyDict_DelItem(self->shader_cache, key);
+        }
+    }
+
+    PyList_SetSlice(cached_shaders, 0, PyList_Size(cached_shaders), NULL);
+}
+
+static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
     PyObject * shaders[6];
     PyObject * varyings_arg;
     PyObject * fragment_outputs;
     int interleaved;
+    PyObject * specialization = Py_None;
+    int separable = false;
 
     int args_ok = PyArg_ParseTuple(
         args,
-        "OOOOOOOOp",
+        "OOOOOOOOp|Op",
         &shaders[0],
         &shaders[1],
         &shaders[2],
@@ -2186,7 +3705,9 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
         &shaders[5],
         &varyings_arg,
         &fragment_outputs,
-        &interleaved
+        &interleaved,
+        &specialization,
+        &separable
     );
 
     if (!args_ok) {
@@ -2203,6 +3724,9 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
     int varyings_count = (int)PyTuple_Size(varyings_arg);
 
     MGLProgram * program = PyObject_New(MGLProgram, MGLProgram_type);
+    program->vertex_formats = PyDict_New();
+    program->cached_shaders = PyList_New(0);
+    program->pipelines = 0;
     program->released = false;
 
     Py_INCREF(self);
@@ -2218,18 +3742,13 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
     }
 
     int shader_objs[] = {0, 0, 0, 0, 0, 0};
+    bool shader_cached[] = {false, false, false, false, false, false};
 
     for (int i = 0; i < NUM_SHADER_SLOTS; ++i) {
         if (shaders[i] == Py_None) {
             continue;
         }
 
-        int shader_obj = gl.CreateShader(SHADER_TYPE[i]);
-        if (!shader_obj) {
-            MGLError_Set("cannot create shader");
-            return 0;
-        }
-
         if (PyObject_HasAttrString(shaders[i], "to_shader_source")) {
             shaders[i] = PyObject_CallMethod(shaders[i], "to_shader_source", NULL);
             if (!shaders[i]) {
@@ -2239,11 +3758,47 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
             Py_INCREF(shaders[i]);
         }
 
+        // Shader objects compiled from identical GLSL sources are shared through the context cache,
+        // the entries count the programs using them
+        PyObject * cache_key = NULL;
+        PyObject * included = NULL;
+
         if (PyUnicode_Check(shaders[i])) {
-            shaders[i] = PyObject_CallMethod(helper, "resolve_includes", "(ON)", self, shaders[i]);
-            if (!shaders[i]) {
+            PyObject * preprocessed = preprocess_source(self, shaders[i]);
+            Py_DECREF(shaders[i]);
+            if (!preprocessed) {
                 return NULL;
             }
+            shaders[i] = PyTuple_GetItem(preprocessed, 0);
+            included = PyTuple_GetItem(preprocessed, 1);
+            Py_INCREF(shaders[i]);
+            Py_INCREF(included);
+            Py_DECREF(preprocessed);
+            cache_key = Py_BuildValue("(iO)", i, shaders[i]);
+            PyObject * cached = PyDict_GetItem(self->shader_cache, cache_key);
+            if (cached) {
+                shader_objs[i] = PyLong_AsLong(PyList_GET_ITEM(cached, 0));
+                PyList_SetItem(cached, 2, PyLong_FromLong(PyLong_AsLong(PyList_GET_ITEM(cached, 2)) + 1));
+                PyObject * user = Py_BuildValue("(Ni)", cache_key, shader_objs[i]);
+                PyList_Append(program->cached_shaders, user);
+                Py_DECREF(user);
+                Py_DECREF(included);
+                Py_DECREF(shaders[i]);
+                shader_cached[i] = true;
+                self->shader_cache_hits += 1;
+                gl.AttachShader(program_obj, shader_objs[i]);
+                continue;
+            }
+            self->shader_cache_misses += 1;
+        }
+
+        int shader_obj = gl.CreateShader(SHADER_TYPE[i]);
+        if (!shader_obj) {
+            MGLError_Set("cannot create shader");
+            return 0;
+        }
+
+        if (PyUnicode_Check(shaders[i])) {
             const char * source_str = PyUnicode_AsUTF8(shaders[i]);
             gl.ShaderSource(shader_obj, 1, &source_str, NULL);
             gl.CompileShader(shader_obj);
@@ -2252,7 +3807,34 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
             if (spv[0] == 0x07230203) {
                 int spv_length = (int)PyBytes_Size(shaders[i]);
                 gl.ShaderBinary(1, (unsigned *)&shader_obj, GL_SHADER_BINARY_FORMAT_SPIR_V, spv, spv_length);
-                gl.SpecializeShader(shader_obj, "main", 0, NULL, NULL);
+
+                // Specialization constants are given per stage as a tuple of (constant_id, value) pairs
+                PyObject * constants = specialization != Py_None ? PyTuple_GetItem(specialization, i) : Py_None;
+                if (!constants) {
+                    return NULL;
+                }
+
+                int num_constants = constants != Py_None ? (int)PyTuple_Size(constants) : 0;
+                unsigned * constant_ids = new unsigned[num_constants + 1];
+                unsigned * constant_values = new unsigned[num_constants + 1];
+
+                for (int k = 0; k < num_constants; ++k) {
+                    PyObject * constant = PyTuple_GetItem(constants, k);
+                    constant_ids[k] = (unsigned)PyLong_AsUnsignedLong(PyTuple_GetItem(constant, 0));
+                    constant_values[k] = (unsigned)PyLong_AsUnsignedLong(PyTuple_GetItem(constant, 1));
+                }
+
+                if (PyErr_Occurred()) {
+                    delete[] constant_ids;
+                    delete[] constant_values;
+                    MGLError_Set("invalid specialization constants");
+                    return NULL;
+                }
+
+                gl.SpecializeShader(shader_obj, "main", num_constants, constant_ids, constant_values);
+
+                delete[] constant_ids;
+                delete[] constant_values;
             } else {
                 const char * source_str = PyBytes_AsString(shaders[i]);
                 gl.ShaderSource(shader_obj, 1, &source_str, NULL);
@@ -2299,12 +3881,41 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
 
             gl.DeleteShader(shader_obj);
 
-            MGLError_Set("%s\n\n%s\n%s\n%s\n", message, title, underline, log);
+            // List the included sources to map the source string numbers in the log
+            PyObject * legend = PyUnicode_FromString("");
+            int num_included = included ? (int)PyTuple_Size(included) : 0;
+            for (int k = 0; k < num_included; ++k) {
+                PyObject * temp = PyUnicode_FromFormat("%U%d: %U\n", legend, k + 1, PyTuple_GetItem(included, k));
+                Py_DECREF(legend);
+                legend = temp;
+            }
+
+            if (num_included) {
+                MGLError_Set("%s\n\n%s\n%s\n%s\nincludes\n========\n%U", message, title, underline, log, legend);
+            } else {
+                MGLError_Set("%s\n\n%s\n%s\n%s\n", message, title, underline, log);
+            }
 
+            Py_DECREF(legend);
             delete[] log;
+            Py_XDECREF(cache_key);
+            Py_XDECREF(included);
+            release_cached_shaders(self, program->cached_shaders);
             return 0;
         }
 
+        if (cache_key) {
+            PyObject * value = Py_BuildValue("[iOi]", shader_obj, included, 1);
+            PyDict_SetItem(self->shader_cache, cache_key, value);
+            Py_DECREF(value);
+            PyObject * user = Py_BuildValue("(Ni)", cache_key, shader_obj);
+            PyList_Append(program->cached_shaders, user);
+            Py_DECREF(user);
+            shader_cached[i] = true;
+        }
+
+        Py_XDECREF(included);
+
         shader_objs[i] = shader_obj;
         gl.AttachShader(program_obj, shader_obj);
     }
@@ -2334,11 +3945,15 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
         }
     }
 
+    if (separable) {
+        gl.ProgramParameteri(program_obj, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    }
+
     gl.LinkProgram(program_obj);
 
-    // Delete the shader objects after the program is linked
+    // Delete the shader objects after the program is linked (cached shaders are owned by the cache)
     for (int i = 0; i < NUM_SHADER_SLOTS; ++i) {
-        if (shader_objs[i]) {
+        if (shader_objs[i] && !shader_cached[i]) {
             gl.DeleteShader(shader_objs[i]);
         }
     }
@@ -2358,6 +3973,7 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
         gl.GetProgramInfoLog(program_obj, log_len, &log_len, log);
 
         gl.DeleteProgram(program_obj);
+        release_cached_shaders(self, program->cached_shaders);
 
         MGLError_Set("%s\n\n%s\n%s\n%s\n", message, title, underline, log);
 
@@ -2564,8 +4180,8 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
         }
 
         PyObject * item = PyObject_CallMethod(
-            helper, "make_uniform", "(siiiiO)",
-            name, type, program->program_obj, location, array_length, self
+            helper, "make_uniform", "(siiiiOO)",
+            name, type, program->program_obj, location, array_length, self, program
         );
 
         PyDict_SetItemString(members_dict, name, item);
@@ -2618,6 +4234,32 @@ static PyObject * MGLContext_program(MGLContext * self, PyObject * args) {
     return Py_BuildValue("(ONNNi)", program, members_and_attributes, PyTuple_New(0), geom_info, program->program_obj);
 }
 
+static PyObject * MGLContext_clear_shader_cache(MGLContext * self, PyObject * args) {
+    const GLMethods & gl = self->gl;
+
+    PyObject * key = NULL;
+    PyObject * value = NULL;
+    Py_ssize_t pos = 0;
+
+    while (PyDict_Next(self->shader_cache, &pos, &key, &value)) {
+        gl.DeleteShader(PyLong_AsLong(PyList_GET_ITEM(value, 0)));
+    }
+
+    PyDict_Clear(self->shader_cache);
+    self->shader_cache_hits = 0;
+    self->shader_cache_misses = 0;
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLContext_shader_cache_stats(MGLContext * self, PyObject * args) {
+    return Py_BuildValue(
+        "{sn,sL,sL}",
+        "size", PyDict_Size(self->shader_cache),
+        "hits", self->shader_cache_hits,
+        "misses", self->shader_cache_misses
+    );
+}
+
 static PyObject * MGLProgram_run(MGLProgram * self, PyObject * args) {
     unsigned x;
     unsigned y;
@@ -2627,6 +4269,15 @@ static PyObject * MGLProgram_run(MGLProgram * self, PyObject * args) {
         return 0;
     }
 
+    if (self->context->recording) {
+        MGLCommand * command = record_command(self->context, MGL_COMMAND_COMPUTE, (PyObject *)self);
+        command->compute.program = self;
+        command->compute.x = x;
+        command->compute.y = y;
+        command->compute.z = z;
+        return record_handle(self->context);
+    }
+
     const GLMethods & gl = self->context->gl;
 
     gl.UseProgram(self->program_obj);
@@ -2635,6 +4286,10 @@ static PyObject * MGLProgram_run(MGLProgram * self, PyObject * args) {
 }
 
 static PyObject * MGLProgram_run_indirect(MGLProgram * self, PyObject * args) {
+    if (!check_not_recording(self->context)) {
+        return NULL;
+    }
+
     MGLBuffer * buffer;
     Py_ssize_t offset = 0;
 
@@ -2650,393 +4305,822 @@ static PyObject * MGLProgram_run_indirect(MGLProgram * self, PyObject * args) {
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLProgram_release(MGLProgram * self, PyObject * args) {
-    if (self->released) {
-        Py_RETURN_NONE;
+static PyObject * MGLProgram_swap(MGLProgram * self, PyObject * args) {
+    MGLProgram * other;
+
+    if (!PyArg_ParseTuple(args, "O!", MGLProgram_type, &other)) {
+        return NULL;
     }
-    self->released = true;
 
-    const GLMethods & gl = self->context->gl;
-    gl.DeleteProgram(self->program_obj);
+    if (self->released || other->released || other->context != self->context) {
+        MGLError_Set("cannot swap programs");
+        return NULL;
+    }
 
-    Py_DECREF(self);
+    std::swap(self->program_obj, other->program_obj);
+    std::swap(self->geometry_input, other->geometry_input);
+    std::swap(self->geometry_output, other->geometry_output);
+    std::swap(self->geometry_vertices, other->geometry_vertices);
+    std::swap(self->num_varyings, other->num_varyings);
+    std::swap(self->vertex_formats, other->vertex_formats);
+    std::swap(self->cached_shaders, other->cached_shaders);
+    std::swap(self->compute, other->compute);
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLContext_query(MGLContext * self, PyObject * args) {
-    int samples_passed;
-    int any_samples_passed;
-    int time_elapsed;
-    int primitives_generated;
-
-    int args_ok = PyArg_ParseTuple(
-        args,
-        "pppp",
-        &samples_passed,
-        &any_samples_passed,
-        &time_elapsed,
-        &primitives_generated
-    );
+static PyObject * MGLProgram_detect_format(MGLProgram * self, PyObject * args) {
+    PyObject * attributes;
+    PyObject * locations;
+    PyObject * types;
 
-    if (!args_ok) {
-        return 0;
+    if (!PyArg_ParseTuple(args, "O!O!O!", &PyTuple_Type, &attributes, &PyDict_Type, &locations, &PyDict_Type, &types)) {
+        return NULL;
     }
 
-    // If none of them is set, all will be set.
-    if (!(samples_passed + any_samples_passed + time_elapsed + primitives_generated)) {
-        samples_passed = 1;
-        any_samples_passed = 1;
-        time_elapsed = 1;
-        primitives_generated = 1;
+    PyObject * cached = PyDict_GetItem(self->vertex_formats, attributes);
+    if (cached) {
+        Py_INCREF(cached);
+        return cached;
     }
 
-    MGLQuery * query = PyObject_New(MGLQuery, MGLQuery_type);
-    query->query_obj[SAMPLES_PASSED] = 0;
-    query->query_obj[ANY_SAMPLES_PASSED] = 0;
-    query->query_obj[TIME_ELAPSED] = 0;
-    query->query_obj[PRIMITIVES_GENERATED] = 0;
-    query->released = false;
+    int num_attributes = (int)PyTuple_Size(attributes);
+    PyObject * parts = PyList_New(num_attributes);
 
-    Py_INCREF(self);
-    query->context = self;
+    for (int i = 0; i < num_attributes; ++i) {
+        PyObject * name = PyTuple_GetItem(attributes, i);
+        PyObject * location = PyLong_Check(name) ? name : PyDict_GetItem(locations, name);
+        PyObject * attribute = location ? PyDict_GetItem(types, location) : NULL;
 
-    query->state = QUERY_INACTIVE;
-    query->ended = false;
+        if (!attribute) {
+            PyErr_SetObject(PyExc_KeyError, location ? location : name);
+            Py_DECREF(parts);
+            return NULL;
+        }
 
-    const GLMethods & gl = self->gl;
+        PyObject * array_length = PyObject_GetAttrString(attribute, "array_length");
+        PyObject * dimension = PyObject_GetAttrString(attribute, "dimension");
+        PyObject * shape = PyObject_GetAttrString(attribute, "shape");
 
-    if (samples_passed) {
-        gl.GenQueries(1, (GLuint *)&query->query_obj[SAMPLES_PASSED]);
-    }
-    if (any_samples_passed) {
-        gl.GenQueries(1, (GLuint *)&query->query_obj[ANY_SAMPLES_PASSED]);
-    }
-    if (time_elapsed) {
-        gl.GenQueries(1, (GLuint *)&query->query_obj[TIME_ELAPSED]);
-    }
-    if (primitives_generated) {
-        gl.GenQueries(1, (GLuint *)&query->query_obj[PRIMITIVES_GENERATED]);
-    }
+        if (!array_length || !dimension || !shape) {
+            Py_XDECREF(array_length);
+            Py_XDECREF(dimension);
+            Py_XDECREF(shape);
+            Py_DECREF(parts);
+            return NULL;
+        }
 
-    return (PyObject *)query;
-}
+        // moderngl formats use f8 and u where the attribute shapes use d and I
+        const char * suffix = PyUnicode_AsUTF8(shape);
+        if (!strcmp(suffix, "d")) {
+            suffix = "f8";
+        } else if (!strcmp(suffix, "I")) {
+            suffix = "u";
+        }
 
-static PyObject * MGLQuery_begin(MGLQuery * self, PyObject * args) {
-    if (self->state != QUERY_INACTIVE) {
-        MGLError_Set(self->state == QUERY_ACTIVE ? "this query is already running" : "this query is in conditional render mode");
-        return NULL;
+        long count = PyLong_AsLong(array_length) * PyLong_AsLong(dimension);
+        PyList_SET_ITEM(parts, i, PyUnicode_FromFormat("%ld%s", count, suffix));
+
+        Py_DECREF(array_length);
+        Py_DECREF(dimension);
+        Py_DECREF(shape);
     }
 
-    const GLMethods & gl = self->context->gl;
+    PyObject * separator = PyUnicode_FromString(" ");
+    PyObject * res = PyUnicode_Join(separator, parts);
+    Py_DECREF(separator);
+    Py_DECREF(parts);
 
-    if (self->query_obj[SAMPLES_PASSED]) {
-        gl.BeginQuery(GL_SAMPLES_PASSED, self->query_obj[SAMPLES_PASSED]);
+    if (!res) {
+        return NULL;
     }
 
-    if (self->query_obj[ANY_SAMPLES_PASSED]) {
-        gl.BeginQuery(GL_ANY_SAMPLES_PASSED, self->query_obj[ANY_SAMPLES_PASSED]);
-    }
+    PyDict_SetItem(self->vertex_formats, attributes, res);
+    return res;
+}
 
-    if (self->query_obj[TIME_ELAPSED]) {
-        gl.BeginQuery(GL_TIME_ELAPSED, self->query_obj[TIME_ELAPSED]);
+static PyObject * MGLProgram_release(MGLProgram * self, PyObject * args) {
+    if (self->released) {
+        Py_RETURN_NONE;
     }
+    self->released = true;
 
-    if (self->query_obj[PRIMITIVES_GENERATED]) {
-        gl.BeginQuery(GL_PRIMITIVES_GENERATED, self->query_obj[PRIMITIVES_GENERATED]);
+    // A stage of a pipeline is deleted when the last pipeline using it is released
+    if (!self->pipelines) {
+        self->context->gl.DeleteProgram(self->program_obj);
     }
 
-    self->state = QUERY_ACTIVE;
+    release_cached_shaders(self->context, self->cached_shaders);
+    Py_CLEAR(self->cached_shaders);
+    Py_CLEAR(self->vertex_formats);
+    Py_DECREF(self);
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLQuery_end(MGLQuery * self, PyObject * args) {
-    if (self->state != QUERY_ACTIVE) {
-        MGLError_Set(self->state == QUERY_INACTIVE ? "this query was not started" : "this query is in conditional render mode");
-        return NULL;
-    }
-
-    const GLMethods & gl = self->context->gl;
+static PyObject * MGLContext_pipeline(MGLContext * self, PyObject * args) {
+    PyObject * stages;
 
-    if (self->query_obj[SAMPLES_PASSED]) {
-        gl.EndQuery(GL_SAMPLES_PASSED);
+    if (!PyArg_ParseTuple(args, "O!", &PyTuple_Type, &stages)) {
+        return 0;
     }
 
-    if (self->query_obj[ANY_SAMPLES_PASSED]) {
-        gl.EndQuery(GL_ANY_SAMPLES_PASSED);
+    const int STAGE_BITS[] = {
+        GL_VERTEX_SHADER_BIT,
+        GL_FRAGMENT_SHADER_BIT,
+        GL_GEOMETRY_SHADER_BIT,
+        GL_TESS_CONTROL_SHADER_BIT,
+        GL_TESS_EVALUATION_SHADER_BIT,
+    };
+
+    int num_stages = (int)PyTuple_Size(stages);
+    if (num_stages != 5) {
+        MGLError_Set("invalid stages");
+        return 0;
     }
 
-    if (self->query_obj[TIME_ELAPSED]) {
-        gl.EndQuery(GL_TIME_ELAPSED);
+    for (int i = 0; i < 5; ++i) {
+        PyObject * stage = PyTuple_GetItem(stages, i);
+        if (stage != Py_None && Py_TYPE(stage) != MGLProgram_type) {
+            MGLError_Set("stages[%d] must be a Program not %s", i, Py_TYPE(stage)->tp_name);
+            return 0;
+        }
+        if (stage != Py_None && ((MGLProgram *)stage)->context != self) {
+            MGLError_Set("stages[%d] belongs to a different context", i);
+            return 0;
+        }
     }
 
-    if (self->query_obj[PRIMITIVES_GENERATED]) {
-        gl.EndQuery(GL_PRIMITIVES_GENERATED);
-    }
+    const GLMethods & gl = self->gl;
 
-    self->state = QUERY_INACTIVE;
-    self->ended = true;
-    Py_RETURN_NONE;
-}
+    MGLProgramPipeline * pipeline = PyObject_New(MGLProgramPipeline, MGLProgramPipeline_type);
+    pipeline->released = false;
 
-static PyObject * MGLQuery_begin_render(MGLQuery * self, PyObject * args) {
-    if (self->state != QUERY_INACTIVE) {
-        MGLError_Set(self->state == QUERY_ACTIVE ? "this query was not stopped" : "this query is already in conditional render mode");
-        return NULL;
+    pipeline->pipeline_obj = 0;
+    gl.GenProgramPipelines(1, (GLuint *)&pipeline->pipeline_obj);
+
+    if (!pipeline->pipeline_obj) {
+        MGLError_Set("cannot create program pipeline");
+        Py_DECREF(pipeline);
+        return 0;
     }
 
-    const GLMethods & gl = self->context->gl;
+    for (int i = 0; i < 5; ++i) {
+        PyObject * stage = PyTuple_GetItem(stages, i);
+        if (stage == Py_None) {
+            pipeline->stages[i] = NULL;
+            continue;
+        }
 
-    if (self->query_obj[ANY_SAMPLES_PASSED]) {
-        gl.BeginConditionalRender(self->query_obj[ANY_SAMPLES_PASSED], GL_QUERY_NO_WAIT);
-    } else if (self->query_obj[SAMPLES_PASSED]) {
-        gl.BeginConditionalRender(self->query_obj[SAMPLES_PASSED], GL_QUERY_NO_WAIT);
-    } else {
-        MGLError_Set("no samples");
-        return NULL;
+        Py_INCREF(stage);
+        pipeline->stages[i] = (MGLProgram *)stage;
+        pipeline->stages[i]->pipelines += 1;
+        gl.UseProgramStages(pipeline->pipeline_obj, STAGE_BITS[i], pipeline->stages[i]->program_obj);
     }
 
-    self->state = QUERY_CONDITIONAL_RENDER;
-    Py_RETURN_NONE;
+    Py_INCREF(self);
+    pipeline->context = self;
+
+    return Py_BuildValue("(Oi)", pipeline, pipeline->pipeline_obj);
 }
 
-static PyObject * MGLQuery_end_render(MGLQuery * self, PyObject * args) {
-    if (self->state != QUERY_CONDITIONAL_RENDER) {
-        MGLError_Set("this query is not in conditional render mode");
-        return NULL;
+static PyObject * MGLProgramPipeline_release(MGLProgramPipeline * self, PyObject * args) {
+    if (self->released) {
+        Py_RETURN_NONE;
     }
+    self->released = true;
 
     const GLMethods & gl = self->context->gl;
-    gl.EndConditionalRender();
-    self->state = QUERY_INACTIVE;
+    gl.DeleteProgramPipelines(1, (GLuint *)&self->pipeline_obj);
+
+    for (int i = 0; i < 5; ++i) {
+        MGLProgram * stage = self->stages[i];
+        if (!stage) {
+            continue;
+        }
+
+        stage->pipelines -= 1;
+        if (stage->released && !stage->pipelines) {
+            gl.DeleteProgram(stage->program_obj);
+        }
+        Py_DECREF(stage);
+    }
+
+    Py_DECREF(self);
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLQuery_get_samples(MGLQuery * self, void * closure) {
-    if (!self->query_obj[SAMPLES_PASSED]) {
-        MGLError_Set("query created without the samples_passed flag");
-        return NULL;
-    }
+static PyObject * MGLContext_transform_feedback(MGLContext * self, PyObject * args) {
+    PyObject * outputs;
+    int num_streams;
 
-    if (self->state == QUERY_ACTIVE) {
-        MGLError_Set("this query was not stopped");
-        return NULL;
+    if (!PyArg_ParseTuple(args, "O!i", &PyTuple_Type, &outputs, &num_streams)) {
+        return 0;
     }
 
-    const GLMethods & gl = self->context->gl;
+    int max_streams = 1;
+    self->gl.GetIntegerv(GL_MAX_VERTEX_STREAMS, &max_streams);
 
-    unsigned samples = 0;
-    if (self->ended) {
-        gl.GetQueryObjectuiv(self->query_obj[SAMPLES_PASSED], GL_QUERY_RESULT, &samples);
+    if (num_streams < 1 || num_streams > MGL_MIN(max_streams, 4)) {
+        MGLError_Set("invalid number of streams %d", num_streams);
+        return 0;
     }
 
-    return PyLong_FromUnsignedLong(samples);
-}
+    int num_outputs = (int)PyTuple_Size(outputs);
 
-static PyObject * MGLQuery_get_primitives(MGLQuery * self, void * closure) {
-    if (!self->query_obj[PRIMITIVES_GENERATED]) {
-        MGLError_Set("query created without the primitives_generated flag");
-        return NULL;
-    }
+    int max_outputs = 0;
+    self->gl.GetIntegerv(GL_MAX_TRANSFORM_FEEDBACK_BUFFERS, &max_outputs);
 
-    if (self->state == QUERY_ACTIVE) {
-        MGLError_Set("this query was not stopped");
-        return NULL;
+    if (num_outputs > max_outputs) {
+        MGLError_Set("too many outputs %d, the maximum is %d", num_outputs, max_outputs);
+        return 0;
     }
 
-    const GLMethods & gl = self->context->gl;
+    PyObject * buffers = PyTuple_New(num_outputs);
+    Py_ssize_t * offsets = new Py_ssize_t[num_outputs + 1];
+    Py_ssize_t * sizes = new Py_ssize_t[num_outputs + 1];
 
-    unsigned primitives = 0;
-    if (self->ended) {
-        gl.GetQueryObjectuiv(self->query_obj[PRIMITIVES_GENERATED], GL_QUERY_RESULT, &primitives);
-    }
+    for (int i = 0; i < num_outputs; ++i) {
+        MGLBuffer * buffer;
+        Py_ssize_t offset;
+        Py_ssize_t size;
 
-    return PyLong_FromUnsignedLong(primitives);
-}
+        bool ok = PyArg_ParseTuple(PyTuple_GetItem(outputs, i), "O!nn", MGLBuffer_type, &buffer, &offset, &size);
 
-static PyObject * MGLQuery_get_elapsed(MGLQuery * self, void * closure) {
-    if (!self->query_obj[TIME_ELAPSED]) {
-        MGLError_Set("query created without the time_elapsed flag");
-        return NULL;
-    }
+        if (ok && size < 0) {
+            size = buffer->size - offset;
+        }
 
-    if (self->state == QUERY_ACTIVE) {
-        MGLError_Set("this query was not stopped");
-        return NULL;
+        if (ok && (buffer->context != self || offset < 0 || offset % 4 || size <= 0 || offset + size > buffer->size)) {
+            MGLError_Set("invalid output %d", i);
+            ok = false;
+        }
+
+        if (!ok) {
+            Py_DECREF(buffers);
+            delete[] offsets;
+            delete[] sizes;
+            return 0;
+        }
+
+        Py_INCREF(buffer);
+        PyTuple_SET_ITEM(buffers, i, (PyObject *)buffer);
+        offsets[i] = offset;
+        sizes[i] = size;
     }
 
-    const GLMethods & gl = self->context->gl;
+    const GLMethods & gl = self->gl;
 
-    unsigned elapsed = 0;
-    if (self->ended) {
-        gl.GetQueryObjectuiv(self->query_obj[TIME_ELAPSED], GL_QUERY_RESULT, &elapsed);
+    MGLTransformFeedback * feedback = PyObject_New(MGLTransformFeedback, MGLTransformFeedback_type);
+    feedback->outputs = buffers;
+    feedback->program_obj = 0;
+    feedback->primitive_mode = 0;
+    feedback->active = false;
+    feedback->captured = false;
+    feedback->released = false;
+
+    feedback->transform_feedback_obj = 0;
+    gl.GenTransformFeedbacks(1, (GLuint *)&feedback->transform_feedback_obj);
+
+    // Every stream counts the primitives written between the first transform and the end
+    feedback->num_streams = num_streams;
+    memset(feedback->query_obj, 0, sizeof(feedback->query_obj));
+    gl.GenQueries(num_streams, (GLuint *)feedback->query_obj);
+
+    // The output bindings are part of the transform feedback object
+    gl.BindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback->transform_feedback_obj);
+    for (int i = 0; i < num_outputs; ++i) {
+        MGLBuffer * buffer = (MGLBuffer *)PyTuple_GET_ITEM(buffers, i);
+        gl.BindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, i, buffer->buffer_obj, offsets[i], sizes[i]);
     }
+    gl.BindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
 
-    return PyLong_FromUnsignedLong(elapsed);
+    delete[] offsets;
+    delete[] sizes;
+
+    Py_INCREF(self);
+    feedback->context = self;
+
+    return Py_BuildValue("(Oi)", feedback, feedback->transform_feedback_obj);
 }
 
-static PyObject * MGLRenderbuffer_release(MGLRenderbuffer * self, PyObject * args) {
-    if (self->released) {
+static PyObject * MGLTransformFeedback_end(MGLTransformFeedback * self, PyObject * args) {
+    if (!self->active) {
         Py_RETURN_NONE;
     }
-    self->released = true;
 
     const GLMethods & gl = self->context->gl;
-    gl.DeleteRenderbuffers(1, (GLuint *)&self->renderbuffer_obj);
-
-    Py_DECREF(self);
-    Py_RETURN_NONE;
-}
 
-static PyObject * MGLContext_sampler(MGLContext * self, PyObject * args) {
-    int args_ok = PyArg_ParseTuple(
-        args,
-        ""
-    );
+    gl.BindTransformFeedback(GL_TRANSFORM_FEEDBACK, self->transform_feedback_obj);
+    gl.EndTransformFeedback();
+    gl.BindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
 
-    if (!args_ok) {
-        return 0;
+    for (int i = 0; i < self->num_streams; ++i) {
+        gl.EndQueryIndexed(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, i);
     }
 
-    const GLMethods & gl = self->gl;
-
-    MGLSampler * sampler = PyObject_New(MGLSampler, MGLSampler_type);
-    sampler->released = false;
+    if (self->context->capturing == self) {
+        self->context->capturing = NULL;
+    }
 
-    gl.GenSamplers(1, (GLuint *)&sampler->sampler_obj);
+    self->active = false;
+    self->captured = true;
+    Py_RETURN_NONE;
+}
 
-    sampler->min_filter = GL_LINEAR;
-    sampler->mag_filter = GL_LINEAR;
-    sampler->anisotropy = 0.0;
-    sampler->repeat_x = true;
-    sampler->repeat_y = true;
-    sampler->repeat_z = true;
-    sampler->compare_func = 0;
-    sampler->border_color[0] = 0.0;
-    sampler->border_color[1] = 0.0;
-    sampler->border_color[2] = 0.0;
-    sampler->border_color[3] = 0.0;
-    sampler->min_lod = -1000.0;
-    sampler->max_lod = 1000.0;
+static int MGLTransformFeedback_check_stream(MGLTransformFeedback * self, int stream) {
+    if (self->active) {
+        MGLError_Set("the transform feedback must be ended before reading its counters");
+        return -1;
+    }
 
-    Py_INCREF(self);
-    sampler->context = self;
+    if (stream < 0 || stream >= self->num_streams) {
+        MGLError_Set("invalid stream %d", stream);
+        return -1;
+    }
 
-    return Py_BuildValue("(Oi)", sampler, sampler->sampler_obj);
+    return 0;
 }
 
-static PyObject * MGLContext_memory_barrier(MGLContext * self, PyObject * args) {
-    unsigned barriers = GL_ALL_BARRIER_BITS;
-    int by_region = false;
+static PyObject * MGLTransformFeedback_primitives_written(MGLTransformFeedback * self, PyObject * args) {
+    int stream;
+    int wait;
 
-    if (!PyArg_ParseTuple(args, "|Ip", &barriers, &by_region)) {
+    if (!PyArg_ParseTuple(args, "ip", &stream, &wait)) {
         return 0;
     }
 
-    if (by_region && !self->gl.MemoryBarrierByRegion) {
-        by_region = false;
+    if (MGLTransformFeedback_check_stream(self, stream) < 0) {
+        return 0;
     }
 
-    if (by_region) {
-        self->gl.MemoryBarrierByRegion(barriers);
-    } else if (self->gl.MemoryBarrier) {
-        self->gl.MemoryBarrier(barriers);
+    if (!self->captured) {
+        return PyLong_FromLong(0);
     }
 
-    Py_RETURN_NONE;
+    const GLMethods & gl = self->context->gl;
+
+    // Without waiting the result is only read once the GPU made it available
+    if (!wait) {
+        unsigned available = 0;
+        gl.GetQueryObjectuiv(self->query_obj[stream], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            Py_RETURN_NONE;
+        }
+    }
+
+    unsigned primitives = 0;
+    gl.GetQueryObjectuiv(self->query_obj[stream], GL_QUERY_RESULT, &primitives);
+    return PyLong_FromUnsignedLong(primitives);
 }
 
-static PyObject * MGLSampler_use(MGLSampler * self, PyObject * args) {
-    int index;
+static PyObject * MGLTransformFeedback_write_primitives_written(MGLTransformFeedback * self, PyObject * args) {
+    MGLBuffer * buffer;
+    Py_ssize_t offset;
+    int stream;
 
-    if (!PyArg_ParseTuple(args, "I", &index)) {
+    if (!PyArg_ParseTuple(args, "O!ni", MGLBuffer_type, &buffer, &offset, &stream)) {
         return 0;
     }
 
-    const GLMethods & gl = self->context->gl;
-    gl.BindSampler(index, self->sampler_obj);
-    Py_RETURN_NONE;
-}
+    if (MGLTransformFeedback_check_stream(self, stream) < 0) {
+        return 0;
+    }
 
-static PyObject * MGLSampler_clear(MGLSampler * self, PyObject * args) {
-    int index;
+    if (!self->captured) {
+        MGLError_Set("the transform feedback has not captured anything yet");
+        return 0;
+    }
 
-    int args_ok = PyArg_ParseTuple(
-        args,
-        "I",
-        &index
-    );
+    if (self->context->version_code < 440) {
+        MGLError_Set("writing query results to buffers requires OpenGL 4.4");
+        return 0;
+    }
 
-    if (!args_ok) {
+    if (offset < 0 || offset % 4 || offset + 4 > buffer->size) {
+        MGLError_Set("invalid offset %d", (int)offset);
         return 0;
     }
 
     const GLMethods & gl = self->context->gl;
-    gl.BindSampler(index, 0);
 
+    // The GPU copies the result into the buffer when it becomes available, the CPU does not wait
+    gl.BindBuffer(GL_QUERY_BUFFER, buffer->buffer_obj);
+    gl.GetQueryObjectuiv(self->query_obj[stream], GL_QUERY_RESULT, (GLuint *)offset);
+    gl.BindBuffer(GL_QUERY_BUFFER, 0);
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLSampler_release(MGLSampler * self, PyObject * args) {
+static PyObject * MGLTransformFeedback_release(MGLTransformFeedback * self, PyObject * args) {
     if (self->released) {
         Py_RETURN_NONE;
     }
+
+    // Active transform feedback objects cannot be deleted
+    Py_DECREF(MGLTransformFeedback_end(self, NULL));
     self->released = true;
 
     const GLMethods & gl = self->context->gl;
-    gl.DeleteSamplers(1, (GLuint *)&self->sampler_obj);
+    gl.DeleteTransformFeedbacks(1, (GLuint *)&self->transform_feedback_obj);
+    gl.DeleteQueries(self->num_streams, (GLuint *)self->query_obj);
 
-    Py_DECREF(self);
+    Py_CLEAR(self->outputs);
     Py_DECREF(self->context);
+    Py_DECREF(self);
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLSampler_get_repeat_x(MGLSampler * self, void * closure) {
-    return PyBool_FromLong(self->repeat_x);
+static PyObject * MGLTransformFeedback_get_active(MGLTransformFeedback * self, void * closure) {
+    return PyBool_FromLong(self->active);
 }
 
-static int MGLSampler_set_repeat_x(MGLSampler * self, PyObject * value, void * closure) {
-    const GLMethods & gl = self->context->gl;
-
-    if (value == Py_True) {
-        gl.SamplerParameteri(self->sampler_obj, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        self->repeat_x = true;
-        return 0;
-    } else if (value == Py_False) {
-        gl.SamplerParameteri(self->sampler_obj, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        self->repeat_x = false;
-        return 0;
-    } else {
-        MGLError_Set("invalid value for texture_x");
-        return -1;
-    }
+static PyObject * MGLTransformFeedback_get_streams(MGLTransformFeedback * self, void * closure) {
+    return PyLong_FromLong(self->num_streams);
 }
 
-static PyObject * MGLSampler_get_repeat_y(MGLSampler * self, void * closure) {
-    return PyBool_FromLong(self->repeat_y);
-}
+static PyObject * MGLContext_query(MGLContext * self, PyObject * args) {
+    int samples_passed;
+    int any_samples_passed;
+    int time_elapsed;
+    int primitives_generated;
 
-static int MGLSampler_set_repeat_y(MGLSampler * self, PyObject * value, void * closure) {
-    const GLMethods & gl = self->context->gl;
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "pppp",
+        &samples_passed,
+        &any_samples_passed,
+        &time_elapsed,
+        &primitives_generated
+    );
 
-    if (value == Py_True) {
-        gl.SamplerParameteri(self->sampler_obj, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        self->repeat_y = true;
-        return 0;
-    } else if (value == Py_False) {
-        gl.SamplerParameteri(self->sampler_obj, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        self->repeat_y = false;
+    if (!args_ok) {
         return 0;
-    } else {
-        MGLError_Set("invalid value for texture_y");
-        return -1;
     }
-}
-
-static PyObject * MGLSampler_get_repeat_z(MGLSampler * self, void * closure) {
-    return PyBool_FromLong(self->repeat_z);
-}
 
-static int MGLSampler_set_repeat_z(MGLSampler * self, PyObject * value, void * closure) {
+    // If none of them is set, all will be set.
+    if (!(samples_passed + any_samples_passed + time_elapsed + primitives_generated)) {
+        samples_passed = 1;
+        any_samples_passed = 1;
+        time_elapsed = 1;
+        primitives_generated = 1;
+    }
+
+    MGLQuery * query = PyObject_New(MGLQuery, MGLQuery_type);
+    query->query_obj[SAMPLES_PASSED] = 0;
+    query->query_obj[ANY_SAMPLES_PASSED] = 0;
+    query->query_obj[TIME_ELAPSED] = 0;
+    query->query_obj[PRIMITIVES_GENERATED] = 0;
+    query->released = false;
+
+    Py_INCREF(self);
+    query->context = self;
+
+    query->state = QUERY_INACTIVE;
+    query->ended = false;
+
+    const GLMethods & gl = self->gl;
+
+    if (samples_passed) {
+        gl.GenQueries(1, (GLuint *)&query->query_obj[SAMPLES_PASSED]);
+    }
+    if (any_samples_passed) {
+        gl.GenQueries(1, (GLuint *)&query->query_obj[ANY_SAMPLES_PASSED]);
+    }
+    if (time_elapsed) {
+        gl.GenQueries(1, (GLuint *)&query->query_obj[TIME_ELAPSED]);
+    }
+    if (primitives_generated) {
+        gl.GenQueries(1, (GLuint *)&query->query_obj[PRIMITIVES_GENERATED]);
+    }
+
+    return (PyObject *)query;
+}
+
+static PyObject * MGLQuery_begin(MGLQuery * self, PyObject * args) {
+    if (self->state != QUERY_INACTIVE) {
+        MGLError_Set(self->state == QUERY_ACTIVE ? "this query is already running" : "this query is in conditional render mode");
+        return NULL;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    if (self->query_obj[SAMPLES_PASSED]) {
+        gl.BeginQuery(GL_SAMPLES_PASSED, self->query_obj[SAMPLES_PASSED]);
+    }
+
+    if (self->query_obj[ANY_SAMPLES_PASSED]) {
+        gl.BeginQuery(GL_ANY_SAMPLES_PASSED, self->query_obj[ANY_SAMPLES_PASSED]);
+    }
+
+    if (self->query_obj[TIME_ELAPSED]) {
+        gl.BeginQuery(GL_TIME_ELAPSED, self->query_obj[TIME_ELAPSED]);
+    }
+
+    if (self->query_obj[PRIMITIVES_GENERATED]) {
+        gl.BeginQuery(GL_PRIMITIVES_GENERATED, self->query_obj[PRIMITIVES_GENERATED]);
+    }
+
+    self->state = QUERY_ACTIVE;
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLQuery_end(MGLQuery * self, PyObject * args) {
+    if (self->state != QUERY_ACTIVE) {
+        MGLError_Set(self->state == QUERY_INACTIVE ? "this query was not started" : "this query is in conditional render mode");
+        return NULL;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    if (self->query_obj[SAMPLES_PASSED]) {
+        gl.EndQuery(GL_SAMPLES_PASSED);
+    }
+
+    if (self->query_obj[ANY_SAMPLES_PASSED]) {
+        gl.EndQuery(GL_ANY_SAMPLES_PASSED);
+    }
+
+    if (self->query_obj[TIME_ELAPSED]) {
+        gl.EndQuery(GL_TIME_ELAPSED);
+    }
+
+    if (self->query_obj[PRIMITIVES_GENERATED]) {
+        gl.EndQuery(GL_PRIMITIVES_GENERATED);
+    }
+
+    self->state = QUERY_INACTIVE;
+    self->ended = true;
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLQuery_begin_render(MGLQuery * self, PyObject * args) {
+    if (self->state != QUERY_INACTIVE) {
+        MGLError_Set(self->state == QUERY_ACTIVE ? "this query was not stopped" : "this query is already in conditional render mode");
+        return NULL;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    if (self->query_obj[ANY_SAMPLES_PASSED]) {
+        gl.BeginConditionalRender(self->query_obj[ANY_SAMPLES_PASSED], GL_QUERY_NO_WAIT);
+    } else if (self->query_obj[SAMPLES_PASSED]) {
+        gl.BeginConditionalRender(self->query_obj[SAMPLES_PASSED], GL_QUERY_NO_WAIT);
+    } else {
+        MGLError_Set("no samples");
+        return NULL;
+    }
+
+    self->state = QUERY_CONDITIONAL_RENDER;
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLQuery_end_render(MGLQuery * self, PyObject * args) {
+    if (self->state != QUERY_CONDITIONAL_RENDER) {
+        MGLError_Set("this query is not in conditional render mode");
+        return NULL;
+    }
+
+    const GLMethods & gl = self->context->gl;
+    gl.EndConditionalRender();
+    self->state = QUERY_INACTIVE;
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLQuery_get_samples(MGLQuery * self, void * closure) {
+    if (!self->query_obj[SAMPLES_PASSED]) {
+        MGLError_Set("query created without the samples_passed flag");
+        return NULL;
+    }
+
+    if (self->state == QUERY_ACTIVE) {
+        MGLError_Set("this query was not stopped");
+        return NULL;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    unsigned samples = 0;
+    if (self->ended) {
+        gl.GetQueryObjectuiv(self->query_obj[SAMPLES_PASSED], GL_QUERY_RESULT, &samples);
+    }
+
+    return PyLong_FromUnsignedLong(samples);
+}
+
+static PyObject * MGLQuery_get_primitives(MGLQuery * self, void * closure) {
+    if (!self->query_obj[PRIMITIVES_GENERATED]) {
+        MGLError_Set("query created without the primitives_generated flag");
+        return NULL;
+    }
+
+    if (self->state == QUERY_ACTIVE) {
+        MGLError_Set("this query was not stopped");
+        return NULL;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    unsigned primitives = 0;
+    if (self->ended) {
+        gl.GetQueryObjectuiv(self->query_obj[PRIMITIVES_GENERATED], GL_QUERY_RESULT, &primitives);
+    }
+
+    return PyLong_FromUnsignedLong(primitives);
+}
+
+static PyObject * MGLQuery_get_elapsed(MGLQuery * self, void * closure) {
+    if (!self->query_obj[TIME_ELAPSED]) {
+        MGLError_Set("query created without the time_elapsed flag");
+        return NULL;
+    }
+
+    if (self->state == QUERY_ACTIVE) {
+        MGLError_Set("this query was not stopped");
+        return NULL;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    unsigned elapsed = 0;
+    if (self->ended) {
+        gl.GetQueryObjectuiv(self->query_obj[TIME_ELAPSED], GL_QUERY_RESULT, &elapsed);
+    }
+
+    return PyLong_FromUnsignedLong(elapsed);
+}
+
+static PyObject * MGLRenderbuffer_release(MGLRenderbuffer * self, PyObject * args) {
+    if (self->released) {
+        Py_RETURN_NONE;
+    }
+    self->released = true;
+
+    const GLMethods & gl = self->context->gl;
+    gl.DeleteRenderbuffers(1, (GLuint *)&self->renderbuffer_obj);
+
+    Py_DECREF(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLContext_sampler(MGLContext * self, PyObject * args) {
+    int args_ok = PyArg_ParseTuple(
+        args,
+        ""
+    );
+
+    if (!args_ok) {
+        return 0;
+    }
+
+    const GLMethods & gl = self->gl;
+
+    MGLSampler * sampler = PyObject_New(MGLSampler, MGLSampler_type);
+    sampler->released = false;
+
+    gl.GenSamplers(1, (GLuint *)&sampler->sampler_obj);
+
+    sampler->min_filter = GL_LINEAR;
+    sampler->mag_filter = GL_LINEAR;
+    sampler->anisotropy = 0.0;
+    sampler->repeat_x = true;
+    sampler->repeat_y = true;
+    sampler->repeat_z = true;
+    sampler->compare_func = 0;
+    sampler->border_color[0] = 0.0;
+    sampler->border_color[1] = 0.0;
+    sampler->border_color[2] = 0.0;
+    sampler->border_color[3] = 0.0;
+    sampler->min_lod = -1000.0;
+    sampler->max_lod = 1000.0;
+
+    Py_INCREF(self);
+    sampler->context = self;
+
+    return Py_BuildValue("(Oi)", sampler, sampler->sampler_obj);
+}
+
+static PyObject * MGLContext_memory_barrier(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
+    unsigned barriers = GL_ALL_BARRIER_BITS;
+    int by_region = false;
+
+    if (!PyArg_ParseTuple(args, "|Ip", &barriers, &by_region)) {
+        return 0;
+    }
+
+    if (by_region && !self->gl.MemoryBarrierByRegion) {
+        by_region = false;
+    }
+
+    if (by_region) {
+        self->gl.MemoryBarrierByRegion(barriers);
+    } else if (self->gl.MemoryBarrier) {
+        self->gl.MemoryBarrier(barriers);
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLSampler_use(MGLSampler * self, PyObject * args) {
+    int index;
+
+    if (!PyArg_ParseTuple(args, "I", &index)) {
+        return 0;
+    }
+
+    if (self->context->recording) {
+        MGLCommand * command = record_command(self->context, MGL_COMMAND_BIND_SAMPLER, (PyObject *)self);
+        command->bind_sampler.sampler_obj = self->sampler_obj;
+        command->bind_sampler.unit = index;
+        return record_handle(self->context);
+    }
+
+    const GLMethods & gl = self->context->gl;
+    gl.BindSampler(index, self->sampler_obj);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLSampler_clear(MGLSampler * self, PyObject * args) {
+    int index;
+
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "I",
+        &index
+    );
+
+    if (!args_ok) {
+        return 0;
+    }
+
+    const GLMethods & gl = self->context->gl;
+    gl.BindSampler(index, 0);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLSampler_release(MGLSampler * self, PyObject * args) {
+    if (self->released) {
+        Py_RETURN_NONE;
+    }
+    self->released = true;
+
+    const GLMethods & gl = self->context->gl;
+    gl.DeleteSamplers(1, (GLuint *)&self->sampler_obj);
+
+    Py_DECREF(self);
+    Py_DECREF(self->context);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLSampler_get_repeat_x(MGLSampler * self, void * closure) {
+    return PyBool_FromLong(self->repeat_x);
+}
+
+static int MGLSampler_set_repeat_x(MGLSampler * self, PyObject * value, void * closure) {
+    const GLMethods & gl = self->context->gl;
+
+    if (value == Py_True) {
+        gl.SamplerParameteri(self->sampler_obj, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        self->repeat_x = true;
+        return 0;
+    } else if (value == Py_False) {
+        gl.SamplerParameteri(self->sampler_obj, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        self->repeat_x = false;
+        return 0;
+    } else {
+        MGLError_Set("invalid value for texture_x");
+        return -1;
+    }
+}
+
+static PyObject * MGLSampler_get_repeat_y(MGLSampler * self, void * closure) {
+    return PyBool_FromLong(self->repeat_y);
+}
+
+static int MGLSampler_set_repeat_y(MGLSampler * self, PyObject * value, void * closure) {
+    const GLMethods & gl = self->context->gl;
+
+    if (value == Py_True) {
+        gl.SamplerParameteri(self->sampler_obj, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        self->repeat_y = true;
+        return 0;
+    } else if (value == Py_False) {
+        gl.SamplerParameteri(self->sampler_obj, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        self->repeat_y = false;
+        return 0;
+    } else {
+        MGLError_Set("invalid value for texture_y");
+        return -1;
+    }
+}
+
+static PyObject * MGLSampler_get_repeat_z(MGLSampler * self, void * closure) {
+    return PyBool_FromLong(self->repeat_z);
+}
+
+static int MGLSampler_set_repeat_z(MGLSampler * self, PyObject * value, void * closure) {
     const GLMethods & gl = self->context->gl;
 
     if (value == Py_True) {
@@ -3310,17 +5394,20 @@ static PyObject * MGLContext_scope(MGLContext * self, PyObject * args) {
     PyObject * uniform_buffers_arg;
     PyObject * storage_buffers_arg;
     PyObject * samplers_arg;
+    PyObject * discard_arg;
 
     int args_ok = PyArg_ParseTuple(
         args,
-        "O!OOOOO",
+        "O!OOOOOO!",
         MGLFramebuffer_type,
         &framebuffer,
         &enable_flags,
         &textures_arg,
         &uniform_buffers_arg,
         &storage_buffers_arg,
-        &samplers_arg
+        &samplers_arg,
+        &PyTuple_Type,
+        &discard_arg
     );
 
     if (!args_ok) {
@@ -3364,9 +5451,18 @@ static PyObject * MGLContext_scope(MGLContext * self, PyObject * args) {
         }
     }
 
+    unsigned discard_attachments[66];
+    int num_discard_attachments = parse_invalidate_attachments(framebuffer, discard_arg, discard_attachments);
+    if (num_discard_attachments < 0) {
+        return 0;
+    }
+
     MGLScope * scope = PyObject_New(MGLScope, MGLScope_type);
     scope->released = false;
 
+    scope->num_discard_attachments = num_discard_attachments;
+    memcpy(scope->discard_attachments, discard_attachments, sizeof(discard_attachments));
+
     Py_INCREF(self);
     scope->context = self;
 
@@ -3426,13 +5522,19 @@ static PyObject * MGLContext_scope(MGLContext * self, PyObject * args) {
 }
 
 static PyObject * MGLScope_begin(MGLScope * self, PyObject * args) {
+    if (self->context->recording) {
+        MGLCommand * command = record_command(self->context, MGL_COMMAND_SCOPE_BEGIN, (PyObject *)self);
+        command->scope = self;
+        return record_handle(self->context);
+    }
+
     const GLMethods & gl = self->context->gl;
     const int & flags = self->enable_flags;
 
     self->old_enable_flags = self->context->enable_flags;
     self->context->enable_flags = self->enable_flags;
 
-    Py_XDECREF(MGLFramebuffer_use(self->framebuffer, NULL));
+    MGLFramebuffer_use_native(self->framebuffer);
 
     for (int i = 0; i < self->num_textures; ++i) {
         gl.ActiveTexture(self->textures[i].location);
@@ -3489,12 +5591,21 @@ static PyObject * MGLScope_begin(MGLScope * self, PyObject * args) {
 }
 
 static PyObject * MGLScope_end(MGLScope * self, PyObject * args) {
+    if (self->context->recording) {
+        MGLCommand * command = record_command(self->context, MGL_COMMAND_SCOPE_END, (PyObject *)self);
+        command->scope = self;
+        return record_handle(self->context);
+    }
+
     const GLMethods & gl = self->context->gl;
     const int & flags = self->old_enable_flags;
 
     self->context->enable_flags = self->old_enable_flags;
 
-    Py_XDECREF(MGLFramebuffer_use(self->old_framebuffer, NULL));
+    // The transient attachments are not read after the scope, the driver does not have to store them
+    MGLFramebuffer_invalidate_attachments(self->framebuffer, self->num_discard_attachments, self->discard_attachments, NULL);
+
+    MGLFramebuffer_use_native(self->old_framebuffer);
 
     if (flags & MGL_BLEND) {
         gl.Enable(GL_BLEND);
@@ -4279,6 +6390,10 @@ static PyObject * MGLTexture_use(MGLTexture * self, PyObject * args) {
 
     int texture_target = self->samples ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
 
+    if (self->context->recording) {
+        return record_bind_texture(self->context, (PyObject *)self, texture_target, self->texture_obj, index);
+    }
+
     const GLMethods & gl = self->context->gl;
     gl.ActiveTexture(GL_TEXTURE0 + index);
     gl.BindTexture(texture_target, self->texture_obj);
@@ -4286,6 +6401,34 @@ static PyObject * MGLTexture_use(MGLTexture * self, PyObject * args) {
     Py_RETURN_NONE;
 }
 
+static PyObject * MGLTexture_invalidate(MGLTexture * self, PyObject * args) {
+    int level;
+
+    if (!PyArg_ParseTuple(args, "I", &level)) {
+        return 0;
+    }
+
+    if (level > self->max_level) {
+        MGLError_Set("invalid level");
+        return 0;
+    }
+
+    if (self->context->recording) {
+        MGLCommand * command = record_command(self->context, MGL_COMMAND_INVALIDATE_TEXTURE, (PyObject *)self);
+        command->invalidate_texture.texture_obj = self->texture_obj;
+        command->invalidate_texture.level = level;
+        return record_handle(self->context);
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    if (gl.InvalidateTexImage) {
+        gl.InvalidateTexImage(self->texture_obj, level);
+    }
+
+    Py_RETURN_NONE;
+}
+
 static PyObject * MGLTexture_build_mipmaps(MGLTexture * self, PyObject * args) {
     int base = 0;
     int max = 1000;
@@ -4951,6 +7094,10 @@ static PyObject * MGLTexture3D_use(MGLTexture3D * self, PyObject * args) {
         return 0;
     }
 
+    if (self->context->recording) {
+        return record_bind_texture(self->context, (PyObject *)self, GL_TEXTURE_3D, self->texture_obj, index);
+    }
+
     const GLMethods & gl = self->context->gl;
     gl.ActiveTexture(GL_TEXTURE0 + index);
     gl.BindTexture(GL_TEXTURE_3D, self->texture_obj);
@@ -5599,6 +7746,9 @@ static PyObject * MGLTextureArray_use(MGLTextureArray * self, PyObject * args) {
         return 0;
     }
 
+    if (self->context->recording) {
+        return record_bind_texture(self->context, (PyObject *)self, GL_TEXTURE_2D_ARRAY, self->texture_obj, index);
+    }
 
     const GLMethods & gl = self->context->gl;
     gl.ActiveTexture(GL_TEXTURE0 + index);
@@ -6323,516 +8473,1055 @@ static PyObject * MGLTextureCube_write(MGLTextureCube * self, PyObject * args) {
         gl.PixelStorei(GL_UNPACK_ALIGNMENT, alignment);
         gl.TexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, viewport_rect.x, viewport_rect.y, viewport_rect.width, viewport_rect.height, format, pixel_type, buffer_view.buf);
 
-        PyBuffer_Release(&buffer_view);
+        PyBuffer_Release(&buffer_view);
+    }
+
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLTextureCube_meth_bind(MGLTextureCube * self, PyObject * args) {
+    int unit;
+    int read;
+    int write;
+    int level;
+    int format;
+
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "IppII",
+        &unit,
+        &read,
+        &write,
+        &level,
+        &format
+    );
+
+    if (!args_ok) {
+        return NULL;
+    }
+
+    int access = GL_READ_WRITE;
+    if (read && !write) access = GL_READ_ONLY;
+    else if (!read && write) access = GL_WRITE_ONLY;
+    else if (!read && !write) {
+        MGLError_Set("Illegal access mode. Read or write needs to be enabled.");
+        return NULL;
+    }
+
+    int frmt = format ? format : self->data_type->internal_format[self->components];
+
+    const GLMethods & gl = self->context->gl;
+    // NOTE: Texture cube must be bound as layered to expose all layers
+    gl.BindImageTexture(unit, self->texture_obj, level, GL_TRUE, 0, access, frmt);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLTextureCube_use(MGLTextureCube * self, PyObject * args) {
+    int index;
+
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "I",
+        &index
+    );
+
+    if (!args_ok) {
+        return 0;
+    }
+
+    if (self->context->recording) {
+        return record_bind_texture(self->context, (PyObject *)self, GL_TEXTURE_CUBE_MAP, self->texture_obj, index);
+    }
+
+    const GLMethods & gl = self->context->gl;
+    gl.ActiveTexture(GL_TEXTURE0 + index);
+    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLTextureCube_get_handle(MGLTextureCube * self, PyObject * args) {
+    int resident = true;
+
+    if(!PyArg_ParseTuple(args, "|p", &resident)) {
+        return NULL;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    unsigned long long handle = gl.GetTextureHandleARB(self->texture_obj);
+    if (resident) {
+        gl.MakeTextureHandleResidentARB(handle);
+    } else {
+        gl.MakeTextureHandleNonResidentARB(handle);
+    }
+
+    return PyLong_FromUnsignedLongLong(handle);
+}
+
+static PyObject * MGLTextureCube_build_mipmaps(MGLTextureCube * self, PyObject * args) {
+    int base = 0;
+    int max = 1000;
+
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "II",
+        &base,
+        &max
+    );
+
+    if (!args_ok) {
+        return 0;
+    }
+
+    if (base > self->max_level) {
+        MGLError_Set("invalid base");
+        return 0;
+    }
+
+    int texture_target = GL_TEXTURE_CUBE_MAP;
+
+    const GLMethods & gl = self->context->gl;
+
+    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
+    gl.BindTexture(texture_target, self->texture_obj);
+
+    gl.TexParameteri(texture_target, GL_TEXTURE_BASE_LEVEL, base);
+    gl.TexParameteri(texture_target, GL_TEXTURE_MAX_LEVEL, max);
+
+    gl.GenerateMipmap(texture_target);
+
+    gl.TexParameteri(texture_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    gl.TexParameteri(texture_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    self->min_filter = GL_LINEAR_MIPMAP_LINEAR;
+    self->mag_filter = GL_LINEAR;
+    self->max_level = max;
+
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLTextureCube_release(MGLTextureCube * self, PyObject * args) {
+    if (self->released) {
+        Py_RETURN_NONE;
+    }
+    self->released = true;
+
+    // TODO: decref
+
+    const GLMethods & gl = self->context->gl;
+    gl.DeleteTextures(1, (GLuint *)&self->texture_obj);
+
+    Py_DECREF(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLTextureCube_get_filter(MGLTextureCube * self, void * closure) {
+    return Py_BuildValue("(ii)", self->min_filter, self->mag_filter);
+}
+
+static int MGLTextureCube_set_filter(MGLTextureCube * self, PyObject * value, void * closure) {
+    if (!parse_filter(value, &self->min_filter, &self->mag_filter)) {
+        MGLError_Set("invalid filter");
+        return -1;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
+    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
+    gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, self->min_filter);
+    gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, self->mag_filter);
+
+    return 0;
+}
+
+static PyObject * MGLTextureCube_get_swizzle(MGLTextureCube * self, void * closure) {
+    if (self->depth) {
+        MGLError_Set("cannot get swizzle of depth textures");
+        return 0;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
+    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
+
+    int swizzle_r = 0;
+    int swizzle_g = 0;
+    int swizzle_b = 0;
+    int swizzle_a = 0;
+
+    gl.GetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_R, &swizzle_r);
+    gl.GetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_G, &swizzle_g);
+    gl.GetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_B, &swizzle_b);
+    gl.GetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_A, &swizzle_a);
+
+    char swizzle[5] = {
+        char_from_swizzle(swizzle_r),
+        char_from_swizzle(swizzle_g),
+        char_from_swizzle(swizzle_b),
+        char_from_swizzle(swizzle_a),
+        0,
+    };
+
+    return PyUnicode_FromStringAndSize(swizzle, 4);
+}
+
+static int MGLTextureCube_set_swizzle(MGLTextureCube * self, PyObject * value, void * closure) {
+    const char * swizzle = PyUnicode_AsUTF8(value);
+
+    if (self->depth) {
+        MGLError_Set("cannot set swizzle for depth textures");
+        return -1;
+    }
+
+    if (!swizzle[0]) {
+        MGLError_Set("the swizzle is empty");
+        return -1;
+    }
+
+    int tex_swizzle[4] = {-1, -1, -1, -1};
+
+    for (int i = 0; swizzle[i]; ++i) {
+        if (i > 3) {
+            MGLError_Set("the swizzle is too long");
+            return -1;
+        }
+
+        tex_swizzle[i] = swizzle_from_char(swizzle[i]);
+
+        if (tex_swizzle[i] == -1) {
+            MGLError_Set("'%c' is not a valid swizzle parameter", swizzle[i]);
+            return -1;
+        }
+    }
+
+
+    const GLMethods & gl = self->context->gl;
+
+    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
+    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
+
+    gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_R, tex_swizzle[0]);
+    if (tex_swizzle[1] != -1) {
+        gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_G, tex_swizzle[1]);
+        if (tex_swizzle[2] != -1) {
+            gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_B, tex_swizzle[2]);
+            if (tex_swizzle[3] != -1) {
+                gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_A, tex_swizzle[3]);
+            }
+        }
     }
 
-    Py_RETURN_NONE;
+    return 0;
 }
 
-static PyObject * MGLTextureCube_meth_bind(MGLTextureCube * self, PyObject * args) {
-    int unit;
-    int read;
-    int write;
-    int level;
-    int format;
+static PyObject * MGLTextureCube_get_compare_func(MGLTextureCube * self, void * closure) {
+    if (!self->depth) {
+        MGLError_Set("only depth textures have compare_func");
+        return 0;
+    }
 
-    int args_ok = PyArg_ParseTuple(
-        args,
-        "IppII",
-        &unit,
-        &read,
-        &write,
-        &level,
-        &format
-    );
+    return compare_func_to_string(self->compare_func);
+}
 
-    if (!args_ok) {
-        return NULL;
+static int MGLTextureCube_set_compare_func(MGLTextureCube * self, PyObject * value, void * closure) {
+    if (!self->depth) {
+        MGLError_Set("only depth textures have compare_func");
+        return -1;
     }
 
-    int access = GL_READ_WRITE;
-    if (read && !write) access = GL_READ_ONLY;
-    else if (!read && write) access = GL_WRITE_ONLY;
-    else if (!read && !write) {
-        MGLError_Set("Illegal access mode. Read or write needs to be enabled.");
-        return NULL;
+    const char * func = PyUnicode_AsUTF8(value);
+
+    if (PyErr_Occurred()) {
+        return -1;
     }
 
-    int frmt = format ? format : self->data_type->internal_format[self->components];
+    self->compare_func = compare_func_from_string(func);
 
     const GLMethods & gl = self->context->gl;
-    // NOTE: Texture cube must be bound as layered to expose all layers
-    gl.BindImageTexture(unit, self->texture_obj, level, GL_TRUE, 0, access, frmt);
-    Py_RETURN_NONE;
-}
+    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
+    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
+    if (self->compare_func == 0) {
+        gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    } else {
+        gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, self->compare_func);
+    }
 
-static PyObject * MGLTextureCube_use(MGLTextureCube * self, PyObject * args) {
-    int index;
+    return 0;
+}
 
-    int args_ok = PyArg_ParseTuple(
-        args,
-        "I",
-        &index
-    );
+static PyObject * MGLTextureCube_get_anisotropy(MGLTextureCube * self, void * closure) {
+    return PyFloat_FromDouble(self->anisotropy);
+}
 
-    if (!args_ok) {
-        return 0;
-    }
+static int MGLTextureCube_set_anisotropy(MGLTextureCube * self, PyObject * value, void * closure) {
+    if (self->context->max_anisotropy == 0) return 0;
+    self->anisotropy = (float)MGL_MIN(MGL_MAX(PyFloat_AsDouble(value), 1.0), self->context->max_anisotropy);
 
     const GLMethods & gl = self->context->gl;
-    gl.ActiveTexture(GL_TEXTURE0 + index);
+
+    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
     gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
+    gl.TexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_ANISOTROPY, self->anisotropy);
 
-    Py_RETURN_NONE;
+    return 0;
 }
 
-static PyObject * MGLTextureCube_get_handle(MGLTextureCube * self, PyObject * args) {
-    int resident = true;
+static PyObject * MGLContext_vertex_format(MGLContext * self, PyObject * args) {
+    const char * format;
 
-    if(!PyArg_ParseTuple(args, "|p", &resident)) {
+    if (!PyArg_ParseTuple(args, "s", &format)) {
         return NULL;
     }
 
-    const GLMethods & gl = self->context->gl;
+    MGLVertexFormat * res = parse_vertex_format(format);
 
-    unsigned long long handle = gl.GetTextureHandleARB(self->texture_obj);
-    if (resident) {
-        gl.MakeTextureHandleResidentARB(handle);
-    } else {
-        gl.MakeTextureHandleNonResidentARB(handle);
+    if (!res) {
+        MGLError_Set("invalid format: %s", format);
+        return NULL;
     }
 
-    return PyLong_FromUnsignedLongLong(handle);
+    return (PyObject *)res;
 }
 
-static PyObject * MGLTextureCube_build_mipmaps(MGLTextureCube * self, PyObject * args) {
-    int base = 0;
-    int max = 1000;
+static PyObject * MGLContext_vertex_array(MGLContext * self, PyObject * args) {
+    MGLProgram * program;
+    PyObject * content;
+    MGLBuffer * index_buffer;
+    int index_element_size;
 
     int args_ok = PyArg_ParseTuple(
         args,
-        "II",
-        &base,
-        &max
+        "OOOI",
+        &program,
+        &content,
+        &index_buffer,
+        &index_element_size
     );
 
     if (!args_ok) {
         return 0;
     }
 
-    if (base > self->max_level) {
-        MGLError_Set("invalid base");
+    // Vertex arrays created from a pipeline take the attributes of its vertex stage
+    MGLProgramPipeline * pipeline = NULL;
+
+    if (Py_TYPE(program) == MGLProgramPipeline_type) {
+        pipeline = (MGLProgramPipeline *)program;
+        program = pipeline->stages[VERTEX_SHADER_SLOT];
+        if (!program) {
+            MGLError_Set("the pipeline has no vertex stage");
+            return 0;
+        }
+    } else if (Py_TYPE(program) != MGLProgram_type) {
+        MGLError_Set("the program must be a Program or a ProgramPipeline not %s", Py_TYPE(program)->tp_name);
         return 0;
     }
 
-    int texture_target = GL_TEXTURE_CUBE_MAP;
+    if (program->context != self) {
+        MGLError_Set("the program belongs to a different context");
+        return 0;
+    }
 
-    const GLMethods & gl = self->context->gl;
+    if (index_buffer != (MGLBuffer *)Py_None && index_buffer->context != self) {
+        MGLError_Set("the index_buffer belongs to a different context");
+        return 0;
+    }
 
-    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
-    gl.BindTexture(texture_target, self->texture_obj);
+    int content_len = (int)PyTuple_GET_SIZE(content);
 
-    gl.TexParameteri(texture_target, GL_TEXTURE_BASE_LEVEL, base);
-    gl.TexParameteri(texture_target, GL_TEXTURE_MAX_LEVEL, max);
+    // Allow empty vertextbuffers: https://github.com/moderngl/moderngl/issues/321
+    // if (!content_len) {
+    // 	MGLError_Set("the content must not be emtpy");
+    // 	return 0;
+    // }
 
-    gl.GenerateMipmap(texture_target);
+    for (int i = 0; i < content_len; ++i) {
+        PyObject * tuple = PyTuple_GET_ITEM(content, i);
+        PyObject * buffer = PyTuple_GET_ITEM(tuple, 0);
+        PyObject * format = PyTuple_GET_ITEM(tuple, 1);
 
-    gl.TexParameteri(texture_target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    gl.TexParameteri(texture_target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        if (Py_TYPE(buffer) != MGLBuffer_type) {
+            MGLError_Set("content[%d][0] must be a Buffer not %s", i, Py_TYPE(buffer)->tp_name);
+            return 0;
+        }
 
-    self->min_filter = GL_LINEAR_MIPMAP_LINEAR;
-    self->mag_filter = GL_LINEAR;
-    self->max_level = max;
+        if (Py_TYPE(format) != MGLVertexFormat_type && !PyUnicode_Check(format)) {
+            MGLError_Set("content[%d][1] must be a string not %s", i, Py_TYPE(format)->tp_name);
+            return 0;
+        }
 
-    Py_RETURN_NONE;
-}
+        if (((MGLBuffer *)buffer)->context != self) {
+            MGLError_Set("content[%d][0] belongs to a different context", i);
+            return 0;
+        }
 
-static PyObject * MGLTextureCube_release(MGLTextureCube * self, PyObject * args) {
-    if (self->released) {
-        Py_RETURN_NONE;
-    }
-    self->released = true;
+        MGLVertexFormat * vertex_format = get_vertex_format(format);
 
-    // TODO: decref
+        if (!vertex_format) {
+            MGLError_Set("content[%d][1] is an invalid format", i);
+            return 0;
+        }
 
-    const GLMethods & gl = self->context->gl;
-    gl.DeleteTextures(1, (GLuint *)&self->texture_obj);
+        FormatInfo format_info = vertex_format->info;
+        Py_DECREF(vertex_format);
 
-    Py_DECREF(self);
-    Py_RETURN_NONE;
-}
+        int attributes_len = (int)PyTuple_GET_SIZE(tuple) - 2;
 
-static PyObject * MGLTextureCube_get_filter(MGLTextureCube * self, void * closure) {
-    return Py_BuildValue("(ii)", self->min_filter, self->mag_filter);
-}
+        if (!attributes_len) {
+            MGLError_Set("content[%d][2] must not be empty", i);
+            return 0;
+        }
 
-static int MGLTextureCube_set_filter(MGLTextureCube * self, PyObject * value, void * closure) {
-    if (!parse_filter(value, &self->min_filter, &self->mag_filter)) {
-        MGLError_Set("invalid filter");
-        return -1;
+        if (attributes_len != format_info.nodes) {
+            MGLError_Set("content[%d][1] and content[%d][2] size mismatch %d != %d", i, i, format_info.nodes, attributes_len);
+            return 0;
+        }
     }
 
-    const GLMethods & gl = self->context->gl;
+    if (index_buffer != (MGLBuffer *)Py_None && Py_TYPE(index_buffer) != MGLBuffer_type) {
+        MGLError_Set("the index_buffer must be a Buffer not %s", Py_TYPE(index_buffer)->tp_name);
+        return 0;
+    }
 
-    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
-    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
-    gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, self->min_filter);
-    gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, self->mag_filter);
+    if (index_element_size != 1 && index_element_size != 2 && index_element_size != 4) {
+        MGLError_Set("index_element_size must be 1, 2, or 4, not %d", index_element_size);
+        return 0;
+    }
 
-    return 0;
-}
+    const GLMethods & gl = self->gl;
 
-static PyObject * MGLTextureCube_get_swizzle(MGLTextureCube * self, void * closure) {
-    if (self->depth) {
-        MGLError_Set("cannot get swizzle of depth textures");
+    MGLVertexArray * array = PyObject_New(MGLVertexArray, MGLVertexArray_type);
+    array->released = false;
+
+    array->num_vertices = 0;
+    array->num_instances = 1;
+
+    Py_INCREF(program);
+    array->program = program;
+
+    Py_XINCREF(pipeline);
+    array->pipeline = pipeline;
+
+    array->vertex_array_obj = 0;
+    gl.GenVertexArrays(1, (GLuint *)&array->vertex_array_obj);
+
+    if (!array->vertex_array_obj) {
+        MGLError_Set("cannot create vertex array");
+        Py_DECREF(array);
         return 0;
     }
 
-    const GLMethods & gl = self->context->gl;
+    gl.BindVertexArray(array->vertex_array_obj);
+
+    Py_INCREF(index_buffer);
+    array->index_buffer = index_buffer;
+    array->index_element_size = index_element_size;
+
+    const int element_types[5] = {0, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, 0, GL_UNSIGNED_INT};
+    array->index_element_type = element_types[index_element_size];
+
+    if (index_buffer != (MGLBuffer *)Py_None) {
+        array->num_vertices = (int)(index_buffer->size / index_element_size);
+        gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer->buffer_obj);
+    } else {
+        array->num_vertices = -1;
+    }
+
+    // With ARB_vertex_attrib_binding every content entry gets its own vertex buffer binding,
+    // so the buffer can be replaced later without redefining the attribute formats
+    array->attrib_binding = self->version_code >= 430;
+    array->num_bindings = content_len;
+    array->bindings = (MGLVertexBinding *)PyMem_Malloc(MGL_MAX(content_len, 1) * sizeof(MGLVertexBinding));
+
+    for (int i = 0; i < content_len; ++i) {
+        PyObject * tuple = PyTuple_GET_ITEM(content, i);
+
+        MGLBuffer * buffer = (MGLBuffer *)PyTuple_GET_ITEM(tuple, 0);
+        MGLVertexFormat * vertex_format = get_vertex_format(PyTuple_GET_ITEM(tuple, 1));
+        FormatInfo format_info = vertex_format->info;
+        FormatNode * nodes = vertex_format->nodes;
+
+        array->bindings[i].size = format_info.size;
+        array->bindings[i].stride = format_info.size;
+        array->bindings[i].divisor = format_info.divisor;
+        array->bindings[i].vertices = (int)(buffer->size / format_info.size);
+
+        if (array->attrib_binding) {
+            gl.BindVertexBuffer(i, buffer->buffer_obj, 0, format_info.size);
+            gl.VertexBindingDivisor(i, format_info.divisor);
+        } else {
+            gl.BindBuffer(GL_ARRAY_BUFFER, buffer->buffer_obj);
+        }
+
+        char * ptr = 0;
+
+        int attributes_len = (int)PyTuple_GET_SIZE(tuple) - 2;
 
-    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
-    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
+        for (int j = 0; j < attributes_len; ++j) {
+            FormatNode * node = nodes++;
 
-    int swizzle_r = 0;
-    int swizzle_g = 0;
-    int swizzle_b = 0;
-    int swizzle_a = 0;
+            while (!node->type) {
+                ptr += node->size;
+                node = nodes++;
+            }
 
-    gl.GetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_R, &swizzle_r);
-    gl.GetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_G, &swizzle_g);
-    gl.GetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_B, &swizzle_b);
-    gl.GetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_A, &swizzle_a);
+            PyObject * attribute = PyTuple_GET_ITEM(tuple, j + 2);
 
-    char swizzle[5] = {
-        char_from_swizzle(swizzle_r),
-        char_from_swizzle(swizzle_g),
-        char_from_swizzle(swizzle_b),
-        char_from_swizzle(swizzle_a),
-        0,
-    };
+            if (attribute == Py_None) {
+                ptr += node->size;
+                continue;
+            }
 
-    return PyUnicode_FromStringAndSize(swizzle, 4);
-}
+            PyObject * attribute_location_py = PyObject_GetAttrString(attribute, "location");
+            PyObject * attribute_rows_length_py = PyObject_GetAttrString(attribute, "rows_length");
+            PyObject * attribute_scalar_type_py = PyObject_GetAttrString(attribute, "scalar_type");
+            if (!attribute_location_py || !attribute_rows_length_py || !attribute_scalar_type_py) {
+                return NULL;
+            }
 
-static int MGLTextureCube_set_swizzle(MGLTextureCube * self, PyObject * value, void * closure) {
-    const char * swizzle = PyUnicode_AsUTF8(value);
+            int attribute_location = PyLong_AsLong(attribute_location_py);
+            int attribute_rows_length = PyLong_AsLong(attribute_rows_length_py);
+            int attribute_scalar_type = PyLong_AsLong(attribute_scalar_type_py);
 
-    if (self->depth) {
-        MGLError_Set("cannot set swizzle for depth textures");
-        return -1;
-    }
+            for (int r = 0; r < attribute_rows_length; ++r) {
+                int location = attribute_location + r;
+                int count = node->count / attribute_rows_length;
 
-    if (!swizzle[0]) {
-        MGLError_Set("the swizzle is empty");
-        return -1;
-    }
+                if (array->attrib_binding) {
+                    unsigned offset = (unsigned)(GLintptr)ptr;
+                    switch (attribute_scalar_type) {
+                        case GL_FLOAT: gl.VertexAttribFormat(location, count, node->type, node->normalize, offset); break;
+                        case GL_DOUBLE: gl.VertexAttribLFormat(location, count, node->type, offset); break;
+                        case GL_INT: gl.VertexAttribIFormat(location, count, node->type, offset); break;
+                        case GL_UNSIGNED_INT: gl.VertexAttribIFormat(location, count, node->type, offset); break;
+                    }
 
-    int tex_swizzle[4] = {-1, -1, -1, -1};
+                    gl.VertexAttribBinding(location, i);
+                } else {
+                    switch (attribute_scalar_type) {
+                        case GL_FLOAT: gl.VertexAttribPointer(location, count, node->type, node->normalize, format_info.size, ptr); break;
+                        case GL_DOUBLE: gl.VertexAttribLPointer(location, count, node->type, format_info.size, ptr); break;
+                        case GL_INT: gl.VertexAttribIPointer(location, count, node->type, format_info.size, ptr); break;
+                        case GL_UNSIGNED_INT: gl.VertexAttribIPointer(location, count, node->type, format_info.size, ptr); break;
+                    }
 
-    for (int i = 0; swizzle[i]; ++i) {
-        if (i > 3) {
-            MGLError_Set("the swizzle is too long");
-            return -1;
-        }
+                    gl.VertexAttribDivisor(location, format_info.divisor);
+                }
 
-        tex_swizzle[i] = swizzle_from_char(swizzle[i]);
+                gl.EnableVertexAttribArray(location);
 
-        if (tex_swizzle[i] == -1) {
-            MGLError_Set("'%c' is not a valid swizzle parameter", swizzle[i]);
-            return -1;
+                ptr += node->size / attribute_rows_length;
+            }
         }
+
+        Py_DECREF(vertex_format);
     }
 
+    MGLVertexArray_update_vertices(array);
+
+    Py_INCREF(self);
+    array->context = self;
+
+    return Py_BuildValue("(Oi)", array, array->vertex_array_obj);
+}
 
+// Bind the program or the program pipeline used for drawing followed by the vertex array
+static int MGLVertexArray_use(MGLVertexArray * self, PyObject * program) {
     const GLMethods & gl = self->context->gl;
 
-    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
-    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
+    // Clearing or reading another framebuffer may have left it bound
+    MGLFramebuffer_apply(self->context->bound_framebuffer);
 
-    gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_R, tex_swizzle[0]);
-    if (tex_swizzle[1] != -1) {
-        gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_G, tex_swizzle[1]);
-        if (tex_swizzle[2] != -1) {
-            gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_B, tex_swizzle[2]);
-            if (tex_swizzle[3] != -1) {
-                gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_A, tex_swizzle[3]);
-            }
-        }
+    if (program == Py_None) {
+        program = self->pipeline ? (PyObject *)self->pipeline : (PyObject *)self->program;
     }
 
-    return 0;
-}
-
-static PyObject * MGLTextureCube_get_compare_func(MGLTextureCube * self, void * closure) {
-    if (!self->depth) {
-        MGLError_Set("only depth textures have compare_func");
-        return 0;
+    if (Py_TYPE(program) == MGLProgramPipeline_type) {
+        // A program bound with UseProgram takes precedence over the bound pipeline
+        gl.UseProgram(0);
+        gl.BindProgramPipeline(((MGLProgramPipeline *)program)->pipeline_obj);
+    } else if (Py_TYPE(program) == MGLProgram_type) {
+        gl.UseProgram(((MGLProgram *)program)->program_obj);
+    } else {
+        MGLError_Set("the program must be a Program or a ProgramPipeline not %s", Py_TYPE(program)->tp_name);
+        return -1;
     }
 
-    return compare_func_to_string(self->compare_func);
+    gl.BindVertexArray(self->vertex_array_obj);
+    return 0;
 }
 
-static int MGLTextureCube_set_compare_func(MGLTextureCube * self, PyObject * value, void * closure) {
-    if (!self->depth) {
-        MGLError_Set("only depth textures have compare_func");
+static int MGLVertexArray_draw(MGLVertexArray * self, int mode, int vertices, int first, int instances, PyObject * program) {
+    if (self->released) {
+        MGLError_Set("the vertex array was released");
         return -1;
     }
 
-    const char * func = PyUnicode_AsUTF8(value);
+    if (vertices < 0) {
+        if (self->num_vertices < 0) {
+            MGLError_Set("cannot detect the number of vertices");
+            return -1;
+        }
 
-    if (PyErr_Occurred()) {
-        return -1;
+        vertices = self->num_vertices;
     }
 
-    self->compare_func = compare_func_from_string(func);
+    if (instances < 0) {
+        instances = self->num_instances;
+    }
 
     const GLMethods & gl = self->context->gl;
-    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
-    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
-    if (self->compare_func == 0) {
-        gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    if (MGLVertexArray_use(self, program) < 0) {
+        return -1;
+    }
+
+    if (self->index_buffer != (MGLBuffer *)Py_None) {
+        const void * ptr = (const void *)((GLintptr)first * self->index_element_size);
+        gl.DrawElementsInstanced(mode, vertices, self->index_element_type, ptr, instances);
     } else {
-        gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-        gl.TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, self->compare_func);
+        gl.DrawArraysInstanced(mode, first, vertices, instances);
     }
 
     return 0;
 }
 
-static PyObject * MGLTextureCube_get_anisotropy(MGLTextureCube * self, void * closure) {
-    return PyFloat_FromDouble(self->anisotropy);
-}
+static PyObject * MGLVertexArray_render(MGLVertexArray * self, PyObject * args) {
+    int mode;
+    int vertices;
+    int first;
+    int instances;
+    PyObject * program = Py_None;
 
-static int MGLTextureCube_set_anisotropy(MGLTextureCube * self, PyObject * value, void * closure) {
-    if (self->context->max_anisotropy == 0) return 0;
-    self->anisotropy = (float)MGL_MIN(MGL_MAX(PyFloat_AsDouble(value), 1.0), self->context->max_anisotropy);
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "IIII|O",
+        &mode,
+        &vertices,
+        &first,
+        &instances,
+        &program
+    );
 
-    const GLMethods & gl = self->context->gl;
+    if (!args_ok) {
+        return 0;
+    }
 
-    gl.ActiveTexture(GL_TEXTURE0 + self->context->default_texture_unit);
-    gl.BindTexture(GL_TEXTURE_CUBE_MAP, self->texture_obj);
-    gl.TexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_ANISOTROPY, self->anisotropy);
+    if (self->context->recording) {
+        return record_render(self, mode, vertices, first, instances, program);
+    }
 
-    return 0;
+    if (MGLVertexArray_draw(self, mode, vertices, first, instances, program) < 0) {
+        return 0;
+    }
+
+    Py_RETURN_NONE;
 }
 
-static PyObject * MGLContext_vertex_array(MGLContext * self, PyObject * args) {
-    MGLProgram * program;
-    PyObject * content;
-    MGLBuffer * index_buffer;
-    int index_element_size;
+static PyObject * MGLVertexArray_render_base_vertex(MGLVertexArray * self, PyObject * args) {
+    if (!check_not_recording(self->context)) {
+        return NULL;
+    }
+
+    int mode;
+    int vertices;
+    int first;
+    int base_vertex;
+    int instances;
+    int base_instance;
+    PyObject * program = Py_None;
 
     int args_ok = PyArg_ParseTuple(
         args,
-        "O!OOI",
-        MGLProgram_type,
-        &program,
-        &content,
-        &index_buffer,
-        &index_element_size
+        "IIIiII|O",
+        &mode,
+        &vertices,
+        &first,
+        &base_vertex,
+        &instances,
+        &base_instance,
+        &program
     );
 
     if (!args_ok) {
         return 0;
     }
 
-    if (program->context != self) {
-        MGLError_Set("the program belongs to a different context");
+    if (self->released) {
+        MGLError_Set("the vertex array was released");
         return 0;
     }
 
-    if (index_buffer != (MGLBuffer *)Py_None && index_buffer->context != self) {
-        MGLError_Set("the index_buffer belongs to a different context");
+    bool indexed = self->index_buffer != (MGLBuffer *)Py_None;
+
+    if (base_vertex && !indexed) {
+        MGLError_Set("base_vertex requires an index buffer");
         return 0;
     }
 
-    int content_len = (int)PyTuple_GET_SIZE(content);
+    const GLMethods & gl = self->context->gl;
 
-    // Allow empty vertextbuffers: https://github.com/moderngl/moderngl/issues/321
-    // if (!content_len) {
-    // 	MGLError_Set("the content must not be emtpy");
-    // 	return 0;
-    // }
+    if (base_instance && (indexed ? !gl.DrawElementsInstancedBaseVertexBaseInstance : !gl.DrawArraysInstancedBaseInstance)) {
+        MGLError_Set("base_instance requires OpenGL 4.2");
+        return 0;
+    }
 
-    for (int i = 0; i < content_len; ++i) {
-        PyObject * tuple = PyTuple_GET_ITEM(content, i);
-        PyObject * buffer = PyTuple_GET_ITEM(tuple, 0);
-        PyObject * format = PyTuple_GET_ITEM(tuple, 1);
+    if (MGLVertexArray_use(self, program) < 0) {
+        return 0;
+    }
 
-        if (Py_TYPE(buffer) != MGLBuffer_type) {
-            MGLError_Set("content[%d][0] must be a Buffer not %s", i, Py_TYPE(buffer)->tp_name);
-            return 0;
+    if (indexed) {
+        const void * ptr = (const void *)((GLintptr)first * self->index_element_size);
+        if (base_instance) {
+            gl.DrawElementsInstancedBaseVertexBaseInstance(mode, vertices, self->index_element_type, ptr, instances, base_vertex, base_instance);
+        } else if (instances == 1) {
+            gl.DrawElementsBaseVertex(mode, vertices, self->index_element_type, ptr, base_vertex);
+        } else {
+            gl.DrawElementsInstancedBaseVertex(mode, vertices, self->index_element_type, ptr, instances, base_vertex);
         }
+    } else if (base_instance) {
+        gl.DrawArraysInstancedBaseInstance(mode, first, vertices, instances, base_instance);
+    } else {
+        gl.DrawArraysInstanced(mode, first, vertices, instances);
+    }
 
-        if (Py_TYPE(format) != &PyUnicode_Type) {
-            MGLError_Set("content[%d][1] must be a string not %s", i, Py_TYPE(format)->tp_name);
-            return 0;
-        }
+    Py_RETURN_NONE;
+}
 
-        if (((MGLBuffer *)buffer)->context != self) {
-            MGLError_Set("content[%d][0] belongs to a different context", i);
-            return 0;
-        }
+static int get_int32_buffer(PyObject * data, Py_buffer * view, const char * name) {
+    if (PyObject_GetBuffer(data, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        PyErr_Clear();
+        MGLError_Set("%s must be a contiguous int32 buffer", name);
+        return -1;
+    }
 
-        FormatIterator it = FormatIterator(PyUnicode_AsUTF8(format));
-        FormatInfo format_info = it.info();
+    // Raw bytes are accepted as native int32 values
+    bool raw = view->itemsize == 1 && (!view->format || !strcmp(view->format, "B"));
+    bool int32 = view->itemsize == 4 && view->format && *view->format && strchr("iIlL", view->format[strlen(view->format) - 1]);
 
-        if (!format_info.valid) {
-            MGLError_Set("content[%d][1] is an invalid format", i);
-            return 0;
-        }
+    if ((!raw && !int32) || view->len % 4) {
+        PyBuffer_Release(view);
+        MGLError_Set("%s must be a contiguous int32 buffer", name);
+        return -1;
+    }
 
-        int attributes_len = (int)PyTuple_GET_SIZE(tuple) - 2;
+    return (int)(view->len / 4);
+}
 
-        if (!attributes_len) {
-            MGLError_Set("content[%d][2] must not be empty", i);
-            return 0;
-        }
+static PyObject * MGLVertexArray_render_multi(MGLVertexArray * self, PyObject * args) {
+    if (!check_not_recording(self->context)) {
+        return NULL;
+    }
 
-        if (attributes_len != format_info.nodes) {
-            MGLError_Set("content[%d][1] and content[%d][2] size mismatch %d != %d", i, i, format_info.nodes, attributes_len);
-            return 0;
-        }
+    int mode;
+    PyObject * firsts_arg;
+    PyObject * counts_arg;
+    PyObject * base_vertices_arg;
+    PyObject * program = Py_None;
+
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "IOOO|O",
+        &mode,
+        &firsts_arg,
+        &counts_arg,
+        &base_vertices_arg,
+        &program
+    );
+
+    if (!args_ok) {
+        return 0;
+    }
+
+    bool indexed = self->index_buffer != (MGLBuffer *)Py_None;
+
+    if (base_vertices_arg != Py_None && !indexed) {
+        MGLError_Set("base_vertices requires an index buffer");
+        return 0;
+    }
+
+    Py_buffer firsts;
+    Py_buffer counts;
+    Py_buffer base_vertices = {};
+
+    int draw_count = get_int32_buffer(firsts_arg, &firsts, "firsts");
+    if (draw_count < 0) {
+        return 0;
     }
 
-    if (index_buffer != (MGLBuffer *)Py_None && Py_TYPE(index_buffer) != MGLBuffer_type) {
-        MGLError_Set("the index_buffer must be a Buffer not %s", Py_TYPE(index_buffer)->tp_name);
+    if (get_int32_buffer(counts_arg, &counts, "counts") != draw_count) {
+        if (!PyErr_Occurred()) {
+            PyBuffer_Release(&counts);
+            MGLError_Set("firsts and counts must have the same length");
+        }
+        PyBuffer_Release(&firsts);
         return 0;
     }
 
-    if (index_element_size != 1 && index_element_size != 2 && index_element_size != 4) {
-        MGLError_Set("index_element_size must be 1, 2, or 4, not %d", index_element_size);
+    if (base_vertices_arg != Py_None && get_int32_buffer(base_vertices_arg, &base_vertices, "base_vertices") != draw_count) {
+        if (!PyErr_Occurred()) {
+            PyBuffer_Release(&base_vertices);
+            MGLError_Set("firsts and base_vertices must have the same length");
+        }
+        PyBuffer_Release(&firsts);
+        PyBuffer_Release(&counts);
         return 0;
     }
 
-    const GLMethods & gl = self->gl;
+    const GLMethods & gl = self->context->gl;
 
-    MGLVertexArray * array = PyObject_New(MGLVertexArray, MGLVertexArray_type);
-    array->released = false;
+    if (draw_count && MGLVertexArray_use(self, program) >= 0) {
+        const int * first_ptr = (const int *)firsts.buf;
+        const int * count_ptr = (const int *)counts.buf;
 
-    array->num_vertices = 0;
-    array->num_instances = 1;
+        if (indexed) {
+            // MultiDrawElements takes byte offsets into the index buffer
+            const void ** indices = new const void * [draw_count];
+            for (int i = 0; i < draw_count; ++i) {
+                indices[i] = (const void *)((GLintptr)first_ptr[i] * self->index_element_size);
+            }
 
-    Py_INCREF(program);
-    array->program = program;
+            if (base_vertices.buf) {
+                gl.MultiDrawElementsBaseVertex(mode, count_ptr, self->index_element_type, indices, draw_count, (const int *)base_vertices.buf);
+            } else {
+                gl.MultiDrawElements(mode, count_ptr, self->index_element_type, indices, draw_count);
+            }
 
-    array->vertex_array_obj = 0;
-    gl.GenVertexArrays(1, (GLuint *)&array->vertex_array_obj);
+            delete[] indices;
+        } else {
+            gl.MultiDrawArrays(mode, first_ptr, count_ptr, draw_count);
+        }
+    }
 
-    if (!array->vertex_array_obj) {
-        MGLError_Set("cannot create vertex array");
-        Py_DECREF(array);
+    PyBuffer_Release(&firsts);
+    PyBuffer_Release(&counts);
+    if (base_vertices.buf) {
+        PyBuffer_Release(&base_vertices);
+    }
+
+    if (PyErr_Occurred()) {
         return 0;
     }
 
-    gl.BindVertexArray(array->vertex_array_obj);
+    Py_RETURN_NONE;
+}
 
-    Py_INCREF(index_buffer);
-    array->index_buffer = index_buffer;
-    array->index_element_size = index_element_size;
+static PyObject * MGLVertexArray_render_indirect(MGLVertexArray * self, PyObject * args) {
+    if (!check_not_recording(self->context)) {
+        return NULL;
+    }
 
-    const int element_types[5] = {0, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, 0, GL_UNSIGNED_INT};
-    array->index_element_type = element_types[index_element_size];
+    MGLBuffer * buffer;
+    int mode;
+    int count;
+    int first;
+    PyObject * count_buffer;
+    Py_ssize_t count_offset;
+    int max_count;
+    int stride;
 
-    if (index_buffer != (MGLBuffer *)Py_None) {
-        array->num_vertices = (int)(index_buffer->size / index_element_size);
-        gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer->buffer_obj);
-    } else {
-        array->num_vertices = -1;
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "O!IiiOnii",
+        MGLBuffer_type,
+        &buffer,
+        &mode,
+        &count,
+        &first,
+        &count_buffer,
+        &count_offset,
+        &max_count,
+        &stride
+    );
+
+    if (!args_ok) {
+        return 0;
     }
 
-    for (int i = 0; i < content_len; ++i) {
-        PyObject * tuple = PyTuple_GET_ITEM(content, i);
+    if (count_buffer != Py_None && Py_TYPE(count_buffer) != MGLBuffer_type) {
+        MGLError_Set("the count_buffer must be a Buffer or None");
+        return 0;
+    }
 
-        MGLBuffer * buffer = (MGLBuffer *)PyTuple_GET_ITEM(tuple, 0);
-        const char * format = PyUnicode_AsUTF8(PyTuple_GET_ITEM(tuple, 1));
+    bool indexed = self->index_buffer != (MGLBuffer *)Py_None;
 
-        FormatIterator it = FormatIterator(format);
-        FormatInfo format_info = it.info();
+    // DrawArraysIndirectCommand is 4 integers, DrawElementsIndirectCommand is 5 integers
+    if (stride <= 0) {
+        stride = indexed ? 20 : 16;
+    }
 
-        int buf_vertices = (int)(buffer->size / format_info.size);
+    if (first < 0) {
+        MGLError_Set("the first must not be negative");
+        return 0;
+    }
 
-        if (!format_info.divisor && array->index_buffer == (MGLBuffer *)Py_None && (!i || array->num_vertices > buf_vertices)) {
-            array->num_vertices = buf_vertices;
-        }
+    int available = (int)MGL_MAX((buffer->size - (Py_ssize_t)first * stride) / stride, 0);
 
-        gl.BindBuffer(GL_ARRAY_BUFFER, buffer->buffer_obj);
+    const GLMethods & gl = self->context->gl;
 
-        char * ptr = 0;
+    if (count_buffer != Py_None && (indexed ? !gl.MultiDrawElementsIndirectCount : !gl.MultiDrawArraysIndirectCount)) {
+        MGLError_Set("indirect count drawing requires OpenGL 4.6 or ARB_indirect_parameters");
+        return 0;
+    }
 
-        int attributes_len = (int)PyTuple_GET_SIZE(tuple) - 2;
+    if (MGLVertexArray_use(self, Py_None) < 0) {
+        return 0;
+    }
 
-        for (int j = 0; j < attributes_len; ++j) {
-            FormatNode * node = it.next();
+    gl.BindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer->buffer_obj);
 
-            while (!node->type) {
-                ptr += node->size;
-                node = it.next();
-            }
+    const void * ptr = (const void *)((GLintptr)first * stride);
 
-            PyObject * attribute = PyTuple_GET_ITEM(tuple, j + 2);
+    if (count_buffer != Py_None) {
+        // The draw count is read from the count buffer on the GPU and clamped to max_count
+        if (max_count < 0) {
+            max_count = available;
+        }
 
-            if (attribute == Py_None) {
-                ptr += node->size;
-                continue;
-            }
+        gl.BindBuffer(GL_PARAMETER_BUFFER, ((MGLBuffer *)count_buffer)->buffer_obj);
 
-            PyObject * attribute_location_py = PyObject_GetAttrString(attribute, "location");
-            PyObject * attribute_rows_length_py = PyObject_GetAttrString(attribute, "rows_length");
-            PyObject * attribute_scalar_type_py = PyObject_GetAttrString(attribute, "scalar_type");
-            if (!attribute_location_py || !attribute_rows_length_py || !attribute_scalar_type_py) {
-                return NULL;
-            }
+        if (indexed) {
+            gl.MultiDrawElementsIndirectCount(mode, self->index_element_type, ptr, count_offset, max_count, stride);
+        } else {
+            gl.MultiDrawArraysIndirectCount(mode, ptr, count_offset, max_count, stride);
+        }
 
-            int attribute_location = PyLong_AsLong(attribute_location_py);
-            int attribute_rows_length = PyLong_AsLong(attribute_rows_length_py);
-            int attribute_scalar_type = PyLong_AsLong(attribute_scalar_type_py);
+        gl.BindBuffer(GL_PARAMETER_BUFFER, 0);
+        Py_RETURN_NONE;
+    }
 
-            for (int r = 0; r < attribute_rows_length; ++r) {
-                int location = attribute_location + r;
-                int count = node->count / attribute_rows_length;
+    if (count < 0) {
+        count = available;
+    }
 
-                switch (attribute_scalar_type) {
-                    case GL_FLOAT: gl.VertexAttribPointer(location, count, node->type, node->normalize, format_info.size, ptr); break;
-                    case GL_DOUBLE: gl.VertexAttribLPointer(location, count, node->type, format_info.size, ptr); break;
-                    case GL_INT: gl.VertexAttribIPointer(location, count, node->type, format_info.size, ptr); break;
-                    case GL_UNSIGNED_INT: gl.VertexAttribIPointer(location, count, node->type, format_info.size, ptr); break;
-                }
+    if (indexed) {
+        gl.MultiDrawElementsIndirect(mode, self->index_element_type, ptr, count, stride);
+    } else {
+        gl.MultiDrawArraysIndirect(mode, ptr, count, stride);
+    }
 
-                gl.VertexAttribDivisor(location, format_info.divisor);
+    Py_RETURN_NONE;
+}
 
-                gl.EnableVertexAttribArray(location);
+// The primitive mode captured by transform feedback, -1 if the draw mode does not fit the program
+static int transform_output_mode(MGLProgram * program, int mode) {
+    int output_mode = -1;
 
-                ptr += node->size / attribute_rows_length;
+    // If a geo shader is present we need to sanity check the the rendering mode
+    if (program->geometry_output > -1) {
+        output_mode = program->geometry_output;
+
+        // The rendering mode must match the input type in the geometry shader
+        // points, lines, lines_adjacency, triangles, triangles_adjacency
+        switch (program->geometry_input)
+        {
+        case GL_POINTS:
+            if (mode != GL_POINTS) {
+                MGLError_Set("Geometry shader expects POINTS as input. Change the transform mode.");
+                return -1;
+            }
+            break;
+        case GL_LINES:
+            if(mode != GL_LINES && mode != GL_LINE_STRIP && mode != GL_LINE_LOOP && mode != GL_LINES_ADJACENCY) {
+                MGLError_Set("Geometry shader expects LINES, LINE_STRIP, GL_LINE_LOOP or GL_LINES_ADJACENCY as input. Change the rendering mode.");
+                return -1;
             }
+            break;
+        case GL_LINES_ADJACENCY:
+            if(mode != GL_LINES_ADJACENCY && mode != GL_LINE_STRIP_ADJACENCY) {
+                MGLError_Set("Geometry shader expects LINES_ADJACENCY or LINE_STRIP_ADJACENCY as input. Change the rendering mode.");
+                return -1;
+            }
+            break;
+        case GL_TRIANGLES:
+            if(mode != GL_TRIANGLES && mode != GL_TRIANGLE_STRIP && mode != GL_TRIANGLE_FAN) {
+                MGLError_Set("Geometry shader expects GL_TRIANGLES, GL_TRIANGLE_STRIP or GL_TRIANGLE_FAN as input. Change the rendering mode.");
+                return -1;
+            }
+            break;
+        case GL_TRIANGLES_ADJACENCY:
+            if(mode != GL_TRIANGLES_ADJACENCY && mode != GL_TRIANGLE_STRIP_ADJACENCY) {
+                MGLError_Set("Geometry shader expects GL_TRIANGLES_ADJACENCY or GL_TRIANGLE_STRIP_ADJACENCY as input. Change the rendering mode.");
+                return -1;
+            }
+            break;
+        default:
+            MGLError_Set("Unexpected geometry shader input mode: %d", program->geometry_input);
+            return -1;
+            break;
+        }
+    } else {
+        // If no geometry shader is present we need to determine the output mode by looking at the input
+        switch (mode)
+        {
+        case GL_POINTS:
+            output_mode = GL_POINTS;
+            break;
+        case GL_LINES:
+        case GL_LINE_LOOP:
+        case GL_LINE_STRIP:
+        case GL_LINES_ADJACENCY:
+        case GL_LINE_STRIP_ADJACENCY:
+            output_mode = GL_LINES;
+            break;
+        case GL_TRIANGLES:
+        case GL_TRIANGLE_STRIP:
+        case GL_TRIANGLE_FAN:
+        case GL_TRIANGLES_ADJACENCY:
+        case GL_TRIANGLE_STRIP_ADJACENCY:
+            output_mode = GL_TRIANGLES;
+            break;
+        default:
+            MGLError_Set("Primitive mode not supported: %d", mode);
+            return -1;
+            break;
         }
     }
 
-    Py_INCREF(self);
-    array->context = self;
-
-    return Py_BuildValue("(Oi)", array, array->vertex_array_obj);
+    return output_mode;
 }
 
-static PyObject * MGLVertexArray_render(MGLVertexArray * self, PyObject * args) {
+static PyObject * MGLVertexArray_transform(MGLVertexArray * self, PyObject * args) {
+    if (!check_not_recording(self->context)) {
+        return NULL;
+    }
+
+    PyObject * outputs;
     int mode;
     int vertices;
     int first;
     int instances;
+    int buffer_offset;
 
     int args_ok = PyArg_ParseTuple(
         args,
-        "IIII",
+        "OIIIII",
+        &outputs,
         &mode,
         &vertices,
         &first,
-        &instances
+        &instances,
+        &buffer_offset
     );
 
     if (!args_ok) {
         return 0;
     }
 
+    if (Py_TYPE(outputs) != MGLTransformFeedback_type && !PyList_Check(outputs)) {
+        MGLError_Set("the outputs must be a list of buffers or a TransformFeedback");
+        return 0;
+    }
+
+    if (!self->program->num_varyings) {
+        MGLError_Set("the program has no varyings");
+        return 0;
+    }
+
     if (vertices < 0) {
         if (self->num_vertices < 0) {
             MGLError_Set("cannot detect the number of vertices");
@@ -6846,11 +9535,64 @@ static PyObject * MGLVertexArray_render(MGLVertexArray * self, PyObject * args)
         instances = self->num_instances;
     }
 
+    int output_mode = transform_output_mode(self->program, mode);
+    if (output_mode < 0) {
+        return 0;
+    }
+
     const GLMethods & gl = self->context->gl;
 
+    // A TransformFeedback object keeps capturing across calls, it is paused between them and ended explicitly
+    MGLTransformFeedback * feedback = NULL;
+
+    if (Py_TYPE(outputs) == MGLTransformFeedback_type) {
+        feedback = (MGLTransformFeedback *)outputs;
+
+        if (feedback->released || feedback->context != self->context) {
+            MGLError_Set("invalid transform feedback");
+            return 0;
+        }
+
+        if (feedback->active && (feedback->program_obj != self->program->program_obj || feedback->primitive_mode != output_mode)) {
+            MGLError_Set("the transform feedback is active with a different program or primitive mode, end it first");
+            return 0;
+        }
+    }
+
+    // The primitive counters stay active while a TransformFeedback is capturing, other captures would be counted too
+    if (self->context->capturing && self->context->capturing != feedback) {
+        MGLError_Set("another TransformFeedback is active, end it first");
+        return 0;
+    }
+
     gl.UseProgram(self->program->program_obj);
     gl.BindVertexArray(self->vertex_array_obj);
 
+    if (feedback) {
+        gl.BindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback->transform_feedback_obj);
+    } else {
+        int num_outputs = (int)PyList_Size(outputs);
+        for (int i = 0; i < num_outputs; ++i) {
+            MGLBuffer * output = (MGLBuffer *)PyList_GET_ITEM(outputs, i);
+            gl.BindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, i, output->buffer_obj, buffer_offset, output->size - buffer_offset);
+        }
+    }
+
+    gl.Enable(GL_RASTERIZER_DISCARD);
+
+    if (feedback && feedback->active) {
+        gl.ResumeTransformFeedback();
+    } else {
+        gl.BeginTransformFeedback(output_mode);
+    }
+
+    if (feedback && !feedback->active) {
+        for (int i = 0; i < feedback->num_streams; ++i) {
+            gl.BeginQueryIndexed(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, i, feedback->query_obj[i]);
+        }
+        self->context->capturing = feedback;
+    }
+
     if (self->index_buffer != (MGLBuffer *)Py_None) {
         const void * ptr = (const void *)((GLintptr)first * self->index_element_size);
         gl.DrawElementsInstanced(mode, vertices, self->index_element_type, ptr, instances);
@@ -6858,195 +9600,295 @@ static PyObject * MGLVertexArray_render(MGLVertexArray * self, PyObject * args)
         gl.DrawArraysInstanced(mode, first, vertices, instances);
     }
 
+    if (feedback) {
+        gl.PauseTransformFeedback();
+        gl.BindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+        feedback->active = true;
+        feedback->program_obj = self->program->program_obj;
+        feedback->primitive_mode = output_mode;
+    } else {
+        gl.EndTransformFeedback();
+    }
+
+    if (~self->context->enable_flags & MGL_RASTERIZER_DISCARD) {
+        gl.Disable(GL_RASTERIZER_DISCARD);
+    }
+
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLVertexArray_render_indirect(MGLVertexArray * self, PyObject * args) {
-    MGLBuffer * buffer;
+static PyObject * MGLVertexArray_render_feedback(MGLVertexArray * self, PyObject * args) {
+    if (!check_not_recording(self->context)) {
+        return NULL;
+    }
+
+    MGLTransformFeedback * feedback;
     int mode;
-    int count;
-    int first;
+    int instances;
+    int stream;
+    PyObject * program;
 
-    int args_ok = PyArg_ParseTuple(
-        args,
-        "O!III",
-        MGLBuffer_type,
-        &buffer,
-        &mode,
-        &count,
-        &first
-    );
+    if (!PyArg_ParseTuple(args, "O!IiiO", MGLTransformFeedback_type, &feedback, &mode, &instances, &stream, &program)) {
+        return 0;
+    }
+
+    if (stream < 0 || stream >= feedback->num_streams) {
+        MGLError_Set("invalid stream %d", stream);
+        return 0;
+    }
+
+    if (self->released || feedback->released || feedback->context != self->context) {
+        MGLError_Set("invalid transform feedback");
+        return 0;
+    }
+
+    if (feedback->active) {
+        MGLError_Set("the transform feedback must be ended before rendering its output");
+        return 0;
+    }
 
-    if (!args_ok) {
+    if (!feedback->captured) {
+        MGLError_Set("the transform feedback has not captured anything yet");
         return 0;
     }
 
-    if (count < 0) {
-        count = (int)(buffer->size / 20 - first);
+    if (instances < 0) {
+        instances = self->num_instances;
     }
 
     const GLMethods & gl = self->context->gl;
 
-    gl.UseProgram(self->program->program_obj);
-    gl.BindVertexArray(self->vertex_array_obj);
-    gl.BindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer->buffer_obj);
+    if (instances != 1 && !gl.DrawTransformFeedbackStreamInstanced) {
+        MGLError_Set("instanced rendering of a transform feedback is not supported");
+        return 0;
+    }
 
-    const void * ptr = (const void *)((GLintptr)first * 20);
+    // The vertex count stays on the GPU, it was recorded when the transform feedback ended
+    if (MGLVertexArray_use(self, program) < 0) {
+        return 0;
+    }
 
-    if (self->index_buffer != (MGLBuffer *)Py_None) {
-        gl.MultiDrawElementsIndirect(mode, self->index_element_type, ptr, count, 20);
+    if (instances == 1) {
+        gl.DrawTransformFeedbackStream(mode, feedback->transform_feedback_obj, stream);
     } else {
-        gl.MultiDrawArraysIndirect(mode, ptr, count, 20);
+        gl.DrawTransformFeedbackStreamInstanced(mode, feedback->transform_feedback_obj, stream, instances);
     }
 
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLVertexArray_transform(MGLVertexArray * self, PyObject * args) {
-    PyObject * outputs;
+static PyObject * MGLContext_feedback_loop(MGLContext * self, PyObject * args) {
+    MGLVertexArray * vertex_arrays[2];
+    MGLTransformFeedback * feedbacks[2];
     int mode;
     int vertices;
-    int first;
-    int instances;
-    int buffer_offset;
 
     int args_ok = PyArg_ParseTuple(
         args,
-        "O!IIIII",
-        &PyList_Type,
-        &outputs,
+        "O!O!O!O!Ii",
+        MGLVertexArray_type,
+        &vertex_arrays[0],
+        MGLVertexArray_type,
+        &vertex_arrays[1],
+        MGLTransformFeedback_type,
+        &feedbacks[0],
+        MGLTransformFeedback_type,
+        &feedbacks[1],
         &mode,
-        &vertices,
-        &first,
-        &instances,
-        &buffer_offset
+        &vertices
     );
 
     if (!args_ok) {
         return 0;
     }
 
-    if (!self->program->num_varyings) {
+    MGLProgram * program = vertex_arrays[0]->program;
+
+    if (vertex_arrays[1]->program != program || vertex_arrays[0]->pipeline || vertex_arrays[1]->pipeline) {
+        MGLError_Set("both vertex arrays must use the same program");
+        return 0;
+    }
+
+    if (!program->num_varyings) {
         MGLError_Set("the program has no varyings");
         return 0;
     }
 
+    if (vertex_arrays[0]->index_buffer != (MGLBuffer *)Py_None || vertex_arrays[1]->index_buffer != (MGLBuffer *)Py_None) {
+        MGLError_Set("feedback loops do not support index buffers");
+        return 0;
+    }
+
+    int output_mode = transform_output_mode(program, mode);
+    if (output_mode < 0) {
+        return 0;
+    }
+
     if (vertices < 0) {
-        if (self->num_vertices < 0) {
-            MGLError_Set("cannot detect the number of vertices");
-            return 0;
-        }
+        vertices = vertex_arrays[0]->num_vertices;
+    }
 
-        vertices = self->num_vertices;
+    if (vertices < 0) {
+        MGLError_Set("cannot detect the number of vertices");
+        return 0;
     }
 
-    if (instances < 0) {
-        instances = self->num_instances;
+    MGLFeedbackLoop * loop = PyObject_New(MGLFeedbackLoop, MGLFeedbackLoop_type);
+    loop->current = 0;
+    loop->mode = mode;
+    loop->output_mode = output_mode;
+    loop->vertices = vertices;
+    loop->released = false;
+
+    for (int i = 0; i < 2; ++i) {
+        Py_INCREF(vertex_arrays[i]);
+        Py_INCREF(feedbacks[i]);
+        loop->vertex_arrays[i] = vertex_arrays[i];
+        loop->feedbacks[i] = feedbacks[i];
     }
 
-    int output_mode = -1;
+    Py_INCREF(self);
+    loop->context = self;
 
-    // If a geo shader is present we need to sanity check the the rendering mode
-    if (self->program->geometry_output > -1) {
-        output_mode = self->program->geometry_output;
+    Py_INCREF(loop);
+    return (PyObject *)loop;
+}
 
-        // The rendering mode must match the input type in the geometry shader
-        // points, lines, lines_adjacency, triangles, triangles_adjacency
-        switch (self->program->geometry_input)
-        {
-        case GL_POINTS:
-            if (mode != GL_POINTS) {
-                MGLError_Set("Geometry shader expects POINTS as input. Change the transform mode.");
-                return 0;
-            }
-            break;
-        case GL_LINES:
-            if(mode != GL_LINES && mode != GL_LINE_STRIP && mode != GL_LINE_LOOP && mode != GL_LINES_ADJACENCY) {
-                MGLError_Set("Geometry shader expects LINES, LINE_STRIP, GL_LINE_LOOP or GL_LINES_ADJACENCY as input. Change the rendering mode.");
-                return 0;
-            }
-            break;
-        case GL_LINES_ADJACENCY:
-            if(mode != GL_LINES_ADJACENCY && mode != GL_LINE_STRIP_ADJACENCY) {
-                MGLError_Set("Geometry shader expects LINES_ADJACENCY or LINE_STRIP_ADJACENCY as input. Change the rendering mode.");
-                return 0;
-            }
-            break;
-        case GL_TRIANGLES:
-            if(mode != GL_TRIANGLES && mode != GL_TRIANGLE_STRIP && mode != GL_TRIANGLE_FAN) {
-                MGLError_Set("Geometry shader expects GL_TRIANGLES, GL_TRIANGLE_STRIP or GL_TRIANGLE_FAN as input. Change the rendering mode.");
-                return 0;
-            }
-            break;
-        case GL_TRIANGLES_ADJACENCY:
-            if(mode != GL_TRIANGLES_ADJACENCY && mode != GL_TRIANGLE_STRIP_ADJACENCY) {
-                MGLError_Set("Geometry shader expects GL_TRIANGLES_ADJACENCY or GL_TRIANGLE_STRIP_ADJACENCY as input. Change the rendering mode.");
-                return 0;
-            }
-            break;
-        default:
-            MGLError_Set("Unexpected geometry shader input mode: %d", self->program->geometry_input);
-            return 0;
-            break;
-        }
-    } else {
-        // If no geometry shader is present we need to determine the output mode by looking at the input
-        switch (mode)
-        {
-        case GL_POINTS:
-            output_mode = GL_POINTS;
-            break;
-        case GL_LINES:
-        case GL_LINE_LOOP:
-        case GL_LINE_STRIP:
-        case GL_LINES_ADJACENCY:
-        case GL_LINE_STRIP_ADJACENCY:
-            output_mode = GL_LINES;
-            break;
-        case GL_TRIANGLES:
-        case GL_TRIANGLE_STRIP:
-        case GL_TRIANGLE_FAN:
-        case GL_TRIANGLES_ADJACENCY:
-        case GL_TRIANGLE_STRIP_ADJACENCY:
-            output_mode = GL_TRIANGLES;
-            break;
-        default:
-            MGLError_Set("Primitive mode not supported: %d", mode);
+static PyObject * MGLFeedbackLoop_step(MGLFeedbackLoop * self, PyObject * args) {
+    int steps;
+
+    if (!PyArg_ParseTuple(args, "i", &steps)) {
+        return 0;
+    }
+
+    if (self->released || steps < 0) {
+        MGLError_Set(self->released ? "the feedback loop was released" : "invalid number of steps %d", steps);
+        return 0;
+    }
+
+    if (self->context->capturing) {
+        MGLError_Set("another TransformFeedback is active, end it first");
+        return 0;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        if (self->vertex_arrays[i]->released || self->feedbacks[i]->released || self->vertex_arrays[i]->program->released) {
+            MGLError_Set("the feedback loop uses released objects");
             return 0;
-            break;
         }
     }
 
     const GLMethods & gl = self->context->gl;
 
-    gl.UseProgram(self->program->program_obj);
-    gl.BindVertexArray(self->vertex_array_obj);
+    gl.UseProgram(self->vertex_arrays[0]->program->program_obj);
+    gl.Enable(GL_RASTERIZER_DISCARD);
 
-    int num_outputs = (int)PyList_Size(outputs);
-    for (int i = 0; i < num_outputs; ++i) {
-        MGLBuffer * output = (MGLBuffer *)PyList_GET_ITEM(outputs, i);
-        gl.BindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, i, output->buffer_obj, buffer_offset, output->size - buffer_offset);
-    }
+    // Every step reads the buffer written by the previous one, after the first step the vertex count stays on the GPU
+    for (int i = 0; i < steps; ++i) {
+        int source = self->current;
+        MGLTransformFeedback * feedback = self->feedbacks[source];
+        MGLTransformFeedback * previous = self->feedbacks[1 - source];
 
-    gl.Enable(GL_RASTERIZER_DISCARD);
-    gl.BeginTransformFeedback(output_mode);
+        // Only the last step writing each buffer is counted, its primitives_written stays valid after the loop
+        bool counted = i >= steps - 2;
 
-    if (self->index_buffer != (MGLBuffer *)Py_None) {
-        const void * ptr = (const void *)((GLintptr)first * self->index_element_size);
-        gl.DrawElementsInstanced(mode, vertices, self->index_element_type, ptr, instances);
-    } else {
-        gl.DrawArraysInstanced(mode, first, vertices, instances);
+        gl.BindVertexArray(self->vertex_arrays[source]->vertex_array_obj);
+        gl.BindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback->transform_feedback_obj);
+        gl.BeginTransformFeedback(self->output_mode);
+
+        if (counted) {
+            for (int j = 0; j < feedback->num_streams; ++j) {
+                gl.BeginQueryIndexed(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, j, feedback->query_obj[j]);
+            }
+        }
+
+        if (previous->captured) {
+            gl.DrawTransformFeedback(self->mode, previous->transform_feedback_obj);
+        } else {
+            gl.DrawArrays(self->mode, 0, self->vertices);
+        }
+
+        gl.EndTransformFeedback();
+
+        if (counted) {
+            for (int j = 0; j < feedback->num_streams; ++j) {
+                gl.EndQueryIndexed(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, j);
+            }
+        }
+
+        feedback->captured = true;
+        self->current = 1 - source;
     }
 
-    gl.EndTransformFeedback();
+    gl.BindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
     if (~self->context->enable_flags & MGL_RASTERIZER_DISCARD) {
         gl.Disable(GL_RASTERIZER_DISCARD);
     }
-    gl.Flush();
 
     Py_RETURN_NONE;
 }
 
+static PyObject * MGLFeedbackLoop_release(MGLFeedbackLoop * self, PyObject * args) {
+    if (self->released) {
+        Py_RETURN_NONE;
+    }
+    self->released = true;
+
+    for (int i = 0; i < 2; ++i) {
+        Py_DECREF(self->vertex_arrays[i]);
+        Py_DECREF(self->feedbacks[i]);
+    }
+
+    Py_DECREF(self->context);
+    Py_DECREF(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLFeedbackLoop_get_current(MGLFeedbackLoop * self, void * closure) {
+    return PyLong_FromLong(self->current);
+}
+
+// True once the current buffer was written by a step and its vertex count is known to the GPU only
+static PyObject * MGLFeedbackLoop_get_stepped(MGLFeedbackLoop * self, void * closure) {
+    return PyBool_FromLong(!self->released && self->feedbacks[1 - self->current]->captured);
+}
+
+// Attributes added with bind() use the bindings after the content, preferably the one offset by the location.
+// When that one is out of range or taken, the first binding no other enabled attribute uses is picked.
+static int MGLVertexArray_free_binding(MGLVertexArray * self, int location) {
+    const GLMethods & gl = self->context->gl;
+
+    int max_bindings = 0;
+    int max_attribs = 0;
+    gl.GetIntegerv(GL_MAX_VERTEX_ATTRIB_BINDINGS, &max_bindings);
+    gl.GetIntegerv(GL_MAX_VERTEX_ATTRIBS, &max_attribs);
+    max_bindings = MGL_MIN(max_bindings, 256);
+
+    bool used[256] = {};
+    for (int i = 0; i < max_attribs; ++i) {
+        int enabled = 0;
+        int binding = 0;
+        gl.GetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+        gl.GetVertexAttribiv(i, GL_VERTEX_ATTRIB_BINDING, &binding);
+        if (i != location && enabled && binding >= 0 && binding < max_bindings) {
+            used[binding] = true;
+        }
+    }
+
+    int preferred = self->num_bindings + location;
+    if (preferred < max_bindings && !used[preferred]) {
+        return preferred;
+    }
+
+    for (int i = self->num_bindings; i < max_bindings; ++i) {
+        if (!used[i]) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
 static PyObject * MGLVertexArray_bind(MGLVertexArray * self, PyObject * args) {
     int location;
     const char * type;
@@ -7100,6 +9942,37 @@ static PyObject * MGLVertexArray_bind(MGLVertexArray * self, PyObject * args) {
     const GLMethods & gl = self->context->gl;
 
     gl.BindVertexArray(self->vertex_array_obj);
+
+    if (self->attrib_binding) {
+        // VertexAttribPointer would take over the binding with the index of the location
+        int binding = MGLVertexArray_free_binding(self, location);
+        if (binding < 0) {
+            MGLError_Set("too many vertex buffer bindings");
+            return 0;
+        }
+
+        switch (type[0]) {
+            case 'f':
+                gl.VertexAttribFormat(location, node->count, node->type, normalize, 0);
+                break;
+            case 'i':
+                gl.VertexAttribIFormat(location, node->count, node->type, 0);
+                break;
+            case 'd':
+                gl.VertexAttribLFormat(location, node->count, node->type, 0);
+                break;
+            default:
+                MGLError_Set("invalid type");
+                return 0;
+        }
+
+        gl.VertexAttribBinding(location, binding);
+        gl.BindVertexBuffer(binding, buffer->buffer_obj, offset, stride ? stride : node->size);
+        gl.VertexBindingDivisor(binding, divisor);
+        gl.EnableVertexAttribArray(location);
+        Py_RETURN_NONE;
+    }
+
     gl.BindBuffer(GL_ARRAY_BUFFER, buffer->buffer_obj);
 
     switch (type[0]) {
@@ -7117,10 +9990,141 @@ static PyObject * MGLVertexArray_bind(MGLVertexArray * self, PyObject * args) {
             return 0;
     }
 
-    gl.VertexAttribDivisor(location, divisor);
+    gl.VertexAttribDivisor(location, divisor);
+
+    gl.EnableVertexAttribArray(location);
+
+    Py_RETURN_NONE;
+}
+
+static int MGLVertexArray_check_binding(MGLVertexArray * self, int binding, MGLBuffer * buffer, Py_ssize_t offset, int stride) {
+    if (binding < 0 || binding >= self->num_bindings) {
+        MGLError_Set("invalid vertex buffer binding %d", binding);
+        return -1;
+    }
+
+    if (buffer->context != self->context) {
+        MGLError_Set("the buffer belongs to a different context");
+        return -1;
+    }
+
+    if (offset < 0 || stride < 0) {
+        MGLError_Set("the offset and the stride must not be negative");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void MGLVertexArray_store_binding(MGLVertexArray * self, int binding, MGLBuffer * buffer, Py_ssize_t offset, int stride) {
+    MGLVertexBinding & info = self->bindings[binding];
+    info.stride = stride;
+    // The last vertex only has to fit the attributes of a single element, not a full stride
+    Py_ssize_t available = buffer->size - offset - info.size;
+    info.vertices = available < 0 ? 0 : stride ? (int)(available / stride) + 1 : INT_MAX;
+}
+
+static PyObject * MGLVertexArray_bind_vertex_buffer(MGLVertexArray * self, PyObject * args) {
+    int binding;
+    MGLBuffer * buffer;
+    Py_ssize_t offset;
+    int stride;
+
+    if (!PyArg_ParseTuple(args, "iO!ni", &binding, MGLBuffer_type, &buffer, &offset, &stride)) {
+        return 0;
+    }
+
+    if (!self->attrib_binding) {
+        MGLError_Set("vertex buffer bindings require OpenGL 4.3");
+        return 0;
+    }
+
+    if (stride < 0 && binding >= 0 && binding < self->num_bindings) {
+        stride = self->bindings[binding].stride;
+    }
+
+    if (MGLVertexArray_check_binding(self, binding, buffer, offset, stride) < 0) {
+        return 0;
+    }
+
+    const GLMethods & gl = self->context->gl;
+    gl.BindVertexArray(self->vertex_array_obj);
+    gl.BindVertexBuffer(binding, buffer->buffer_obj, offset, stride);
+
+    MGLVertexArray_store_binding(self, binding, buffer, offset, stride);
+    MGLVertexArray_update_vertices(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLVertexArray_bind_vertex_buffers(MGLVertexArray * self, PyObject * args) {
+    int first;
+    PyObject * bindings;
+
+    if (!PyArg_ParseTuple(args, "iO!", &first, &PyTuple_Type, &bindings)) {
+        return 0;
+    }
+
+    if (!self->attrib_binding) {
+        MGLError_Set("vertex buffer bindings require OpenGL 4.3");
+        return 0;
+    }
+
+    int count = (int)PyTuple_Size(bindings);
+
+    if (first < 0 || first + count > self->num_bindings) {
+        MGLError_Set("invalid vertex buffer bindings %d to %d", first, first + count);
+        return 0;
+    }
+
+    GLuint * buffer_objs = new GLuint[count + 1];
+    GLintptr * offsets = new GLintptr[count + 1];
+    GLsizei * strides = new GLsizei[count + 1];
+
+    for (int i = 0; i < count; ++i) {
+        MGLBuffer * buffer;
+        Py_ssize_t offset;
+        int stride;
+
+        if (!PyArg_ParseTuple(PyTuple_GetItem(bindings, i), "O!ni", MGLBuffer_type, &buffer, &offset, &stride)) {
+            delete[] buffer_objs;
+            delete[] offsets;
+            delete[] strides;
+            return 0;
+        }
+
+        if (stride < 0) {
+            stride = self->bindings[first + i].stride;
+        }
+
+        if (MGLVertexArray_check_binding(self, first + i, buffer, offset, stride) < 0) {
+            delete[] buffer_objs;
+            delete[] offsets;
+            delete[] strides;
+            return 0;
+        }
+
+        buffer_objs[i] = buffer->buffer_obj;
+        offsets[i] = offset;
+        strides[i] = stride;
+        MGLVertexArray_store_binding(self, first + i, buffer, offset, stride);
+    }
+
+    const GLMethods & gl = self->context->gl;
+    gl.BindVertexArray(self->vertex_array_obj);
 
-    gl.EnableVertexAttribArray(location);
+    if (gl.BindVertexBuffers) {
+        gl.BindVertexBuffers(first, count, buffer_objs, offsets, strides);
+    } else {
+        for (int i = 0; i < count; ++i) {
+            gl.BindVertexBuffer(first + i, buffer_objs[i], offsets[i], strides[i]);
+        }
+    }
 
+    delete[] buffer_objs;
+    delete[] offsets;
+    delete[] strides;
+
+    MGLVertexArray_update_vertices(self);
     Py_RETURN_NONE;
 }
 
@@ -7134,7 +10138,9 @@ static PyObject * MGLVertexArray_release(MGLVertexArray * self, PyObject * args)
     gl.DeleteVertexArrays(1, (GLuint *)&self->vertex_array_obj);
 
     Py_DECREF(self->program);
+    Py_XDECREF(self->pipeline);
     Py_XDECREF(self->index_buffer);
+    PyMem_Free(self->bindings);
     Py_DECREF(self);
     Py_RETURN_NONE;
 }
@@ -7188,6 +10194,10 @@ static int MGLVertexArray_set_instances(MGLVertexArray * self, PyObject * value,
 }
 
 static PyObject * MGLContext_enable_only(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
     int flags;
 
     int args_ok = PyArg_ParseTuple(
@@ -7236,6 +10246,10 @@ static PyObject * MGLContext_enable_only(MGLContext * self, PyObject * args) {
 }
 
 static PyObject * MGLContext_enable(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
     int flags;
 
     int args_ok = PyArg_ParseTuple(
@@ -7274,6 +10288,10 @@ static PyObject * MGLContext_enable(MGLContext * self, PyObject * args) {
 }
 
 static PyObject * MGLContext_disable(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
     int flags;
 
     int args_ok = PyArg_ParseTuple(
@@ -7312,6 +10330,10 @@ static PyObject * MGLContext_disable(MGLContext * self, PyObject * args) {
 }
 
 static PyObject * MGLContext_enable_direct(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
     int value;
 
     int args_ok = PyArg_ParseTuple(
@@ -7329,6 +10351,10 @@ static PyObject * MGLContext_enable_direct(MGLContext * self, PyObject * args) {
 }
 
 static PyObject * MGLContext_disable_direct(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
     int value;
 
     int args_ok = PyArg_ParseTuple(
@@ -7350,7 +10376,16 @@ static PyObject * MGLContext_finish(MGLContext * self, PyObject * args) {
     Py_RETURN_NONE;
 }
 
+static PyObject * MGLContext_reset_framebuffer_state(MGLContext * self, PyObject * args) {
+    self->framebuffer_state.valid = false;
+    Py_RETURN_NONE;
+}
+
 static PyObject * MGLContext_copy_buffer(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
     MGLBuffer * dst;
     MGLBuffer * src;
 
@@ -7397,7 +10432,148 @@ static PyObject * MGLContext_copy_buffer(MGLContext * self, PyObject * args) {
     Py_RETURN_NONE;
 }
 
+static void MGLContext_blit_framebuffer(MGLContext * self, MGLFramebuffer * dst, MGLFramebuffer * src, unsigned draw_buffer, unsigned read_buffer, int mask, int filter, bool dsa) {
+    const GLMethods & gl = self->gl;
+
+    if (dsa) {
+        if (mask & GL_COLOR_BUFFER_BIT) {
+            gl.NamedFramebufferReadBuffer(src->framebuffer_obj, read_buffer);
+            gl.NamedFramebufferDrawBuffer(dst->framebuffer_obj, draw_buffer);
+        }
+        gl.BlitNamedFramebuffer(
+            src->framebuffer_obj, dst->framebuffer_obj,
+            0, 0, src->width, src->height,
+            0, 0, dst->width, dst->height,
+            mask, filter
+        );
+    } else {
+        if (mask & GL_COLOR_BUFFER_BIT) {
+            gl.ReadBuffer(read_buffer);
+            gl.DrawBuffer(draw_buffer);
+        }
+        gl.BlitFramebuffer(
+            0, 0, src->width, src->height,
+            0, 0, dst->width, dst->height,
+            mask, filter
+        );
+    }
+}
+
+static PyObject * MGLContext_resolve(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
+    MGLFramebuffer * dst;
+    MGLFramebuffer * src;
+    PyObject * attachments_arg;
+    int depth;
+    int linear;
+
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "O!O!Opp",
+        MGLFramebuffer_type,
+        &dst,
+        MGLFramebuffer_type,
+        &src,
+        &attachments_arg,
+        &depth,
+        &linear
+    );
+
+    if (!args_ok) {
+        return 0;
+    }
+
+    int attachments[64];
+    int num_attachments = 0;
+
+    if (attachments_arg == Py_None) {
+        if (dst->draw_buffers_len != src->draw_buffers_len) {
+            MGLError_Set("Destination and source framebuffers have different number of color attachments!");
+            return 0;
+        }
+        num_attachments = src->draw_buffers_len;
+        for (int i = 0; i < num_attachments; ++i) {
+            attachments[i] = i;
+        }
+    } else {
+        if (!PyTuple_Check(attachments_arg) || PyTuple_Size(attachments_arg) > 64) {
+            MGLError_Set("invalid attachments");
+            return 0;
+        }
+        num_attachments = (int)PyTuple_Size(attachments_arg);
+        for (int i = 0; i < num_attachments; ++i) {
+            attachments[i] = PyLong_AsLong(PyTuple_GetItem(attachments_arg, i));
+            if (PyErr_Occurred()) {
+                return 0;
+            }
+            if (attachments[i] < 0 || attachments[i] >= src->draw_buffers_len || attachments[i] >= dst->draw_buffers_len) {
+                MGLError_Set("both framebuffers must have the color attachment %d", attachments[i]);
+                return 0;
+            }
+        }
+    }
+
+    if (src->samples && (src->width != dst->width || src->height != dst->height)) {
+        MGLError_Set("multisample framebuffers can only be resolved into framebuffers of the same size");
+        return 0;
+    }
+
+    const GLMethods & gl = self->gl;
+    MGLFramebufferState & state = self->framebuffer_state;
+
+    // Blits are affected by the scissor test, draws enable it again if necessary
+    if (!state.valid || state.scissor_enabled) {
+        gl.Disable(GL_SCISSOR_TEST);
+        state.scissor_enabled = false;
+    }
+
+    bool dsa = gl.BlitNamedFramebuffer && gl.NamedFramebufferReadBuffer && gl.NamedFramebufferDrawBuffer && gl.NamedFramebufferDrawBuffers;
+    if (!dsa) {
+        gl.BindFramebuffer(GL_READ_FRAMEBUFFER, src->framebuffer_obj);
+        gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, dst->framebuffer_obj);
+    }
+
+    int filter = linear ? GL_LINEAR : GL_NEAREST;
+
+    // Depth can only be blitted with nearest filtering, then it is blitted together with the first color attachment
+    int depth_bit = depth ? GL_DEPTH_BUFFER_BIT : 0;
+    for (int i = 0; i < num_attachments; ++i) {
+        int mask = GL_COLOR_BUFFER_BIT;
+        if (depth_bit && !linear) {
+            mask |= depth_bit;
+            depth_bit = 0;
+        }
+        MGLContext_blit_framebuffer(self, dst, src, dst->draw_buffers[attachments[i]], src->draw_buffers[attachments[i]], mask, filter, dsa);
+    }
+
+    if (depth_bit) {
+        MGLContext_blit_framebuffer(self, dst, src, GL_NONE, GL_NONE, depth_bit, GL_NEAREST, dsa);
+    }
+
+    // The draw buffers are part of the framebuffer object, the framebuffer state cache expects them unchanged
+    if (num_attachments && dst->framebuffer_obj) {
+        if (dsa) {
+            gl.NamedFramebufferDrawBuffers(dst->framebuffer_obj, dst->draw_buffers_len, dst->draw_buffers);
+        } else {
+            gl.DrawBuffers(dst->draw_buffers_len, dst->draw_buffers);
+        }
+    }
+
+    if (!dsa) {
+        MGLContext_restore_framebuffer(self);
+    }
+
+    Py_RETURN_NONE;
+}
+
 static PyObject * MGLContext_copy_framebuffer(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
     PyObject * dst;
     MGLFramebuffer * src;
 
@@ -7447,6 +10623,14 @@ static PyObject * MGLContext_copy_framebuffer(MGLContext * self, PyObject * args
         }
 
 
+        MGLFramebufferState & state = self->framebuffer_state;
+
+        // Blits are affected by the scissor test, draws enable it again if necessary
+        if (!state.valid || state.scissor_enabled) {
+            gl.Disable(GL_SCISSOR_TEST);
+            state.scissor_enabled = false;
+        }
+
         int prev_read_buffer = -1;
         int prev_draw_buffer = -1;
         int color_attachment_len = dst_framebuffer->draw_buffers_len;
@@ -7467,7 +10651,7 @@ static PyObject * MGLContext_copy_framebuffer(MGLContext * self, PyObject * args
                 GL_NEAREST
             );
         }
-        gl.BindFramebuffer(GL_FRAMEBUFFER, self->bound_framebuffer->framebuffer_obj);
+        MGLContext_restore_framebuffer(self);
         gl.ReadBuffer(prev_read_buffer);
         gl.DrawBuffer(prev_draw_buffer);
         gl.DrawBuffers(self->bound_framebuffer->draw_buffers_len, self->bound_framebuffer->draw_buffers);
@@ -7505,7 +10689,7 @@ static PyObject * MGLContext_copy_framebuffer(MGLContext * self, PyObject * args
         gl.ActiveTexture(GL_TEXTURE0 + self->default_texture_unit);
         gl.BindTexture(GL_TEXTURE_2D, dst_texture->texture_obj);
         gl.CopyTexImage2D(texture_target, 0, format, 0, 0, width, height, 0);
-        gl.BindFramebuffer(GL_FRAMEBUFFER, self->bound_framebuffer->framebuffer_obj);
+        MGLContext_restore_framebuffer(self);
 
     } else {
 
@@ -7619,6 +10803,10 @@ static PyObject * MGLContext_detect_framebuffer(MGLContext * self, PyObject * ar
 }
 
 static PyObject * MGLContext_clear_samplers(MGLContext * self, PyObject * args) {
+    if (!check_not_recording(self)) {
+        return NULL;
+    }
+
     int start;
     int end;
 
@@ -7805,28 +10993,7 @@ static PyObject * MGLContext_read_uniform(MGLContext * self, PyObject * args) {
     return res;
 }
 
-static PyObject * MGLContext_write_uniform(MGLContext * self, PyObject * args) {
-    int program_obj;
-    int location;
-    int gl_type;
-    int array_length;
-    int element_size;
-    Py_buffer view = {};
-
-    if (!PyArg_ParseTuple(args, "IIIIIy*", &program_obj, &location, &gl_type, &array_length, &element_size, &view)) {
-        return NULL;
-    }
-
-    if ((int)view.len != array_length * element_size) {
-        MGLError_Set("invalid uniform size");
-        return NULL;
-    }
-
-    const GLMethods & gl = self->gl;
-    char * ptr = (char *)view.buf;
-
-    gl.UseProgram(program_obj);
-
+static void write_uniform(const GLMethods & gl, int gl_type, int location, int array_length, char * ptr) {
     switch (gl_type) {
         case GL_BOOL: gl.Uniform1iv(location, array_length, (int *)ptr); break;
         case GL_BOOL_VEC2: gl.Uniform2iv(location, array_length, (int *)ptr); break;
@@ -7891,21 +11058,306 @@ static PyObject * MGLContext_write_uniform(MGLContext * self, PyObject * args) {
         case GL_DOUBLE_MAT4x3: gl.UniformMatrix4x3dv(location, array_length, false, (double *)ptr); break;
         case GL_DOUBLE_MAT4: gl.UniformMatrix4dv(location, array_length, false, (double *)ptr); break;
     }
+}
+
+static PyObject * MGLContext_write_uniform(MGLContext * self, PyObject * args) {
+    int program_obj;
+    int location;
+    int gl_type;
+    int array_length;
+    int element_size;
+    Py_buffer view = {};
+    PyObject * program = Py_None;
+
+    if (!PyArg_ParseTuple(args, "IIIIIy*|O", &program_obj, &location, &gl_type, &array_length, &element_size, &view, &program)) {
+        return NULL;
+    }
+
+    if ((int)view.len != array_length * element_size) {
+        MGLError_Set("invalid uniform size");
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    if (self->recording) {
+        // The command list keeps the program alive and reads its program object on replay
+        if (!PyObject_TypeCheck(program, MGLProgram_type)) {
+            MGLError_Set("the uniform cannot be recorded without its program");
+            PyBuffer_Release(&view);
+            return NULL;
+        }
+        PyObject * handle = record_uniform(self, (MGLProgram *)program, location, gl_type, array_length, &view);
+        PyBuffer_Release(&view);
+        return handle;
+    }
+
+    self->gl.UseProgram(program_obj);
+    write_uniform(self->gl, gl_type, location, array_length, (char *)view.buf);
+
+    PyBuffer_Release(&view);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLContext_set_uniform_handle(MGLContext * self, PyObject * args) {
+    int program_obj;
+    int location;
+    unsigned long long handle;
+
+    if (!PyArg_ParseTuple(args, "IIK", &program_obj, &location, &handle)) {
+        return NULL;
+    }
+
+    self->gl.ProgramUniformHandleui64ARB(program_obj, location, handle);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLContext_record(MGLContext * self, PyObject * args) {
+    if (self->recording) {
+        MGLError_Set("a command list is already recording");
+        return NULL;
+    }
+
+    MGLCommandList * commands = PyObject_New(MGLCommandList, MGLCommandList_type);
+    commands->released = false;
+
+    Py_INCREF(self);
+    commands->context = self;
+
+    commands->objects = PyList_New(0);
+    commands->commands = NULL;
+    commands->num_commands = 0;
+    commands->max_commands = 0;
+    commands->data = NULL;
+    commands->data_size = 0;
+    commands->data_capacity = 0;
+
+    self->recording = commands;
+
+    Py_INCREF(commands);
+    return (PyObject *)commands;
+}
+
+static PyObject * MGLCommandList_end(MGLCommandList * self, PyObject * args) {
+    if (self->context->recording == self) {
+        self->context->recording = NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLCommandList_execute(MGLCommandList * self, PyObject * args) {
+    if (self->released) {
+        MGLError_Set("the command list was released");
+        return NULL;
+    }
+
+    if (self->context->recording) {
+        MGLError_Set("cannot execute a command list while recording");
+        return NULL;
+    }
+
+    const GLMethods & gl = self->context->gl;
+
+    for (int i = 0; i < self->num_commands; ++i) {
+        MGLCommand & command = self->commands[i];
+        switch (command.type) {
+            case MGL_COMMAND_RENDER: {
+                MGLRenderCommand & render = command.render;
+                if (MGLVertexArray_draw(render.vertex_array, render.mode, render.vertices, render.first, render.instances, render.program) < 0) {
+                    return NULL;
+                }
+                break;
+            }
+            case MGL_COMMAND_UNIFORM: {
+                MGLUniformCommand & uniform = command.uniform;
+                if (uniform.program->released) {
+                    MGLError_Set("the program was released");
+                    return NULL;
+                }
+                gl.UseProgram(uniform.program->program_obj);
+                write_uniform(gl, uniform.gl_type, uniform.location, uniform.array_length, self->data + uniform.data);
+                break;
+            }
+            case MGL_COMMAND_BIND_BUFFER: {
+                MGLBindBufferCommand & bind = command.bind_buffer;
+                gl.BindBufferRange(bind.target, bind.binding, bind.buffer_obj, bind.offset, bind.size);
+                break;
+            }
+            case MGL_COMMAND_BIND_TEXTURE: {
+                MGLBindTextureCommand & bind = command.bind_texture;
+                gl.ActiveTexture(GL_TEXTURE0 + bind.unit);
+                gl.BindTexture(bind.target, bind.texture_obj);
+                break;
+            }
+            case MGL_COMMAND_BIND_SAMPLER: {
+                gl.BindSampler(command.bind_sampler.unit, command.bind_sampler.sampler_obj);
+                break;
+            }
+            case MGL_COMMAND_USE_FRAMEBUFFER: {
+                MGLFramebuffer_use_native(command.framebuffer);
+                break;
+            }
+            case MGL_COMMAND_CLEAR: {
+                MGLClearCommand & clear = command.clear;
+                MGLFramebuffer_clear_native(clear.framebuffer, clear.color, clear.depth, clear.has_viewport ? &clear.viewport : NULL);
+                break;
+            }
+            case MGL_COMMAND_CLEAR_ATTACHMENTS: {
+                MGLClearAttachmentsCommand & clear = command.clear_attachments;
+                MGLFramebuffer_clear_attachments_native(
+                    clear.framebuffer, clear.num_colors, (AttachmentClear *)(self->data + clear.colors),
+                    clear.has_depth ? &clear.depth : NULL,
+                    clear.has_stencil ? &clear.stencil : NULL
+                );
+                break;
+            }
+            case MGL_COMMAND_INVALIDATE_FRAMEBUFFER: {
+                MGLInvalidateFramebufferCommand & invalidate = command.invalidate_framebuffer;
+                MGLFramebuffer_invalidate_attachments(
+                    invalidate.framebuffer, invalidate.num_attachments, (unsigned *)(self->data + invalidate.attachments),
+                    invalidate.has_viewport ? &invalidate.viewport : NULL
+                );
+                break;
+            }
+            case MGL_COMMAND_INVALIDATE_TEXTURE: {
+                if (gl.InvalidateTexImage) {
+                    gl.InvalidateTexImage(command.invalidate_texture.texture_obj, command.invalidate_texture.level);
+                }
+                break;
+            }
+            case MGL_COMMAND_COMPUTE: {
+                MGLComputeCommand & compute = command.compute;
+                if (compute.program->released) {
+                    MGLError_Set("the program was released");
+                    return NULL;
+                }
+                gl.UseProgram(compute.program->program_obj);
+                gl.DispatchCompute(compute.x, compute.y, compute.z);
+                break;
+            }
+            case MGL_COMMAND_SCOPE_BEGIN: {
+                PyObject * result = MGLScope_begin(command.scope, NULL);
+                if (!result) {
+                    return NULL;
+                }
+                Py_DECREF(result);
+                break;
+            }
+            case MGL_COMMAND_SCOPE_END: {
+                PyObject * result = MGLScope_end(command.scope, NULL);
+                if (!result) {
+                    return NULL;
+                }
+                Py_DECREF(result);
+                break;
+            }
+        }
+    }
+
+    Py_RETURN_NONE;
+}
+
+static MGLCommand * MGLCommandList_get(MGLCommandList * self, int handle, int type) {
+    if (handle < 0 || handle >= self->num_commands || self->commands[handle].type != type) {
+        MGLError_Set("invalid command handle");
+        return NULL;
+    }
+    return &self->commands[handle];
+}
+
+static PyObject * MGLCommandList_set_uniform(MGLCommandList * self, PyObject * args) {
+    int handle;
+    Py_buffer view = {};
+
+    if (!PyArg_ParseTuple(args, "iy*", &handle, &view)) {
+        return NULL;
+    }
+
+    MGLCommand * command = MGLCommandList_get(self, handle, MGL_COMMAND_UNIFORM);
+    if (!command || view.len != command->uniform.size) {
+        if (command) {
+            MGLError_Set("invalid uniform size");
+        }
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    memcpy(self->data + command->uniform.data, view.buf, view.len);
+    PyBuffer_Release(&view);
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLCommandList_set_render(MGLCommandList * self, PyObject * args) {
+    int handle;
+    PyObject * vertices;
+    PyObject * first;
+    PyObject * instances;
+
+    if (!PyArg_ParseTuple(args, "iOOO", &handle, &vertices, &first, &instances)) {
+        return NULL;
+    }
+
+    MGLCommand * command = MGLCommandList_get(self, handle, MGL_COMMAND_RENDER);
+    if (!command) {
+        return NULL;
+    }
+
+    if (vertices != Py_None) {
+        command->render.vertices = PyLong_AsLong(vertices);
+    }
+
+    if (first != Py_None) {
+        command->render.first = PyLong_AsLong(first);
+    }
+
+    if (instances != Py_None) {
+        command->render.instances = PyLong_AsLong(instances);
+    }
+
+    if (PyErr_Occurred()) {
+        return NULL;
+    }
 
-    PyBuffer_Release(&view);
     Py_RETURN_NONE;
 }
 
-static PyObject * MGLContext_set_uniform_handle(MGLContext * self, PyObject * args) {
-    int program_obj;
-    int location;
-    unsigned long long handle;
+static PyObject * MGLCommandList_set_buffer_offset(MGLCommandList * self, PyObject * args) {
+    int handle;
+    Py_ssize_t offset;
 
-    if (!PyArg_ParseTuple(args, "IIK", &program_obj, &location, &handle)) {
+    if (!PyArg_ParseTuple(args, "in", &handle, &offset)) {
         return NULL;
     }
 
-    self->gl.ProgramUniformHandleui64ARB(program_obj, location, handle);
+    MGLCommand * command = MGLCommandList_get(self, handle, MGL_COMMAND_BIND_BUFFER);
+    if (!command) {
+        return NULL;
+    }
+
+    command->bind_buffer.offset = offset;
+    Py_RETURN_NONE;
+}
+
+static PyObject * MGLCommandList_size(MGLCommandList * self, PyObject * args) {
+    return PyLong_FromLong(self->num_commands);
+}
+
+static PyObject * MGLCommandList_release(MGLCommandList * self, PyObject * args) {
+    if (self->released) {
+        Py_RETURN_NONE;
+    }
+    self->released = true;
+
+    if (self->context->recording == self) {
+        self->context->recording = NULL;
+    }
+
+    Py_DECREF(self->objects);
+    PyMem_Free(self->commands);
+    PyMem_Free(self->data);
+    self->num_commands = 0;
+
+    Py_DECREF(self->context);
+    Py_DECREF(self);
     Py_RETURN_NONE;
 }
 
@@ -7918,6 +11370,10 @@ static PyObject * MGLContext_get_line_width(MGLContext * self, void * closure) {
 }
 
 static int MGLContext_set_line_width(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     float line_width = (float)PyFloat_AsDouble(value);
 
     if (PyErr_Occurred()) {
@@ -7938,6 +11394,10 @@ static PyObject * MGLContext_get_point_size(MGLContext * self, void * closure) {
 }
 
 static int MGLContext_set_point_size(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     float point_size = (float)PyFloat_AsDouble(value);
 
     if (PyErr_Occurred()) {
@@ -7987,6 +11447,10 @@ static PyObject * MGLContext_get_blend_func(MGLContext * self, void * closure) {
 }
 
 static int MGLContext_set_blend_func(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     int func[4] = {};
     if (!parse_blend_func(value, func)) {
         MGLError_Set("invalid blend func");
@@ -8040,6 +11504,10 @@ static PyObject * MGLContext_get_blend_equation(MGLContext * self, void * closur
 }
 
 static int MGLContext_set_blend_equation(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     int equation[2] = {};
     if (!parse_blend_equation(value, equation)) {
         MGLError_Set("invalid blend equation");
@@ -8055,6 +11523,10 @@ static PyObject * MGLContext_get_depth_func(MGLContext * self, void * closure) {
 }
 
 static int MGLContext_set_depth_func(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     const char * func = PyUnicode_AsUTF8(value);
 
     if (PyErr_Occurred()) {
@@ -8081,6 +11553,10 @@ static PyObject * MGLContext_get_depth_clamp_range(MGLContext * self, void * clo
 }
 
 static int MGLContext_set_depth_clamp_range(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     if (value == Py_None) {
         self->depth_clamp = false;
         self->depth_range[0] = 0.0;
@@ -8106,6 +11582,10 @@ static PyObject * MGLContext_get_multisample(MGLContext * self, void * closure)
 }
 
 static int MGLContext_set_multisample(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     if (value == Py_True) {
         self->gl.Enable(GL_MULTISAMPLE);
         self->multisample = true;
@@ -8123,6 +11603,10 @@ static PyObject * MGLContext_get_provoking_vertex(MGLContext * self, void * clos
 }
 
 static int MGLContext_set_provoking_vertex(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     int provoking_vertex_value = PyLong_AsLong(value);
     const GLMethods & gl = self->gl;
 
@@ -8139,6 +11623,10 @@ static PyObject * MGLContext_get_polygon_offset(MGLContext * self, void * closur
 }
 
 static int MGLContext_set_polygon_offset(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     if (!PyTuple_CheckExact(value) || PyTuple_Size(value) != 2) {
         return -1;
     }
@@ -8218,6 +11706,10 @@ static PyObject * MGLContext_get_wireframe(MGLContext * self, void * closure) {
 }
 
 static int MGLContext_set_wireframe(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     if (value == Py_True) {
         self->gl.PolygonMode(GL_FRONT_AND_BACK, GL_LINE);
         self->wireframe = true;
@@ -8243,6 +11735,10 @@ static PyObject * MGLContext_get_front_face(MGLContext * self, void * closure) {
 }
 
 static int MGLContext_set_front_face(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     const char * str = PyUnicode_AsUTF8(value);
 
     if (!strcmp(str, "cw")) {
@@ -8275,6 +11771,10 @@ static PyObject * MGLContext_get_cull_face(MGLContext * self, void * closure) {
 }
 
 static int MGLContext_set_cull_face(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     const char * str = PyUnicode_AsUTF8(value);
 
     if (!strcmp(str, "front")) {
@@ -8301,6 +11801,10 @@ static PyObject * MGLContext_get_patch_vertices(MGLContext * self, void * closur
 }
 
 static int MGLContext_set_patch_vertices(MGLContext * self, PyObject * value, void * closure) {
+    if (!check_not_recording(self)) {
+        return -1;
+    }
+
     int patch_vertices = PyLong_AsLong(value);
 
     if (PyErr_Occurred()) {
@@ -8523,6 +12027,312 @@ static PyObject * MGLContext_get_info(MGLContext * self, void * closure) {
     return info;
 }
 
+static PyObject * pack_draw_commands(PyObject * self, PyObject * args) {
+    PyObject * fields[5];
+    int indexed;
+
+    int args_ok = PyArg_ParseTuple(
+        args,
+        "OOOOOp",
+        &fields[0],
+        &fields[1],
+        &fields[2],
+        &fields[3],
+        &fields[4],
+        &indexed
+    );
+
+    if (!args_ok) {
+        return 0;
+    }
+
+    const char * names[] = {"counts", "instances", "first", "base_vertex", "base_instance"};
+
+    // Each field is either a single integer or an int32 buffer with one value per command
+    Py_buffer views[5] = {};
+    int scalars[5] = {};
+    int num_commands = -1;
+    bool failed = false;
+
+    for (int i = 0; i < 5 && !failed; ++i) {
+        if (PyLong_Check(fields[i])) {
+            scalars[i] = (int)PyLong_AsLong(fields[i]);
+            failed = PyErr_Occurred() != NULL;
+            continue;
+        }
+
+        int length = get_int32_buffer(fields[i], &views[i], names[i]);
+        if (length < 0) {
+            failed = true;
+        } else if (num_commands >= 0 && length != num_commands) {
+            MGLError_Set("%s must have one value per command", names[i]);
+            failed = true;
+        } else {
+            num_commands = length;
+        }
+    }
+
+    if (!failed && num_commands < 0) {
+        MGLError_Set("at least one field must be a buffer");
+        failed = true;
+    }
+
+    if (!failed && !indexed && (views[3].buf || scalars[3])) {
+        MGLError_Set("base_vertex requires indexed commands");
+        failed = true;
+    }
+
+    PyObject * res = NULL;
+
+    if (!failed) {
+        int components = indexed ? 5 : 4;
+        res = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)num_commands * components * 4);
+        int * ptr = (int *)PyBytes_AS_STRING(res);
+
+        // DrawArraysIndirectCommand has no base vertex, the base instance follows the first vertex
+        const int order[] = {0, 1, 2, 3, 4};
+        const int arrays_order[] = {0, 1, 2, 4};
+        const int * layout = indexed ? order : arrays_order;
+
+        for (int i = 0; i < num_commands; ++i) {
+            for (int c = 0; c < components; ++c) {
+                int field = layout[c];
+                *ptr++ = views[field].buf ? ((const int *)views[field].buf)[i] : scalars[field];
+            }
+        }
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        if (views[i].obj) {
+            PyBuffer_Release(&views[i]);
+        }
+    }
+
+    return res;
+}
+
+static int get_float32_buffer(PyObject * data, Py_buffer * view, const char * name) {
+    if (PyObject_GetBuffer(data, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+        PyErr_Clear();
+        MGLError_Set("%s must be a contiguous float32 buffer", name);
+        return -1;
+    }
+
+    // Raw bytes are accepted as native float32 values
+    bool raw = view->itemsize == 1 && (!view->format || !strcmp(view->format, "B"));
+    bool float32 = view->itemsize == 4 && view->format && *view->format && view->format[strlen(view->format) - 1] == 'f';
+
+    if ((!raw && !float32) || view->len % 4) {
+        PyBuffer_Release(view);
+        MGLError_Set("%s must be a contiguous float32 buffer", name);
+        return -1;
+    }
+
+    return (int)(view->len / 4);
+}
+
+static inline double quantize_clamp(double x, double low, double high) {
+    if (!(x >= low)) {
+        x = low;
+    }
+    if (x > high) {
+        x = high;
+    }
+    return x < 0.0 ? x - 0.5 : x + 0.5;
+}
+
+// Unsigned float with a 5 bit exponent as used by f11 (6 or 5 mantissa bits) and half floats (10 mantissa bits)
+static unsigned quantize_small_float(float value, int mantissa_bits) {
+    if (!(value > 0.0f)) {
+        return 0;
+    }
+
+    unsigned bits;
+    memcpy(&bits, &value, 4);
+    int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    unsigned mantissa = bits & 0x7fffff;
+    unsigned max_finite = (30u << mantissa_bits) | ((1u << mantissa_bits) - 1);
+
+    if (exponent >= 31) {
+        return max_finite;
+    }
+
+    if (exponent <= 0) {
+        int shift = 24 - mantissa_bits - exponent;
+        if (shift > 24) {
+            return 0;
+        }
+        mantissa |= 0x800000;
+        return (mantissa + (1u << (shift - 1))) >> shift;
+    }
+
+    unsigned res = (((unsigned)exponent << 23 | mantissa) + (1u << (22 - mantissa_bits))) >> (23 - mantissa_bits);
+    return res > max_finite ? max_finite : res;
+}
+
+static void quantize_node(const FormatNode & node, const float * src, char * dst) {
+    // Signed normalization follows OpenGL 4.2: -1.0 maps to -max, not to the minimum integer
+    bool normalize = node.normalize;
+
+    switch (node.type) {
+        case GL_FLOAT:
+            memcpy(dst, src, node.size);
+            break;
+
+        case GL_DOUBLE:
+            for (int i = 0; i < node.count; ++i) {
+                ((double *)dst)[i] = src[i];
+            }
+            break;
+
+        case GL_HALF_FLOAT:
+            for (int i = 0; i < node.count; ++i) {
+                unsigned sign = src[i] < 0.0f ? 0x8000 : 0;
+                ((unsigned short *)dst)[i] = (unsigned short)(sign | quantize_small_float(sign ? -src[i] : src[i], 10));
+            }
+            break;
+
+        case GL_UNSIGNED_BYTE:
+            for (int i = 0; i < node.count; ++i) {
+                double value = normalize ? src[i] * 255.0 : src[i];
+                ((unsigned char *)dst)[i] = (unsigned char)quantize_clamp(value, 0.0, 255.0);
+            }
+            break;
+
+        case GL_BYTE:
+            for (int i = 0; i < node.count; ++i) {
+                double value = normalize ? src[i] * 127.0 : src[i];
+                ((signed char *)dst)[i] = (signed char)quantize_clamp(value, normalize ? -127.0 : -128.0, 127.0);
+            }
+            break;
+
+        case GL_UNSIGNED_SHORT:
+            for (int i = 0; i < node.count; ++i) {
+                double value = normalize ? src[i] * 65535.0 : src[i];
+                ((unsigned short *)dst)[i] = (unsigned short)quantize_clamp(value, 0.0, 65535.0);
+            }
+            break;
+
+        case GL_SHORT:
+            for (int i = 0; i < node.count; ++i) {
+                double value = normalize ? src[i] * 32767.0 : src[i];
+                ((short *)dst)[i] = (short)quantize_clamp(value, normalize ? -32767.0 : -32768.0, 32767.0);
+            }
+            break;
+
+        case GL_UNSIGNED_INT:
+            for (int i = 0; i < node.count; ++i) {
+                double value = normalize ? src[i] * 4294967295.0 : src[i];
+                ((unsigned *)dst)[i] = (unsigned)quantize_clamp(value, 0.0, 4294967295.0);
+            }
+            break;
+
+        case GL_INT:
+            for (int i = 0; i < node.count; ++i) {
+                double value = normalize ? src[i] * 2147483647.0 : src[i];
+                ((int *)dst)[i] = (int)quantize_clamp(value, normalize ? -2147483647.0 : -2147483648.0, 2147483647.0);
+            }
+            break;
+
+        case GL_INT_2_10_10_10_REV: {
+            unsigned packed = 0;
+            for (int i = 0; i < 4; ++i) {
+                int bits = i < 3 ? 10 : 2;
+                double high = (double)((1 << (bits - 1)) - 1);
+                double low = normalize ? -high : -high - 1.0;
+                int value = (int)quantize_clamp(normalize ? src[i] * high : src[i], low, high);
+                packed |= ((unsigned)value & ((1u << bits) - 1)) << (i * 10);
+            }
+            memcpy(dst, &packed, 4);
+            break;
+        }
+
+        case GL_UNSIGNED_INT_2_10_10_10_REV: {
+            unsigned packed = 0;
+            for (int i = 0; i < 4; ++i) {
+                int bits = i < 3 ? 10 : 2;
+                double high = (double)((1 << bits) - 1);
+                unsigned value = (unsigned)quantize_clamp(normalize ? src[i] * high : src[i], 0.0, high);
+                packed |= value << (i * 10);
+            }
+            memcpy(dst, &packed, 4);
+            break;
+        }
+
+        case GL_UNSIGNED_INT_10F_11F_11F_REV: {
+            unsigned packed = quantize_small_float(src[0], 6) | quantize_small_float(src[1], 6) << 11 | quantize_small_float(src[2], 5) << 22;
+            memcpy(dst, &packed, 4);
+            break;
+        }
+
+        default:
+            memset(dst, 0, node.size);
+            break;
+    }
+}
+
+static PyObject * quantize(PyObject * self, PyObject * args) {
+    PyObject * data;
+    const char * format;
+
+    if (!PyArg_ParseTuple(args, "Os", &data, &format)) {
+        return 0;
+    }
+
+    MGLVertexFormat * vertex_format = parse_vertex_format(format);
+
+    if (!vertex_format) {
+        MGLError_Set("invalid format: %s", format);
+        return 0;
+    }
+
+    // Every attribute node takes its component count of floats from each row, padding takes none
+    int row_length = 0;
+    for (int i = 0; i < vertex_format->num_nodes; ++i) {
+        if (vertex_format->nodes[i].type) {
+            row_length += vertex_format->nodes[i].count;
+        }
+    }
+
+    Py_buffer view;
+    int length = get_float32_buffer(data, &view, "data");
+
+    if (length < 0) {
+        Py_DECREF(vertex_format);
+        return 0;
+    }
+
+    if (!row_length || length % row_length) {
+        MGLError_Set("the data must contain a multiple of %d floats", row_length);
+        PyBuffer_Release(&view);
+        Py_DECREF(vertex_format);
+        return 0;
+    }
+
+    int rows = length / row_length;
+    PyObject * res = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)rows * vertex_format->info.size);
+    char * dst = PyBytes_AS_STRING(res);
+    const float * src = (const float *)view.buf;
+
+    // The format and both buffers are held by this call, the conversion does not touch any Python object
+    Py_BEGIN_ALLOW_THREADS
+    for (int r = 0; r < rows; ++r) {
+        for (int i = 0; i < vertex_format->num_nodes; ++i) {
+            const FormatNode & node = vertex_format->nodes[i];
+            quantize_node(node, src, dst);
+            if (node.type) {
+                src += node.count;
+            }
+            dst += node.size;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&view);
+    Py_DECREF(vertex_format);
+    return res;
+}
+
 static PyObject * strsize(PyObject * self, PyObject * args) {
     const char * str;
 
@@ -8775,6 +12585,13 @@ static PyObject * create_context(PyObject * self, PyObject * args, PyObject * kw
     Py_INCREF(ctx->default_framebuffer);
     ctx->bound_framebuffer = ctx->default_framebuffer;
     ctx->includes = PyDict_New();
+    ctx->include_cache = PyDict_New();
+    ctx->shader_cache = PyDict_New();
+    ctx->recording = NULL;
+    ctx->capturing = NULL;
+    ctx->framebuffer_state.valid = false;
+    ctx->shader_cache_hits = 0;
+    ctx->shader_cache_misses = 0;
 
     ctx->enable_flags = 0;
     ctx->front_face = GL_CCW;
@@ -8809,6 +12626,8 @@ static void default_dealloc(PyObject * self) {
 
 static PyMethodDef MGL_module_methods[] = {
     {(char *)"strsize", (PyCFunction)strsize, METH_VARARGS},
+    {(char *)"pack_draw_commands", (PyCFunction)pack_draw_commands, METH_VARARGS},
+    {(char *)"quantize", (PyCFunction)quantize, METH_VARARGS},
     {(char *)"create_context", (PyCFunction)create_context, METH_VARARGS | METH_KEYWORDS},
     {(char *)"writable_bytes", (PyCFunction)writable_bytes, METH_O},
     {(char *)"expected_size", (PyCFunction)expected_size, METH_VARARGS},
@@ -8831,6 +12650,17 @@ static PyMethodDef MGLBuffer_methods[] = {
     {},
 };
 
+static PyMethodDef MGLCommandList_methods[] = {
+    {(char *)"end", (PyCFunction)MGLCommandList_end, METH_NOARGS},
+    {(char *)"execute", (PyCFunction)MGLCommandList_execute, METH_NOARGS},
+    {(char *)"set_uniform", (PyCFunction)MGLCommandList_set_uniform, METH_VARARGS},
+    {(char *)"set_render", (PyCFunction)MGLCommandList_set_render, METH_VARARGS},
+    {(char *)"set_buffer_offset", (PyCFunction)MGLCommandList_set_buffer_offset, METH_VARARGS},
+    {(char *)"size", (PyCFunction)MGLCommandList_size, METH_NOARGS},
+    {(char *)"release", (PyCFunction)MGLCommandList_release, METH_NOARGS},
+    {},
+};
+
 static PyMethodDef MGLContext_methods[] = {
     {(char *)"enable_only", (PyCFunction)MGLContext_enable_only, METH_VARARGS},
     {(char *)"enable", (PyCFunction)MGLContext_enable, METH_VARARGS},
@@ -8838,8 +12668,10 @@ static PyMethodDef MGLContext_methods[] = {
     {(char *)"enable_direct", (PyCFunction)MGLContext_enable_direct, METH_VARARGS},
     {(char *)"disable_direct", (PyCFunction)MGLContext_disable_direct, METH_VARARGS},
     {(char *)"finish", (PyCFunction)MGLContext_finish, METH_NOARGS},
+    {(char *)"reset_framebuffer_state", (PyCFunction)MGLContext_reset_framebuffer_state, METH_NOARGS},
     {(char *)"copy_buffer", (PyCFunction)MGLContext_copy_buffer, METH_VARARGS},
     {(char *)"copy_framebuffer", (PyCFunction)MGLContext_copy_framebuffer, METH_VARARGS},
+    {(char *)"resolve", (PyCFunction)MGLContext_resolve, METH_VARARGS},
     {(char *)"detect_framebuffer", (PyCFunction)MGLContext_detect_framebuffer, METH_VARARGS},
     {(char *)"clear_samplers", (PyCFunction)MGLContext_clear_samplers, METH_VARARGS},
 
@@ -8853,11 +12685,21 @@ static PyMethodDef MGLContext_methods[] = {
     {(char *)"depth_texture_cube", (PyCFunction)MGLContext_depth_texture_cube, METH_VARARGS},
     {(char *)"external_texture", (PyCFunction)MGLContext_external_texture, METH_VARARGS},
     {(char *)"vertex_array", (PyCFunction)MGLContext_vertex_array, METH_VARARGS},
+    {(char *)"vertex_format", (PyCFunction)MGLContext_vertex_format, METH_VARARGS},
+    {(char *)"transform_feedback", (PyCFunction)MGLContext_transform_feedback, METH_VARARGS},
+    {(char *)"feedback_loop", (PyCFunction)MGLContext_feedback_loop, METH_VARARGS},
     {(char *)"program", (PyCFunction)MGLContext_program, METH_VARARGS},
+    {(char *)"clear_shader_cache", (PyCFunction)MGLContext_clear_shader_cache, METH_NOARGS},
+    {(char *)"shader_cache_stats", (PyCFunction)MGLContext_shader_cache_stats, METH_NOARGS},
+    {(char *)"preprocess", (PyCFunction)MGLContext_preprocess, METH_VARARGS},
+    {(char *)"invalidate_includes", (PyCFunction)MGLContext_invalidate_includes, METH_VARARGS},
+    {(char *)"pipeline", (PyCFunction)MGLContext_pipeline, METH_VARARGS},
     {(char *)"framebuffer", (PyCFunction)MGLContext_framebuffer, METH_VARARGS},
     {(char *)"empty_framebuffer", (PyCFunction)MGLContext_empty_framebuffer, METH_VARARGS},
     {(char *)"query", (PyCFunction)MGLContext_query, METH_VARARGS},
+    {(char *)"readback", (PyCFunction)MGLContext_readback, METH_NOARGS},
     {(char *)"scope", (PyCFunction)MGLContext_scope, METH_VARARGS},
+    {(char *)"record", (PyCFunction)MGLContext_record, METH_NOARGS},
     {(char *)"sampler", (PyCFunction)MGLContext_sampler, METH_VARARGS},
     {(char *)"memory_barrier", (PyCFunction)MGLContext_memory_barrier, METH_VARARGS},
 
@@ -8923,8 +12765,12 @@ static PyGetSetDef MGLFramebuffer_getset[] = {
 
 static PyMethodDef MGLFramebuffer_methods[] = {
     {(char *)"clear", (PyCFunction)MGLFramebuffer_clear, METH_VARARGS},
+    {(char *)"clear_attachments", (PyCFunction)MGLFramebuffer_clear_attachments, METH_VARARGS},
+    {(char *)"invalidate", (PyCFunction)MGLFramebuffer_invalidate, METH_VARARGS},
     {(char *)"use", (PyCFunction)MGLFramebuffer_use, METH_NOARGS},
     {(char *)"read_into", (PyCFunction)MGLFramebuffer_read_into, METH_VARARGS},
+    {(char *)"pick", (PyCFunction)MGLFramebuffer_pick, METH_VARARGS},
+    {(char *)"read_async", (PyCFunction)MGLFramebuffer_read_async, METH_VARARGS},
     {(char *)"release", (PyCFunction)MGLFramebuffer_release, METH_NOARGS},
     {},
 };
@@ -8932,10 +12778,17 @@ static PyMethodDef MGLFramebuffer_methods[] = {
 static PyMethodDef MGLProgram_methods[] = {
     {(char *)"run", (PyCFunction)MGLProgram_run, METH_VARARGS},
     {(char *)"run_indirect", (PyCFunction)MGLProgram_run_indirect, METH_VARARGS},
+    {(char *)"swap", (PyCFunction)MGLProgram_swap, METH_VARARGS},
+    {(char *)"detect_format", (PyCFunction)MGLProgram_detect_format, METH_VARARGS},
     {(char *)"release", (PyCFunction)MGLProgram_release, METH_NOARGS},
     {},
 };
 
+static PyMethodDef MGLProgramPipeline_methods[] = {
+    {(char *)"release", (PyCFunction)MGLProgramPipeline_release, METH_NOARGS},
+    {},
+};
+
 static PyGetSetDef MGLQuery_getset[] = {
     {(char *)"samples", (getter)MGLQuery_get_samples, NULL},
     {(char *)"primitives", (getter)MGLQuery_get_primitives, NULL},
@@ -8943,6 +12796,19 @@ static PyGetSetDef MGLQuery_getset[] = {
     {},
 };
 
+static PyMethodDef MGLReadback_methods[] = {
+    {(char *)"done", (PyCFunction)MGLReadback_done, METH_NOARGS},
+    {(char *)"wait", (PyCFunction)MGLReadback_wait, METH_VARARGS},
+    {(char *)"read_into", (PyCFunction)MGLReadback_read_into, METH_VARARGS},
+    {(char *)"release", (PyCFunction)MGLReadback_release, METH_NOARGS},
+    {},
+};
+
+static PyGetSetDef MGLReadback_getset[] = {
+    {(char *)"generation", (getter)MGLReadback_get_generation, NULL},
+    {},
+};
+
 static PyMethodDef MGLQuery_methods[] = {
     {(char *)"begin", (PyCFunction)MGLQuery_begin, METH_NOARGS},
     {(char *)"end", (PyCFunction)MGLQuery_end, METH_NOARGS},
@@ -8999,6 +12865,7 @@ static PyMethodDef MGLTexture_methods[] = {
     {(char *)"bind", (PyCFunction)MGLTexture_meth_bind, METH_VARARGS},
     {(char *)"use", (PyCFunction)MGLTexture_use, METH_VARARGS},
     {(char *)"build_mipmaps", (PyCFunction)MGLTexture_build_mipmaps, METH_VARARGS},
+    {(char *)"invalidate", (PyCFunction)MGLTexture_invalidate, METH_VARARGS},
     {(char *)"read", (PyCFunction)MGLTexture_read, METH_VARARGS},
     {(char *)"read_into", (PyCFunction)MGLTexture_read_into, METH_VARARGS},
     {(char *)"get_handle", (PyCFunction)MGLTexture_get_handle, METH_VARARGS},
@@ -9070,13 +12937,51 @@ static PyMethodDef MGLTextureCube_methods[] = {
 
 static PyMethodDef MGLVertexArray_methods[] = {
     {(char *)"render", (PyCFunction)MGLVertexArray_render, METH_VARARGS},
+    {(char *)"render_base_vertex", (PyCFunction)MGLVertexArray_render_base_vertex, METH_VARARGS},
+    {(char *)"render_multi", (PyCFunction)MGLVertexArray_render_multi, METH_VARARGS},
     {(char *)"render_indirect", (PyCFunction)MGLVertexArray_render_indirect, METH_VARARGS},
     {(char *)"transform", (PyCFunction)MGLVertexArray_transform, METH_VARARGS},
     {(char *)"bind", (PyCFunction)MGLVertexArray_bind, METH_VARARGS},
+    {(char *)"render_feedback", (PyCFunction)MGLVertexArray_render_feedback, METH_VARARGS},
+    {(char *)"bind_vertex_buffer", (PyCFunction)MGLVertexArray_bind_vertex_buffer, METH_VARARGS},
+    {(char *)"bind_vertex_buffers", (PyCFunction)MGLVertexArray_bind_vertex_buffers, METH_VARARGS},
     {(char *)"release", (PyCFunction)MGLVertexArray_release, METH_NOARGS},
     {},
 };
 
+static PyMethodDef MGLFeedbackLoop_methods[] = {
+    {(char *)"step", (PyCFunction)MGLFeedbackLoop_step, METH_VARARGS},
+    {(char *)"release", (PyCFunction)MGLFeedbackLoop_release, METH_NOARGS},
+    {},
+};
+
+static PyGetSetDef MGLFeedbackLoop_getset[] = {
+    {(char *)"current", (getter)MGLFeedbackLoop_get_current, NULL},
+    {(char *)"stepped", (getter)MGLFeedbackLoop_get_stepped, NULL},
+    {},
+};
+
+static PyMethodDef MGLTransformFeedback_methods[] = {
+    {(char *)"end", (PyCFunction)MGLTransformFeedback_end, METH_NOARGS},
+    {(char *)"primitives_written", (PyCFunction)MGLTransformFeedback_primitives_written, METH_VARARGS},
+    {(char *)"write_primitives_written", (PyCFunction)MGLTransformFeedback_write_primitives_written, METH_VARARGS},
+    {(char *)"release", (PyCFunction)MGLTransformFeedback_release, METH_NOARGS},
+    {},
+};
+
+static PyGetSetDef MGLTransformFeedback_getset[] = {
+    {(char *)"active", (getter)MGLTransformFeedback_get_active, NULL},
+    {(char *)"streams", (getter)MGLTransformFeedback_get_streams, NULL},
+    {},
+};
+
+static PyGetSetDef MGLVertexFormat_getset[] = {
+    {(char *)"size", (getter)MGLVertexFormat_get_size, NULL},
+    {(char *)"divisor", (getter)MGLVertexFormat_get_divisor, NULL},
+    {(char *)"attributes", (getter)MGLVertexFormat_get_attributes, NULL},
+    {},
+};
+
 static PyGetSetDef MGLVertexArray_getset[] = {
     {(char *)"index_buffer", NULL, (setter)MGLVertexArray_set_index_buffer},
     {(char *)"vertices", (getter)MGLVertexArray_get_vertices, (setter)MGLVertexArray_set_vertices},
@@ -9094,6 +12999,12 @@ static PyType_Slot MGLBuffer_slots[] = {
     {},
 };
 
+static PyType_Slot MGLCommandList_slots[] = {
+    {Py_tp_methods, MGLCommandList_methods},
+    {Py_tp_dealloc, (void *)default_dealloc},
+    {},
+};
+
 static PyType_Slot MGLContext_slots[] = {
     {Py_tp_methods, MGLContext_methods},
     {Py_tp_getset, MGLContext_getset},
@@ -9114,6 +13025,19 @@ static PyType_Slot MGLProgram_slots[] = {
     {},
 };
 
+static PyType_Slot MGLProgramPipeline_slots[] = {
+    {Py_tp_methods, MGLProgramPipeline_methods},
+    {Py_tp_dealloc, (void *)default_dealloc},
+    {},
+};
+
+static PyType_Slot MGLReadback_slots[] = {
+    {Py_tp_methods, MGLReadback_methods},
+    {Py_tp_getset, MGLReadback_getset},
+    {Py_tp_dealloc, (void *)default_dealloc},
+    {},
+};
+
 static PyType_Slot MGLQuery_slots[] = {
     {Py_tp_methods, MGLQuery_methods},
     {Py_tp_getset, MGLQuery_getset},
@@ -9168,6 +13092,26 @@ static PyType_Slot MGLVertexArray_slots[] = {
     {},
 };
 
+static PyType_Slot MGLFeedbackLoop_slots[] = {
+    {Py_tp_methods, MGLFeedbackLoop_methods},
+    {Py_tp_getset, MGLFeedbackLoop_getset},
+    {Py_tp_dealloc, (void *)default_dealloc},
+    {},
+};
+
+static PyType_Slot MGLTransformFeedback_slots[] = {
+    {Py_tp_methods, MGLTransformFeedback_methods},
+    {Py_tp_getset, MGLTransformFeedback_getset},
+    {Py_tp_dealloc, (void *)default_dealloc},
+    {},
+};
+
+static PyType_Slot MGLVertexFormat_slots[] = {
+    {Py_tp_getset, MGLVertexFormat_getset},
+    {Py_tp_dealloc, (void *)MGLVertexFormat_dealloc},
+    {},
+};
+
 static PyType_Slot MGLSampler_slots[] = {
     {Py_tp_methods, MGLSampler_methods},
     {Py_tp_getset, MGLSampler_getset},
@@ -9176,10 +13120,13 @@ static PyType_Slot MGLSampler_slots[] = {
 };
 
 static PyType_Spec MGLBuffer_spec = {"mgl.Buffer", sizeof(MGLBuffer), 0, Py_TPFLAGS_DEFAULT, MGLBuffer_slots};
+static PyType_Spec MGLCommandList_spec = {"mgl.CommandList", sizeof(MGLCommandList), 0, Py_TPFLAGS_DEFAULT, MGLCommandList_slots};
 static PyType_Spec MGLContext_spec = {"mgl.Context", sizeof(MGLContext), 0, Py_TPFLAGS_DEFAULT, MGLContext_slots};
 static PyType_Spec MGLFramebuffer_spec = {"mgl.Framebuffer", sizeof(MGLFramebuffer), 0, Py_TPFLAGS_DEFAULT, MGLFramebuffer_slots};
 static PyType_Spec MGLProgram_spec = {"mgl.Program", sizeof(MGLProgram), 0, Py_TPFLAGS_DEFAULT, MGLProgram_slots};
+static PyType_Spec MGLProgramPipeline_spec = {"mgl.ProgramPipeline", sizeof(MGLProgramPipeline), 0, Py_TPFLAGS_DEFAULT, MGLProgramPipeline_slots};
 static PyType_Spec MGLQuery_spec = {"mgl.Query", sizeof(MGLQuery), 0, Py_TPFLAGS_DEFAULT, MGLQuery_slots};
+static PyType_Spec MGLReadback_spec = {"mgl.Readback", sizeof(MGLReadback), 0, Py_TPFLAGS_DEFAULT, MGLReadback_slots};
 static PyType_Spec MGLRenderbuffer_spec = {"mgl.Renderbuffer", sizeof(MGLRenderbuffer), 0, Py_TPFLAGS_DEFAULT, MGLRenderbuffer_slots};
 static PyType_Spec MGLScope_spec = {"mgl.Scope", sizeof(MGLScope), 0, Py_TPFLAGS_DEFAULT, MGLScope_slots};
 static PyType_Spec MGLTexture_spec = {"mgl.Texture", sizeof(MGLTexture), 0, Py_TPFLAGS_DEFAULT, MGLTexture_slots};
@@ -9187,6 +13134,9 @@ static PyType_Spec MGLTextureArray_spec = {"mgl.TextureArray", sizeof(MGLTexture
 static PyType_Spec MGLTextureCube_spec = {"mgl.TextureCube", sizeof(MGLTextureCube), 0, Py_TPFLAGS_DEFAULT, MGLTextureCube_slots};
 static PyType_Spec MGLTexture3D_spec = {"mgl.Texture3D", sizeof(MGLTexture3D), 0, Py_TPFLAGS_DEFAULT, MGLTexture3D_slots};
 static PyType_Spec MGLVertexArray_spec = {"mgl.VertexArray", sizeof(MGLVertexArray), 0, Py_TPFLAGS_DEFAULT, MGLVertexArray_slots};
+static PyType_Spec MGLFeedbackLoop_spec = {"mgl.FeedbackLoop", sizeof(MGLFeedbackLoop), 0, Py_TPFLAGS_DEFAULT, MGLFeedbackLoop_slots};
+static PyType_Spec MGLTransformFeedback_spec = {"mgl.TransformFeedback", sizeof(MGLTransformFeedback), 0, Py_TPFLAGS_DEFAULT, MGLTransformFeedback_slots};
+static PyType_Spec MGLVertexFormat_spec = {"mgl.VertexFormat", sizeof(MGLVertexFormat), 0, Py_TPFLAGS_DEFAULT, MGLVertexFormat_slots};
 static PyType_Spec MGLSampler_spec = {"mgl.Sampler", sizeof(MGLSampler), 0, Py_TPFLAGS_DEFAULT, MGLSampler_slots};
 
 static PyModuleDef MGL_moduledef = {
@@ -9212,10 +13162,13 @@ extern "C" PyObject * PyInit_mgl() {
     moderngl_error = PyObject_GetAttrString(helper, "Error");
 
     MGLBuffer_type = (PyTypeObject *)PyType_FromSpec(&MGLBuffer_spec);
+    MGLCommandList_type = (PyTypeObject *)PyType_FromSpec(&MGLCommandList_spec);
     MGLContext_type = (PyTypeObject *)PyType_FromSpec(&MGLContext_spec);
     MGLFramebuffer_type = (PyTypeObject *)PyType_FromSpec(&MGLFramebuffer_spec);
     MGLProgram_type = (PyTypeObject *)PyType_FromSpec(&MGLProgram_spec);
+    MGLProgramPipeline_type = (PyTypeObject *)PyType_FromSpec(&MGLProgramPipeline_spec);
     MGLQuery_type = (PyTypeObject *)PyType_FromSpec(&MGLQuery_spec);
+    MGLReadback_type = (PyTypeObject *)PyType_FromSpec(&MGLReadback_spec);
     MGLRenderbuffer_type = (PyTypeObject *)PyType_FromSpec(&MGLRenderbuffer_spec);
     MGLScope_type = (PyTypeObject *)PyType_FromSpec(&MGLScope_spec);
     MGLTexture_type = (PyTypeObject *)PyType_FromSpec(&MGLTexture_spec);
@@ -9223,6 +13176,9 @@ extern "C" PyObject * PyInit_mgl() {
     MGLTextureCube_type = (PyTypeObject *)PyType_FromSpec(&MGLTextureCube_spec);
     MGLTexture3D_type = (PyTypeObject *)PyType_FromSpec(&MGLTexture3D_spec);
     MGLVertexArray_type = (PyTypeObject *)PyType_FromSpec(&MGLVertexArray_spec);
+    MGLFeedbackLoop_type = (PyTypeObject *)PyType_FromSpec(&MGLFeedbackLoop_spec);
+    MGLTransformFeedback_type = (PyTypeObject *)PyType_FromSpec(&MGLTransformFeedback_spec);
+    MGLVertexFormat_type = (PyTypeObject *)PyType_FromSpec(&MGLVertexFormat_spec);
     MGLSampler_type = (PyTypeObject *)PyType_FromSpec(&MGLSampler_spec);
 
     PyObject * InvalidObject = PyObject_GetAttrString(helper, "InvalidObject");
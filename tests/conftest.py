@@ -125,3 +125,32 @@ def ndc_quad(ctx_static):
         1.0, -1.0,
     ]
     return ctx_static.buffer(np.array(quad, dtype='f4'))
+
+
+@pytest.fixture
+def fullscreen_vao(ctx):
+    """
+    Returns a function creating vertex arrays that draw a triangle covering the viewport.
+
+    The function takes a program, a pipeline or the source of a fragment shader.
+    A fragment shader is linked with a vertex shader passing ``in_vert`` through.
+    """
+    vbo = ctx.buffer(np.array([-1.0, -1.0, 3.0, -1.0, -1.0, 3.0], dtype='f4'))
+
+    def vertex_array(program):
+        if isinstance(program, str):
+            program = ctx.program(
+                vertex_shader='''
+                    #version 330
+
+                    in vec2 in_vert;
+
+                    void main() {
+                        gl_Position = vec4(in_vert, 0.0, 1.0);
+                    }
+                ''',
+                fragment_shader=program,
+            )
+        return ctx.vertex_array(program, [(vbo, '2f', 'in_vert')])
+
+    return vertex_array
@@ -0,0 +1,116 @@
+import io
+import os
+
+import numpy as np
+import pytest
+import moderngl
+
+
+def fill(ctx, fbo, colors):
+    # paints the bottom and top half with different colors
+    fbo.use()
+    fbo.clear(*colors[0])
+    fbo.scissor = (0, fbo.height // 2, fbo.width, fbo.height - fbo.height // 2)
+    fbo.clear(*colors[1])
+    fbo.scissor = None
+
+
+def test_capture_rgb24(ctx):
+    fbo = ctx.simple_framebuffer((4, 4))
+    output = io.BytesIO()
+
+    with fbo.capture_stream(output) as stream:
+        for i in range(5):
+            fill(ctx, fbo, [(i / 255.0, 0.0, 0.0, 1.0), (0.0, 1.0, 0.0, 1.0)])
+            stream.capture()
+
+    assert stream.frames == 5
+    frames = np.frombuffer(output.getvalue(), dtype='u1').reshape(5, 4, 4, 3)
+
+    # the first row of each frame is the top of the image
+    assert tuple(frames[3, 0, 0]) == (0, 255, 0)
+    assert tuple(frames[3, 3, 0]) == (3, 0, 0)
+
+
+def test_capture_yuv420p(ctx):
+    fbo = ctx.framebuffer([ctx.texture((4, 2), 4)])
+    output = io.BytesIO()
+
+    stream = fbo.capture_stream(output, format='yuv420p', flip=False, depth=1)
+    fill(ctx, fbo, [(1.0, 1.0, 1.0, 1.0), (0.0, 0.0, 0.0, 1.0)])
+    stream.capture()
+    fbo.clear(1.0, 0.0, 0.0, 1.0)
+    stream.capture()
+    stream.close()
+
+    frames = np.frombuffer(output.getvalue(), dtype='u1').reshape(2, 12)
+    np.testing.assert_allclose(frames[0, :8], [235] * 4 + [16] * 4, atol=1)
+    np.testing.assert_allclose(frames[0, 8:], [128] * 4, atol=1)
+    np.testing.assert_allclose(frames[1], [81] * 8 + [90] * 2 + [240] * 2, atol=1)
+
+
+def test_capture_fd(ctx):
+    fbo = ctx.simple_framebuffer((2, 2))
+    read_fd, write_fd = os.pipe()
+
+    stream = fbo.capture_stream(write_fd, depth=2)
+    for _ in range(3):
+        fbo.clear(1.0, 1.0, 1.0, 1.0)
+        stream.capture()
+    stream.close()
+    os.close(write_fd)
+
+    with os.fdopen(read_fd, 'rb') as pipe:
+        assert pipe.read() == b'\xff' * 36
+
+    with pytest.raises(moderngl.Error):
+        stream.capture()
+
+    with pytest.raises(moderngl.Error):
+        ctx.simple_framebuffer((3, 3)).capture_stream(io.BytesIO(), format='yuv420p')
+
+
+def test_capture_release(ctx):
+    fbo = ctx.simple_framebuffer((4, 4))
+    stream = fbo.capture_stream(io.BytesIO())
+    stream.capture()
+    program = stream._program
+    thread = stream._thread
+
+    stream.release()
+    assert not thread.is_alive()
+    assert isinstance(program.mglo, moderngl.InvalidObject)
+
+    with pytest.raises(moderngl.Error):
+        stream.capture()
+
+    # an unclosed stream stops its writer thread when collected
+    stream = fbo.capture_stream(io.BytesIO())
+    thread = stream._thread
+    del stream
+    assert not thread.is_alive()
+
+
+def test_capture_keeps_bound_framebuffer(ctx, fullscreen_vao):
+    vao = fullscreen_vao('''
+        #version 330
+
+        out vec4 color;
+
+        void main() {
+            color = vec4(1.0);
+        }
+    ''')
+    fbo = ctx.simple_framebuffer((4, 4))
+    stream = fbo.capture_stream(io.BytesIO())
+
+    # the framebuffer bound when capturing is restored, not the one bound when the stream was created
+    target = ctx.simple_framebuffer((4, 4))
+    target.use()
+    target.clear()
+    stream.capture()
+    vao.render()
+    stream.close()
+
+    assert ctx.fbo is target
+    assert target.read(components=1) == b'\xff' * 16
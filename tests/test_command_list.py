@@ -0,0 +1,225 @@
+import struct
+
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def scene(ctx, fullscreen_vao):
+    program = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec2 in_vert;
+
+            void main() {
+                gl_Position = vec4(in_vert, 0.0, 1.0);
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            uniform float value;
+
+            layout (std140) uniform Block {
+                float block_value;
+            };
+
+            out vec4 color;
+
+            void main() {
+                color = vec4(value, block_value, 0.0, 1.0);
+            }
+        ''',
+    )
+    fbo = ctx.simple_framebuffer((4, 4))
+    vao = fullscreen_vao(program)
+    alignment = ctx.info['GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT']
+    ubo = ctx.buffer(reserve=alignment + 16)
+    ubo.write(struct.pack('f', 1.0))
+    program['Block'].binding = 1
+    return program, fbo, vao, ubo
+
+
+def test_record_and_execute(ctx, scene):
+    program, fbo, vao, ubo = scene
+
+    with ctx.record() as commands:
+        fbo.use()
+        fbo.clear()
+        value = program['value'].write(struct.pack('f', 1.0))
+        block = ubo.bind_to_uniform_block(1, size=16)
+        draw = vao.render()
+
+    assert len(commands) == 5
+    assert isinstance(draw, int)
+
+    # nothing was drawn while recording
+    fbo.clear(0.0, 0.0, 1.0, 1.0)
+    assert fbo.read(components=3)[:3] == b'\x00\x00\xff'
+
+    commands.execute()
+    assert fbo.read(components=3)[:3] == b'\xff\xff\x00'
+
+    commands.set_uniform(value, struct.pack('f', 0.5))
+    commands.set_buffer_offset(block, ctx.info['GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT'])
+    commands.execute()
+    assert fbo.read(components=3)[:3] == b'\x80\x00\x00'
+
+    commands.set_render(draw, vertices=0)
+    commands.execute()
+    assert fbo.read(components=3)[:3] == b'\x00\x00\x00'
+    commands.release()
+
+
+def test_record_scope(ctx, scene):
+    program, fbo, vao, ubo = scene
+    program['value'] = 1.0
+    scope = ctx.scope(fbo, uniform_buffers=[(ubo, 1)])
+
+    with ctx.record() as commands:
+        with scope:
+            fbo.clear()
+            vao.render(instances=0)
+
+    fbo.use()
+    fbo.clear(0.0, 0.0, 1.0, 1.0)
+    commands.execute()
+    assert fbo.read(components=3)[:3] == b'\x00\x00\x00'
+
+    commands.set_render(2, instances=1)
+    commands.execute()
+    assert fbo.read(components=3)[:3] == b'\xff\xff\x00'
+    commands.release()
+
+
+def test_record_errors(ctx, scene):
+    program, fbo, vao, ubo = scene
+
+    with ctx.record() as commands:
+        draw = vao.render()
+
+        with pytest.raises(moderngl.Error):
+            ctx.record()
+
+        with pytest.raises(moderngl.Error):
+            commands.execute()
+
+    with pytest.raises(moderngl.Error):
+        commands.set_uniform(draw, b'')
+
+    with pytest.raises(moderngl.Error):
+        commands.set_render(10)
+
+    vao.release()
+    with pytest.raises(moderngl.Error):
+        commands.execute()
+
+    commands.release()
+
+
+def test_record_parsed_commands(ctx, scene):
+    program, fbo, vao, ubo = scene
+    color = ctx.texture((4, 4), 4)
+    target = ctx.framebuffer([color])
+    sampler = ctx.sampler()
+
+    with ctx.record() as commands:
+        target.invalidate()
+        target.clear_attachments({0: (1.0, 0.0, 0.0, 1.0)})
+        target.clear(0.0, 1.0, 0.0, 1.0, viewport=(0, 0, 2, 2))
+        color.use(3)
+        sampler.use(3)
+
+        # arguments are validated while recording
+        with pytest.raises(moderngl.Error):
+            target.clear_attachments({1: (1.0, 0.0, 0.0, 1.0)})
+
+    assert len(commands) == 5
+    target.clear_attachments({0: (0.0, 0.0, 1.0, 1.0)})
+    commands.execute()
+    pixels = color.read()
+    assert pixels[:4] == b'\x00\xff\x00\xff'
+    assert pixels[-4:] == b'\xff\x00\x00\xff'
+    commands.release()
+
+
+def test_record_unrecordable_calls(ctx, scene):
+    program, fbo, vao, ubo = scene
+
+    with ctx.record() as commands:
+        with pytest.raises(moderngl.Error):
+            ctx.enable(moderngl.BLEND)
+
+        with pytest.raises(moderngl.Error):
+            ctx.blend_func = moderngl.ADDITIVE_BLENDING
+
+        with pytest.raises(moderngl.Error):
+            fbo.viewport = (0, 0, 2, 2)
+
+        with pytest.raises(moderngl.Error):
+            vao.render_indirect(ctx.buffer(reserve=16))
+
+    assert len(commands) == 0
+    commands.release()
+
+
+def test_record_uniform_keeps_program(ctx, scene):
+    program, fbo, vao, ubo = scene
+
+    with ctx.record() as commands:
+        program['value'].write(struct.pack('f', 1.0))
+
+    program.release()
+    with pytest.raises(moderngl.Error):
+        commands.execute()
+
+    commands.release()
+
+
+def test_record_compute_follows_reload(ctx):
+    if ctx.version_code < 430:
+        pytest.skip('compute shaders not supported')
+
+    ctx.includes['value'] = 'const float VALUE = 1.0;'
+    try:
+        compute_shader = ctx.compute_shader('''
+            #version 430
+
+            #include "value"
+
+            layout (local_size_x = 1) in;
+
+            layout (std430, binding = 1) buffer Output {
+                float result;
+            };
+
+            void main() {
+                result = VALUE;
+            }
+        ''')
+        buf = ctx.buffer(reserve=4)
+        buf.bind_to_storage_buffer(1)
+
+        with ctx.record() as commands:
+            compute_shader.run()
+
+        ctx.includes['value'] = 'const float VALUE = 2.0;'
+        assert ctx.reload_programs() == 1
+        commands.execute()
+        ctx.memory_barrier()
+        assert struct.unpack('f', buf.read()) == (2.0,)
+
+        compute_shader.release()
+        with pytest.raises(moderngl.Error):
+            commands.execute()
+
+        commands.release()
+    finally:
+        ctx.includes.clear()
+
+
+def test_collected_list_stops_recording(ctx_new):
+    ctx_new.gc_mode = None
+    ctx_new.record()
+    ctx_new.record().end()
@@ -0,0 +1,144 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def programs(ctx):
+    if ctx.version_code < 400:
+        pytest.skip('transform feedback objects require OpenGL 4.0')
+
+    step = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in float in_value;
+            out float vs_value;
+
+            void main() {
+                vs_value = in_value + 1.0;
+            }
+        ''',
+        geometry_shader='''
+            #version 330
+
+            layout (points) in;
+            layout (points, max_vertices = 1) out;
+
+            in float vs_value[];
+            out float out_value;
+
+            void main() {
+                // particles die once their value reaches the limit
+                if (vs_value[0] < 4.0) {
+                    out_value = vs_value[0];
+                    EmitVertex();
+                    EndPrimitive();
+                }
+            }
+        ''',
+        varyings=['out_value'],
+    )
+    draw = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in float in_value;
+
+            void main() {
+                gl_Position = vec4(-0.75 + 0.5 * float(gl_VertexID), in_value / 16.0 - 0.75, 0.0, 1.0);
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            out vec4 color;
+
+            void main() {
+                color = vec4(1.0);
+            }
+        ''',
+    )
+    return step, draw
+
+
+def test_feedback_loop_step(ctx, programs):
+    step, _ = programs
+    first = ctx.buffer(np.array([0.0, 1.0, 2.0, 3.0], dtype='f4'))
+    second = ctx.buffer(reserve=16)
+
+    loop = ctx.feedback_loop(step, (first, second), 'f', 'in_value')
+    assert loop.current is first
+    assert loop.previous is second
+
+    loop.step()
+    assert loop.current is second
+    np.testing.assert_array_equal(np.frombuffer(second.read(12), dtype='f4'), [1.0, 2.0, 3.0])
+
+    # the surviving vertex count never leaves the GPU
+    loop.step(2)
+    assert loop.current is second
+    assert np.frombuffer(second.read(4), dtype='f4')[0] == 3.0
+
+    # the last step writing each buffer is counted
+    assert loop.feedbacks[0].primitives_written(wait=True) == 1
+    assert loop.feedbacks[1].primitives_written(wait=True) == 2
+    loop.release()
+
+
+def test_feedback_loop_render_current(ctx, programs):
+    step, draw = programs
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    first = ctx.buffer(np.array([0.0, 1.0, 2.0, 3.0], dtype='f4'))
+    second = ctx.buffer(reserve=16)
+    loop = ctx.feedback_loop(step, (first, second), 'f', 'in_value')
+    vao = ctx.vertex_array(draw, [(first, 'f', 'in_value')])
+
+    fbo.clear()
+    loop.render_current(vao, moderngl.POINTS)
+    assert np.count_nonzero(np.frombuffer(fbo.read(components=1), dtype='u1')) == 4
+
+    loop.step()
+    fbo.clear()
+    loop.render_current(vao, moderngl.POINTS)
+    assert np.count_nonzero(np.frombuffer(fbo.read(components=1), dtype='u1')) == 3
+
+    loop.step()
+    fbo.clear()
+    loop.render_current(vao, moderngl.POINTS)
+    assert np.count_nonzero(np.frombuffer(fbo.read(components=1), dtype='u1')) == 2
+
+    # the vertex array passed in keeps its own buffer
+    fbo.clear()
+    vao.render(moderngl.POINTS)
+    assert np.count_nonzero(np.frombuffer(fbo.read(components=1), dtype='u1')) == 4
+
+    with pytest.raises(moderngl.Error):
+        loop.render_current(vao, moderngl.POINTS, binding=1)
+    loop.release()
+
+
+def test_feedback_loop_errors(ctx, programs):
+    step, draw = programs
+    first = ctx.buffer(reserve=16)
+    second = ctx.buffer(reserve=16)
+
+    with pytest.raises(moderngl.Error):
+        ctx.feedback_loop(draw, (first, second), 'f', 'in_value')
+
+    loop = ctx.feedback_loop(step, (first, second), 'f', 'in_value')
+    output = ctx.buffer(reserve=16)
+    feedback = ctx.transform_feedback([output])
+    ctx.vertex_array(step, [(first, 'f', 'in_value')]).transform(feedback)
+
+    with pytest.raises(moderngl.Error):
+        loop.step()
+
+    feedback.end()
+    loop.step()
+
+    with pytest.raises(moderngl.Error):
+        loop.step(-1)
+
+    loop.release()
@@ -0,0 +1,52 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def fbo(ctx):
+    color = ctx.texture((4, 4), 4)
+    ids = ctx.texture((4, 4), 1, dtype='i4')
+    flags = ctx.texture((4, 4), 1, dtype='u4')
+    depth = ctx.depth_texture((4, 4))
+    return ctx.framebuffer([color, ids, flags], depth)
+
+
+def read(fbo, attachment, components, dtype):
+    data = fbo.read(components=components, attachment=attachment, dtype=dtype)
+    return np.frombuffer(data, dtype='u1' if dtype == 'f1' else dtype)
+
+
+def test_clear_attachments(ctx, fbo):
+    fbo.clear_attachments({0: (0.0, 0.5, 1.0, 1.0), 1: (-1,), 2: (4000000000,), 'depth': 0.25, 'stencil': 0})
+
+    np.testing.assert_array_equal(read(fbo, 0, 4, 'f1').reshape(-1, 4), [[0, 128, 255, 255]] * 16)
+    np.testing.assert_array_equal(read(fbo, 1, 1, 'i4'), [-1] * 16)
+    np.testing.assert_array_equal(read(fbo, 2, 1, 'u4'), [4000000000] * 16)
+    np.testing.assert_allclose(read(fbo, -1, 1, 'f4'), [0.25] * 16, atol=1e-6)
+
+
+def test_clear_attachments_keeps_others(ctx, fbo):
+    fbo.clear_attachments({0: (1.0, 1.0, 1.0, 1.0), 1: (7,), 'depth': 1.0})
+    fbo.clear_attachments({1: (3,)})
+
+    np.testing.assert_array_equal(read(fbo, 0, 4, 'f1'), [255] * 64)
+    np.testing.assert_array_equal(read(fbo, 1, 1, 'i4'), [3] * 16)
+    np.testing.assert_allclose(read(fbo, -1, 1, 'f4'), [1.0] * 16)
+
+
+def test_clear_attachments_scissor(ctx, fbo):
+    fbo.clear_attachments({1: (0,)})
+    fbo.scissor = (0, 0, 2, 2)
+    fbo.clear_attachments({1: (5,)})
+    fbo.scissor = None
+
+    assert np.count_nonzero(read(fbo, 1, 1, 'i4') == 5) == 4
+
+
+def test_clear_attachments_errors(ctx, fbo):
+    with pytest.raises(moderngl.Error):
+        fbo.clear_attachments({3: (0.0,)})
+
+    with pytest.raises(moderngl.Error):
+        fbo.clear_attachments({0: (0.0, 0.0, 0.0, 0.0, 0.0)})
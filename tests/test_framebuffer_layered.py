@@ -0,0 +1,117 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def vao(ctx, fullscreen_vao):
+    program = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec2 in_vert;
+
+            void main() {
+                gl_Position = vec4(in_vert, 0.0, 1.0);
+            }
+        ''',
+        geometry_shader='''
+            #version 330
+
+            layout (triangles) in;
+            layout (triangle_strip, max_vertices = 18) out;
+
+            uniform int layers;
+
+            flat out int v_layer;
+
+            void main() {
+                for (int layer = 0; layer < layers; ++layer) {
+                    for (int i = 0; i < 3; ++i) {
+                        gl_Layer = layer;
+                        v_layer = layer;
+                        gl_Position = gl_in[i].gl_Position;
+                        EmitVertex();
+                    }
+                    EndPrimitive();
+                }
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            flat in int v_layer;
+            out vec4 color;
+
+            void main() {
+                color = vec4(float(v_layer + 1) / 255.0, 0.0, 0.0, 1.0);
+            }
+        ''',
+    )
+    return fullscreen_vao(program)
+
+
+def red(data, layers):
+    return np.frombuffer(data, dtype='u1').reshape(layers, -1, 4)[:, :, 0]
+
+
+def test_layered_texture_array(ctx, vao):
+    array = ctx.texture_array((4, 4, 3), 4)
+    fbo = ctx.framebuffer(array)
+    fbo.use()
+    fbo.clear()
+
+    vao.program['layers'] = 3
+    vao.render()
+
+    np.testing.assert_array_equal(red(array.read(), 3), [[1] * 16, [2] * 16, [3] * 16])
+
+
+def test_layered_cube_map(ctx, vao):
+    cube = ctx.texture_cube((4, 4), 4)
+    fbo = ctx.framebuffer(cube, ctx.depth_texture_cube((4, 4)))
+    fbo.use()
+    fbo.clear()
+
+    vao.program['layers'] = 6
+    vao.render()
+
+    for face in range(6):
+        assert set(red(cube.read(face), 1).flatten()) == {face + 1}
+
+
+def test_single_layer(ctx, vao):
+    array = ctx.texture_array((4, 4, 3), 4)
+    volume = ctx.texture3d((4, 4, 2), 4)
+    cube = ctx.texture_cube((4, 4), 4)
+
+    ctx.framebuffer((array, 1)).clear(color=(1.0, 1.0, 1.0, 1.0))
+    np.testing.assert_array_equal(red(array.read(), 3), [[0] * 16, [255] * 16, [0] * 16])
+
+    ctx.framebuffer([(volume, 1)]).clear(color=(1.0, 1.0, 1.0, 1.0))
+    np.testing.assert_array_equal(red(volume.read(), 2), [[0] * 16, [255] * 16])
+
+    fbo = ctx.framebuffer([(cube, 4)], (ctx.depth_texture_cube((4, 4)), 4))
+    fbo.use()
+    fbo.clear()
+    vao.program['layers'] = 1
+    vao.render()
+    assert set(red(cube.read(4), 1).flatten()) == {1}
+    assert set(red(cube.read(0), 1).flatten()) == {0}
+
+
+def test_layered_errors(ctx):
+    array = ctx.texture_array((4, 4, 3), 4)
+
+    with pytest.raises(moderngl.Error):
+        ctx.framebuffer((array, 3))
+
+    with pytest.raises(moderngl.Error):
+        ctx.framebuffer((ctx.texture((4, 4), 4), 0))
+
+    with pytest.raises(moderngl.Error):
+        ctx.framebuffer((ctx.texture_cube((4, 4), 4), 6))
+
+    # layered and single layer attachments cannot be mixed
+    with pytest.raises(moderngl.Error):
+        ctx.framebuffer([array, ctx.texture((4, 4), 4)])
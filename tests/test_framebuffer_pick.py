@@ -0,0 +1,54 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def fbo(ctx):
+    color = ctx.texture((8, 8), 4)
+    ids = ctx.texture((8, 8), 1, dtype='u4')
+    depth = ctx.depth_texture((8, 8))
+
+    y, x = np.mgrid[0:8, 0:8]
+    color.write(np.stack([x * 16, y * 16, np.zeros_like(x), np.full_like(x, 255)], axis=-1).astype('u1'))
+    ids.write((y * 8 + x).astype('u4'))
+    depth.write((x / 8.0).astype('f4'))
+    return ctx.framebuffer([color, ids], depth)
+
+
+def test_pick_points(ctx, fbo):
+    points = [(0, 0), (3, 5), (7, 7), (3, 5)]
+    ids = np.frombuffer(fbo.pick(points, attachment=1), dtype='u4')
+    np.testing.assert_array_equal(ids, [0, 43, 63, 43])
+
+    colors = np.frombuffer(fbo.pick(points), dtype='u1').reshape(-1, 4)
+    np.testing.assert_array_equal(colors[1], [48, 80, 0, 255])
+
+    rgb = np.frombuffer(fbo.pick([(2, 1)], components=3), dtype='u1')
+    np.testing.assert_array_equal(rgb, [32, 16, 0])
+
+
+def test_pick_rects(ctx, fbo):
+    ids = np.frombuffer(fbo.pick([(1, 1, 2, 2), (6, 0)], attachment=1), dtype='u4')
+    np.testing.assert_array_equal(ids, [9, 10, 17, 18, 6])
+
+
+def test_pick_depth(ctx, fbo):
+    depth = np.frombuffer(fbo.pick([(4, 2), (6, 6)], attachment='depth'), dtype='f4')
+    np.testing.assert_allclose(depth, [0.5, 0.75], atol=1e-6)
+
+
+def test_pick_errors(ctx, fbo):
+    assert fbo.pick([]) == b''
+
+    with pytest.raises(moderngl.Error):
+        fbo.pick([(0, 0, 0, 1)])
+
+    with pytest.raises(moderngl.Error):
+        fbo.pick([(0, 0)], components=5)
+
+    with pytest.raises(moderngl.Error):
+        fbo.pick([(0, 0)], attachment=2)
+
+    with pytest.raises(moderngl.Error):
+        fbo.pick([(0, 0)], attachment='stencil')
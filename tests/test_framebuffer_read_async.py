@@ -0,0 +1,74 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+def test_read_async(ctx):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.clear(1.0, 0.5, 0.0, 1.0)
+
+    pending = fbo.read_async(components=4)
+    assert pending.size == 64
+    assert pending.wait()
+    assert pending.done
+    assert pending.read() == fbo.read(components=4)
+
+    data = np.zeros((4, 4, 4), dtype='u1')
+    pending.read_into(data)
+    assert tuple(data[0, 0]) == (255, 128, 0, 255)
+
+
+def test_read_async_options(ctx):
+    fbo = ctx.framebuffer(
+        color_attachments=[ctx.texture((4, 4), 4, dtype='f4'), ctx.texture((4, 4), 1, dtype='f4')],
+        depth_attachment=ctx.depth_texture((4, 4)),
+    )
+    fbo.use()
+    fbo.clear(0.25, 0.0, 0.0, 1.0, depth=0.5)
+
+    pending = fbo.read_async((1, 1, 2, 2), components=1, dtype='f4')
+    np.testing.assert_array_equal(np.frombuffer(pending.read(), dtype='f4'), [0.25] * 4)
+
+    pending = fbo.read_async((2, 2), attachment=-1, dtype='f4')
+    np.testing.assert_allclose(np.frombuffer(pending.read(), dtype='f4'), [0.5] * 4, atol=1e-6)
+
+    out = bytearray(20)
+    fbo.read_async((2, 2), components=1, attachment=1, dtype='f4').read_into(out, write_offset=4)
+    assert out[:4] == b'\x00' * 4
+
+
+def test_read_async_ring(ctx):
+    fbo = ctx.simple_framebuffer((2, 2))
+    frames = []
+
+    for i in range(3):
+        fbo.clear(i / 255.0, 0.0, 0.0, 0.0)
+        frames.append(fbo.read_async(components=1, buffers=2))
+
+    # the first frame was overwritten by the third one
+    with pytest.raises(moderngl.Error):
+        frames[0].read()
+
+    assert frames[1].read() == b'\x01' * 4
+    assert frames[2].read() == b'\x02' * 4
+    assert frames[2].mglo is frames[0].mglo
+
+    with pytest.raises(moderngl.Error):
+        frames[2].read_into(bytearray(3))
+
+    fbo.release()
+
+
+def test_read_async_released(ctx):
+    fbo = ctx.simple_framebuffer((2, 2))
+    pending = fbo.read_async(components=1)
+    fbo.release()
+
+    with pytest.raises(moderngl.Error):
+        pending.done
+
+    with pytest.raises(moderngl.Error):
+        pending.wait()
+
+    with pytest.raises(moderngl.Error):
+        pending.read()
@@ -0,0 +1,58 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def fbo(ctx):
+    fbo = ctx.framebuffer([ctx.texture((4, 2), 4, dtype='f4')])
+    fbo.use()
+    fbo.clear(1.0, 0.5, 0.25, 1.0)
+    fbo.scissor = (0, 1, 4, 1)
+    fbo.clear(2.0, -1.0, 0.0, 0.5)
+    fbo.scissor = None
+    return fbo
+
+
+def test_read_flip_swizzle(fbo):
+    reference = np.frombuffer(fbo.read(components=4, dtype='f4'), dtype='f4').reshape(2, 4, 4)
+
+    data = np.frombuffer(fbo.read(components=4, dtype='f4', flip_y=True, swizzle='bgr'), dtype='f4').reshape(2, 4, 3)
+    np.testing.assert_array_equal(data, reference[::-1, :, [2, 1, 0]])
+
+    data = np.frombuffer(fbo.read(components=4, dtype='f4', flip_y=True), dtype='f4').reshape(2, 4, 4)
+    np.testing.assert_array_equal(data, reference[::-1])
+
+    data = np.frombuffer(fbo.read(components=4, dtype='f4', out_components=2), dtype='f4').reshape(2, 4, 2)
+    np.testing.assert_array_equal(data, reference[:, :, :2])
+
+
+def test_read_out_dtype(fbo):
+    data = np.frombuffer(fbo.read(components=4, dtype='f4', out_dtype='f1', swizzle='rgba'), dtype='u1').reshape(2, 4, 4)
+    assert tuple(data[0, 0]) == (255, 128, 64, 255)
+
+    # values outside of [0.0, 1.0] are clamped
+    assert tuple(data[1, 0]) == (255, 0, 0, 128)
+
+    data = np.frombuffer(fbo.read(components=3, out_dtype='f4', flip_y=True), dtype='f4').reshape(2, 4, 3)
+    np.testing.assert_allclose(data[1, 0], [1.0, 128 / 255, 64 / 255])
+
+
+def test_read_into_conversion(fbo):
+    out = np.zeros((2, 4, 3), dtype='u1')
+    assert fbo.read_into(out, components=4, dtype='f4', out_dtype='f1', swizzle='bgr', flip_y=True) == 24
+    assert tuple(out[1, 3]) == (64, 128, 255)
+
+    # output rows are padded to the alignment
+    out = bytearray(16)
+    fbo.read_into(out, (0, 0, 1, 2), components=4, alignment=4, swizzle='a')
+    assert out[0] == 255 and out[4] == 128
+
+    with pytest.raises(moderngl.Error):
+        fbo.read(components=3, swizzle='rgba')
+
+    with pytest.raises(moderngl.Error):
+        fbo.read(components=4, swizzle='rgb', out_components=2)
+
+    with pytest.raises(moderngl.Error):
+        fbo.read(components=4, dtype='u2', flip_y=True)
@@ -0,0 +1,123 @@
+import ctypes
+import ctypes.util
+
+import numpy as np
+import pytest
+
+
+@pytest.fixture
+def vao(fullscreen_vao):
+    return fullscreen_vao('''
+        #version 330
+
+        layout (location = 0) out vec4 color0;
+        layout (location = 1) out vec4 color1;
+
+        void main() {
+            color0 = vec4(1.0);
+            color1 = vec4(1.0);
+        }
+    ''')
+
+
+def lit_pixels(fbo, attachment=0):
+    data = np.frombuffer(fbo.read(components=1, attachment=attachment), dtype='u1').reshape(fbo.height, fbo.width)
+    return int(np.count_nonzero(data))
+
+
+def test_clear_keeps_bound_framebuffer(ctx, vao):
+    target = ctx.simple_framebuffer((4, 4))
+    other = ctx.simple_framebuffer((4, 4))
+    target.use()
+    target.clear()
+
+    # clearing another framebuffer does not change where the next draw goes
+    other.clear(0.0, 0.0, 0.0, 0.0)
+    vao.render()
+    assert lit_pixels(target) == 16
+    assert lit_pixels(other) == 0
+    assert ctx.fbo is target
+
+
+def test_clear_viewport_restores_scissor(ctx, vao):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    fbo.clear(1.0, 1.0, 1.0, 1.0)
+    fbo.clear(viewport=(0, 0, 2, 2))
+    assert lit_pixels(fbo) == 12
+
+    vao.render()
+    assert lit_pixels(fbo) == 16
+
+    fbo.scissor = (0, 0, 1, 1)
+    fbo.clear()
+    assert lit_pixels(fbo) == 15
+    fbo.scissor = None
+
+
+def test_viewport_and_masks(ctx, vao):
+    textures = [ctx.texture((4, 4), 4) for _ in range(2)]
+    fbo = ctx.framebuffer(textures)
+    fbo.use()
+    fbo.clear()
+
+    fbo.viewport = (0, 0, 2, 2)
+    vao.render()
+    assert lit_pixels(fbo, 0) == 4
+    assert lit_pixels(fbo, 1) == 4
+
+    fbo.viewport = (0, 0, 4, 4)
+    fbo.color_mask = ((True, True, True, True), (False, False, False, False))
+    fbo.clear()
+    vao.render()
+    assert lit_pixels(fbo, 0) == 16
+    assert lit_pixels(fbo, 1) == 4
+
+    # the state of another framebuffer does not leak into this one
+    other = ctx.simple_framebuffer((2, 2))
+    other.use()
+    fbo.use()
+    fbo.color_mask = ((True, True, True, True), (True, True, True, True))
+    vao.render()
+    assert lit_pixels(fbo, 1) == 16
+
+
+def test_reset_framebuffer_state(ctx, vao):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    fbo.clear()
+    ctx.reset_framebuffer_state()
+    vao.render()
+    assert lit_pixels(fbo) == 16
+
+
+def test_clear_viewport_does_not_scissor_copies(ctx):
+    src = ctx.simple_framebuffer((4, 4))
+    dst = ctx.simple_framebuffer((4, 4))
+    src.clear(1.0, 1.0, 1.0, 1.0)
+    dst.clear()
+
+    # the scissor left by the partial clear does not limit the blit
+    src.clear(1.0, 1.0, 1.0, 1.0, viewport=(0, 0, 1, 1))
+    ctx.copy_framebuffer(dst, src)
+    assert lit_pixels(dst) == 16
+
+
+def test_detected_framebuffer_use_applies_full_state(ctx, vao):
+    try:
+        gl = ctypes.CDLL(ctypes.util.find_library('GL') or 'libGL.so.1')
+    except OSError:
+        pytest.skip('raw OpenGL calls are not available')
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    detected = ctx.detect_framebuffer(fbo.glo)
+    detected.use()
+    detected.clear()
+
+    # another library changes the binding and the viewport
+    gl.glBindFramebuffer(0x8D40, 0)
+    gl.glViewport(0, 0, 1, 1)
+
+    detected.use()
+    vao.render()
+    assert lit_pixels(fbo) == 16
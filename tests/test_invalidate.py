@@ -0,0 +1,62 @@
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def vao(fullscreen_vao):
+    return fullscreen_vao('''
+        #version 330
+
+        out vec4 color;
+
+        void main() {
+            color = vec4(1.0);
+        }
+    ''')
+
+
+def test_framebuffer_invalidate(ctx):
+    fbo = ctx.framebuffer([ctx.texture((4, 4), 4), ctx.texture((4, 4), 4)], ctx.depth_texture((4, 4)))
+    fbo.invalidate()
+    fbo.invalidate(['depth', 'stencil'])
+    fbo.invalidate([1], viewport=(0, 0, 2, 2))
+
+    # the attachments that were not invalidated keep their contents
+    fbo.clear(1.0, 1.0, 1.0, 1.0)
+    fbo.invalidate([1, 'depth'])
+    assert fbo.read(components=4) == b'\xff' * 64
+
+    # invalidated attachments can be rendered to again
+    fbo.clear(0.0, 0.0, 1.0, 1.0)
+    assert fbo.read(components=4, attachment=1) == b'\x00\x00\xff\xff' * 16
+
+    with pytest.raises(moderngl.Error):
+        fbo.invalidate([2])
+
+    with pytest.raises(moderngl.Error):
+        fbo.invalidate(['color'])
+
+
+def test_scope_discard_on_end(ctx, vao):
+    fbo = ctx.simple_framebuffer((4, 4))
+    scope = ctx.scope(fbo, moderngl.DEPTH_TEST, discard_on_end=['depth'])
+
+    with scope:
+        fbo.clear()
+        vao.render()
+
+    # only the depth attachment was invalidated
+    assert fbo.read(components=1) == b'\xff' * 16
+
+    with pytest.raises(moderngl.Error):
+        ctx.scope(fbo, discard_on_end=[1])
+
+
+def test_texture_invalidate(ctx):
+    texture = ctx.texture((4, 4), 4)
+    texture.invalidate()
+    texture.write(b'\x80' * 64)
+    assert texture.read() == b'\x80' * 64
+
+    with pytest.raises(moderngl.Error):
+        texture.invalidate(level=1)
@@ -0,0 +1,108 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def program(ctx):
+    return ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec2 in_vert;
+            in vec2 in_offset;
+
+            void main() {
+                gl_Position = vec4(in_vert + in_offset, 0.0, 1.0);
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            out vec4 color;
+
+            void main() {
+                color = vec4(1.0);
+            }
+        ''',
+    )
+
+
+def pixel_center(x, y):
+    return -1.0 + (x + 0.5) / 2.0, -1.0 + (y + 0.5) / 2.0
+
+
+def lit_pixels(fbo):
+    data = np.frombuffer(fbo.read(components=1), dtype='u1').reshape(4, 4)
+    return {(x, y) for y, x in zip(*np.nonzero(data))}
+
+
+def test_mesh_pool_render(ctx, program):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    offsets = ctx.buffer(np.zeros((2, 2), dtype='f4'))
+
+    # a tiny pool forces both buffers to grow while meshes are added
+    pool = ctx.mesh_pool(program, '2f', 'in_vert', vertices=1, indices=1, content=[(offsets, '2f/i', 'in_offset')], mode=moderngl.POINTS)
+    first = pool.add(np.array([pixel_center(0, 0), pixel_center(1, 0)], dtype='f4'), np.array([0, 1], dtype='i4'))
+    second = pool.add(np.array([pixel_center(2, 2), pixel_center(3, 3)], dtype='f4'), np.array([1], dtype='i4'))
+
+    assert first == (0, 2, 0)
+    assert second == (2, 1, 2)
+    assert pool.num_vertices == 4
+    assert pool.num_indices == 3
+    assert pool.vertex_buffer.size >= 32
+
+    fbo.clear()
+    pool.render(first)
+    assert lit_pixels(fbo) == {(0, 0), (1, 0)}
+
+    fbo.clear()
+    pool.render(second)
+    assert lit_pixels(fbo) == {(3, 3)}
+    pool.release()
+
+
+def test_mesh_pool_growth_releases_previous_objects(ctx, program):
+    pool = ctx.mesh_pool(program, '2f', 'in_vert', vertices=1, indices=1)
+    vertex_array, vertex_buffer, index_buffer = pool.vertex_array, pool.vertex_buffer, pool.index_buffer
+    pool.add(np.zeros((4, 2), dtype='f4'), np.zeros(4, dtype='i4'))
+
+    assert pool.vertex_array is not vertex_array
+    assert isinstance(vertex_array.mglo, moderngl.InvalidObject)
+    assert isinstance(vertex_buffer.mglo, moderngl.InvalidObject)
+    assert isinstance(index_buffer.mglo, moderngl.InvalidObject)
+    pool.release()
+
+
+def test_mesh_pool_base_instance(ctx, program):
+    if ctx.version_code < 420:
+        pytest.skip('base instance requires OpenGL 4.2')
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    offsets = ctx.buffer(np.array([(0.0, 0.0), (0.0, 0.5), (0.0, 1.0)], dtype='f4'))
+    pool = ctx.mesh_pool(program, '2f', 'in_vert', content=[(offsets, '2f/i', 'in_offset')], mode=moderngl.POINTS)
+    mesh = pool.add(np.array([pixel_center(1, 0)], dtype='f4'), np.array([0], dtype='i4'))
+
+    fbo.clear()
+    pool.render(mesh, instances=2, base_instance=1)
+    assert lit_pixels(fbo) == {(1, 1), (1, 2)}
+    pool.release()
+
+
+def test_mesh_pool_errors(ctx, program):
+    offsets = ctx.buffer(np.zeros(2, dtype='f4'))
+    pool = ctx.mesh_pool(program, '2f', 'in_vert', content=[(offsets, '2f/i', 'in_offset')])
+
+    with pytest.raises(moderngl.Error):
+        pool.add(np.zeros(3, dtype='f4'), np.array([0], dtype='i4'))
+
+    with pytest.raises(moderngl.Error):
+        pool.add(np.zeros(2, dtype='f4'), np.array([0], dtype='i2'))
+
+    vbo = ctx.buffer(np.zeros(2, dtype='f4'))
+    vao = ctx.vertex_array(program, [(vbo, '2f', 'in_vert'), (offsets, '2f/i', 'in_offset')])
+    with pytest.raises(moderngl.Error):
+        vao.render_base_vertex(moderngl.POINTS, 1, base_vertex=1)
+    pool.release()
@@ -0,0 +1,86 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def capture(ctx):
+    program = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec4 in_value;
+            out vec4 out_value;
+
+            void main() {
+                out_value = in_value;
+            }
+        ''',
+        varyings=['out_value'],
+    )
+
+    def capture(data, fmt, vertices=1):
+        vbo = ctx.buffer(data)
+        output = ctx.buffer(reserve=vertices * 16)
+        vao = ctx.vertex_array(program, [(vbo, fmt, 'in_value')])
+        vao.transform(output, vertices=vertices)
+        return np.frombuffer(output.read(), dtype='f4').reshape(vertices, 4)
+
+    return capture
+
+
+def test_format_sizes(ctx):
+    assert ctx.vertex_format('3ni2 x2').stride == 8
+    assert ctx.vertex_format('4nu1').stride == 4
+    assert ctx.vertex_format('3f ni10 f11').stride == 20
+    assert ctx.vertex_format('4i10 4nu10/i').attributes == 2
+
+    for fmt in ('3i10', '4f11', 'nf', 'nni2', 'n', 'f111'):
+        with pytest.raises(moderngl.Error):
+            ctx.vertex_format(fmt)
+
+
+def test_quantize():
+    data = np.array([0.0, 0.5, 1.0, -1.0], dtype='f4')
+    assert moderngl.quantize(data, '4nu1') == bytes([0, 128, 255, 0])
+    assert moderngl.quantize(data, '4ni1') == bytes([0, 64, 127, 129])
+    assert moderngl.quantize(data, '2f2') == np.array([0.0, 0.5, 1.0, -1.0], dtype='f2').tobytes()
+    assert moderngl.quantize(np.array([1.0, 2.0, 3.0], dtype='f4'), '2f x2 i2') == np.array([1.0, 2.0], dtype='f4').tobytes() + b'\x00\x00\x03\x00'
+
+    with pytest.raises(moderngl.Error):
+        moderngl.quantize(np.array([1.0, 2.0], dtype='f4'), '3f')
+
+    with pytest.raises(moderngl.Error):
+        moderngl.quantize(np.array([1, 2, 3], dtype='i4'), '3f')
+
+
+def test_normalized_integers(ctx, capture):
+    values = np.array([[1.0, -1.0, 0.5, 0.0], [0.25, 1.0, 0.0, 1.0]], dtype='f4')
+
+    for fmt, tolerance in (('4ni1', 1 / 127), ('4ni2', 1 / 32767), ('4nu2', 1 / 65535)):
+        expected = values if 'ni' in fmt else np.clip(values, 0.0, 1.0)
+        result = capture(moderngl.quantize(values, fmt), fmt, vertices=2)
+        np.testing.assert_allclose(result, expected, atol=tolerance)
+
+
+def test_packed_10_10_10_2(ctx, capture):
+    values = np.array([0.5, -1.0, 1.0, 1.0], dtype='f4')
+    result = capture(moderngl.quantize(values, 'ni10'), 'ni10')
+    np.testing.assert_allclose(result[0], values, atol=1 / 511)
+
+    values = np.array([0.25, 0.0, 1.0, 2.0 / 3.0], dtype='f4')
+    result = capture(moderngl.quantize(values, 'nu10'), 'nu10')
+    np.testing.assert_allclose(result[0], values, atol=1 / 1023)
+
+    values = np.array([100.0, 3.0, -7.0, 1.0], dtype='f4')
+    result = capture(moderngl.quantize(values, 'i10'), 'i10')
+    np.testing.assert_allclose(result[0], values)
+
+
+def test_packed_11_11_10(ctx, capture):
+    if ctx.version_code < 440:
+        pytest.skip('f11 vertex attributes require OpenGL 4.4')
+
+    values = np.array([1.0, 0.375, 96.0], dtype='f4')
+    result = capture(moderngl.quantize(values, 'f11'), 'f11')
+    np.testing.assert_allclose(result[0], [1.0, 0.375, 96.0, 1.0])
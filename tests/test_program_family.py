@@ -0,0 +1,132 @@
+import pytest
+import moderngl
+
+VERTEX_SHADER = '''
+    #version 330
+
+    in vec2 in_vert;
+
+    void main() {
+        gl_Position = vec4(in_vert, 0.0, 1.0);
+    }
+'''
+
+FRAGMENT_SHADER = '''
+    #version 330
+
+    out vec4 color;
+
+    void main() {
+    #ifdef SHADOWS
+        color = vec4(0.5, 0.0, 0.0, 1.0);
+    #else
+        color = vec4(float(NUM_LIGHTS) / 255.0, 0.0, 0.0, 1.0);
+    #endif
+    }
+'''
+
+
+def family(ctx, **kwargs):
+    return ctx.program_family(
+        {'vertex_shader': VERTEX_SHADER, 'fragment_shader': FRAGMENT_SHADER},
+        {'SHADOWS': (False, True), 'NUM_LIGHTS': range(1, 5)},
+        **kwargs,
+    )
+
+
+def test_program_family_lazy(ctx):
+    programs = family(ctx)
+    assert len(programs) == 0
+    assert programs.defines == {'SHADOWS': False, 'NUM_LIGHTS': 1}
+
+    default = programs.get()
+    assert isinstance(default, moderngl.Program)
+    assert len(programs) == 1
+
+    assert programs.get(SHADOWS=False) is default
+    assert programs[{'NUM_LIGHTS': 1}] is default
+    assert programs.get(SHADOWS=True) is not default
+    assert {'SHADOWS': True} in programs
+    assert len(programs) == 2
+    programs.release()
+
+
+def test_program_family_shares_shaders(ctx):
+    ctx.clear_shader_cache()
+    programs = family(ctx)
+    programs.get(SHADOWS=True, NUM_LIGHTS=1)
+    programs.get(SHADOWS=True, NUM_LIGHTS=2)
+    programs.get(SHADOWS=False, NUM_LIGHTS=3)
+
+    # the vertex shader does not use any define and is compiled once
+    assert ctx.shader_cache_stats == {'size': 4, 'hits': 2, 'misses': 4}
+    programs.release()
+    assert ctx.shader_cache_stats['size'] == 0
+
+
+def test_program_family_lru(ctx):
+    ctx.clear_shader_cache()
+    programs = family(ctx, cache_size=2)
+    first = programs.get(NUM_LIGHTS=1)
+    evicted = programs.get(NUM_LIGHTS=2)
+    programs.get(NUM_LIGHTS=1)
+    programs.get(NUM_LIGHTS=3)
+
+    assert len(programs) == 2
+    assert programs.variants == ({'SHADOWS': False, 'NUM_LIGHTS': 1}, {'SHADOWS': False, 'NUM_LIGHTS': 3})
+    assert programs.get(NUM_LIGHTS=1) is first
+
+    # the evicted variant is only dropped from the cache
+    assert not isinstance(evicted.mglo, moderngl.InvalidObject)
+    assert ctx.shader_cache_stats['size'] == 4
+
+    # and released its fragment shader once nobody uses it
+    del evicted
+    assert ctx.shader_cache_stats['size'] == 3
+    programs.release()
+
+
+def test_program_family_render(ctx):
+    programs = family(ctx)
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    vbo = ctx.buffer(b'\x00\x00\x80\xbf\x00\x00\x80\xbf\x00\x00\x40\x40\x00\x00\x80\xbf\x00\x00\x80\xbf\x00\x00\x40\x40')
+
+    for lights in (1, 3):
+        vao = ctx.vertex_array(programs.get(NUM_LIGHTS=lights), [(vbo, '2f', 'in_vert')])
+        fbo.clear()
+        vao.render()
+        assert fbo.read(components=1)[0] == lights
+
+    programs.release()
+
+
+def test_program_family_version_after_comment(ctx):
+    programs = ctx.program_family(
+        {
+            'vertex_shader': '// shared vertex shader\n' + VERTEX_SHADER,
+            'fragment_shader': '/* lighting */\n' + FRAGMENT_SHADER,
+        },
+        {'SHADOWS': (False, True), 'NUM_LIGHTS': range(1, 5)},
+    )
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    vbo = ctx.buffer(b'\x00\x00\x80\xbf\x00\x00\x80\xbf\x00\x00\x40\x40\x00\x00\x80\xbf\x00\x00\x80\xbf\x00\x00\x40\x40')
+    vao = ctx.vertex_array(programs.get(NUM_LIGHTS=2), [(vbo, '2f', 'in_vert')])
+    fbo.clear()
+    vao.render()
+    assert fbo.read(components=1)[0] == 2
+    programs.release()
+
+
+def test_program_family_errors(ctx):
+    programs = family(ctx)
+
+    with pytest.raises(KeyError):
+        programs.get(SKINNING=True)
+
+    with pytest.raises(ValueError):
+        programs.get(NUM_LIGHTS=8)
+
+    with pytest.raises(ValueError):
+        ctx.program_family({'compute_shader': ''})
@@ -0,0 +1,119 @@
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def stages(ctx):
+    if ctx.version_code < 410:
+        pytest.skip('separable programs require OpenGL 4.1')
+
+    vertex = ctx.shader_stage('vertex', '''
+        #version 410
+
+        out gl_PerVertex {
+            vec4 gl_Position;
+        };
+
+        in vec2 in_vert;
+        layout (location = 0) out float v_value;
+
+        uniform float scale;
+
+        void main() {
+            gl_Position = vec4(in_vert, 0.0, 1.0);
+            v_value = scale;
+        }
+    ''')
+
+    red = ctx.shader_stage('fragment', '''
+        #version 410
+
+        layout (location = 0) in float v_value;
+        layout (location = 0) out vec4 color;
+
+        void main() {
+            color = vec4(v_value, 0.0, 0.0, 1.0);
+        }
+    ''')
+
+    green = ctx.shader_stage('fragment', '''
+        #version 410
+
+        layout (location = 0) in float v_value;
+        layout (location = 0) out vec4 color;
+
+        uniform float offset;
+
+        void main() {
+            color = vec4(0.0, v_value + offset, 0.0, 1.0);
+        }
+    ''')
+
+    return vertex, red, green
+
+
+def test_shader_stage(stages):
+    vertex, red, green = stages
+    assert vertex.stage == 'vertex'
+    assert red.stage == 'fragment'
+    assert 'in_vert' in vertex._attribute_locations
+    assert isinstance(green['offset'], moderngl.Uniform)
+
+
+def test_pipeline_render(ctx, stages, fullscreen_vao):
+    vertex, red, green = stages
+    red_pipeline = ctx.pipeline(vertex, red)
+    green_pipeline = ctx.pipeline(vertex, green)
+    assert red_pipeline['vertex'] is vertex
+    assert red_pipeline.glo > 0
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    vao = fullscreen_vao(red_pipeline)
+
+    vertex['scale'] = 0.5
+    green['offset'] = 0.5
+
+    fbo.clear()
+    vao.render()
+    assert fbo.read(components=3)[:3] == b'\x80\x00\x00'
+
+    fbo.clear()
+    vao.render(program=green_pipeline)
+    assert fbo.read(components=3)[:3] == b'\x00\xff\x00'
+
+    red_pipeline.release()
+    green_pipeline.release()
+
+
+def test_pipeline_errors(ctx, stages):
+    vertex, red, green = stages
+
+    with pytest.raises(ValueError):
+        ctx.pipeline(vertex, red, green)
+
+    with pytest.raises(ValueError):
+        ctx.shader_stage('compute', '')
+
+    pipeline = ctx.pipeline(red)
+    with pytest.raises(moderngl.Error):
+        ctx.vertex_array(pipeline, [])
+
+
+def test_pipeline_keeps_released_stages(ctx, stages, fullscreen_vao):
+    vertex, red, green = stages
+    pipeline = ctx.pipeline(vertex, red)
+    vertex['scale'] = 1.0
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    vao = fullscreen_vao(pipeline)
+
+    # the programs are deleted when the pipeline is released
+    vertex.release()
+    red.release()
+
+    fbo.clear()
+    vao.render()
+    assert fbo.read(components=3)[:3] == b'\xff\x00\x00'
+    pipeline.release()
@@ -0,0 +1,113 @@
+import struct
+
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def program(ctx):
+    return ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec2 in_vert;
+
+            void main() {
+                gl_Position = vec4(in_vert, 0.0, 1.0);
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            out vec4 color;
+
+            void main() {
+                color = vec4(1.0);
+            }
+        ''',
+    )
+
+
+@pytest.fixture
+def points(ctx):
+    points = [(-1.0 + (x + 0.5) / 2.0, -1.0 + (y + 0.5) / 2.0) for y in range(2) for x in range(4)]
+    return ctx.buffer(np.array(points, dtype='f4'))
+
+
+def lit_pixels(fbo):
+    data = np.frombuffer(fbo.read(components=1), dtype='u1').reshape(4, 4)
+    return {(x, y) for y, x in zip(*np.nonzero(data))}
+
+
+def test_pack_draw_commands():
+    commands = moderngl.pack_draw_commands(np.array([3, 6], dtype='i4'), first=np.array([0, 3], dtype='i4'))
+    assert commands == struct.pack('8i', 3, 1, 0, 0, 6, 1, 3, 0)
+
+    commands = moderngl.pack_draw_commands(np.array([3], dtype='i4'), base_vertex=4, base_instance=2, indexed=True)
+    assert commands == struct.pack('5i', 3, 1, 0, 4, 2)
+
+    with pytest.raises(moderngl.Error):
+        moderngl.pack_draw_commands(np.array([3], dtype='i4'), base_vertex=4)
+
+    with pytest.raises(moderngl.Error):
+        moderngl.pack_draw_commands(np.array([3], dtype='i4'), first=np.array([0, 1], dtype='i4'))
+
+
+def test_render_indirect_arrays(ctx, program, points):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    vao = ctx.vertex_array(program, [(points, '2f', 'in_vert')])
+
+    commands = moderngl.pack_draw_commands(np.array([1, 1, 1], dtype='i4'), first=np.array([0, 3, 5], dtype='i4'))
+    indirect = ctx.buffer(commands)
+
+    # the command stride for non-indexed draws is 16 bytes
+    fbo.clear()
+    vao.render_indirect(indirect, moderngl.POINTS)
+    assert lit_pixels(fbo) == {(0, 0), (3, 0), (1, 1)}
+
+    fbo.clear()
+    vao.render_indirect(indirect, moderngl.POINTS, count=1, first=1)
+    assert lit_pixels(fbo) == {(3, 0)}
+
+
+def test_render_indirect_elements(ctx, program, points):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    ibo = ctx.buffer(np.array([0, 1, 2, 3], dtype='i4'))
+    vao = ctx.vertex_array(program, [(points, '2f', 'in_vert')], index_buffer=ibo)
+
+    commands = moderngl.pack_draw_commands(
+        np.array([1, 2], dtype='i4'),
+        first=np.array([0, 2], dtype='i4'),
+        base_vertex=np.array([0, 4], dtype='i4'),
+        indexed=True,
+    )
+    indirect = ctx.buffer(commands)
+
+    fbo.clear()
+    vao.render_indirect(indirect, moderngl.POINTS)
+    assert lit_pixels(fbo) == {(0, 0), (2, 1), (3, 1)}
+
+
+def test_render_indirect_count_buffer(ctx, program, points):
+    if ctx.version_code < 460 and 'GL_ARB_indirect_parameters' not in ctx.extensions:
+        pytest.skip('indirect count drawing is not supported')
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    vao = ctx.vertex_array(program, [(points, '2f', 'in_vert')])
+
+    commands = moderngl.pack_draw_commands(np.array([1, 1, 1, 1], dtype='i4'), first=np.array([0, 1, 2, 3], dtype='i4'))
+    indirect = ctx.buffer(commands)
+    count_buffer = ctx.buffer(struct.pack('2i', 0, 2))
+
+    fbo.clear()
+    vao.render_indirect(indirect, moderngl.POINTS, count_buffer=count_buffer, count_offset=4)
+    assert lit_pixels(fbo) == {(0, 0), (1, 0)}
+
+    count_buffer.write(struct.pack('i', 10), offset=4)
+    fbo.clear()
+    vao.render_indirect(indirect, moderngl.POINTS, count_buffer=count_buffer, count_offset=4, max_count=3)
+    assert lit_pixels(fbo) == {(0, 0), (1, 0), (2, 0)}
@@ -0,0 +1,91 @@
+import struct
+
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def program(ctx):
+    return ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec2 in_vert;
+
+            void main() {
+                gl_Position = vec4(in_vert, 0.0, 1.0);
+                gl_PointSize = 1.0;
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            out vec4 color;
+
+            void main() {
+                color = vec4(1.0);
+            }
+        ''',
+    )
+
+
+def pixel_center(x, y):
+    return -1.0 + (x + 0.5) / 2.0, -1.0 + (y + 0.5) / 2.0
+
+
+def lit_pixels(fbo):
+    data = np.frombuffer(fbo.read(components=1), dtype='u1').reshape(4, 4)
+    return {(x, y) for y, x in zip(*np.nonzero(data))}
+
+
+def test_render_multi_arrays(ctx, program):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+
+    points = [pixel_center(x, 0) for x in range(4)]
+    vbo = ctx.buffer(np.array(points, dtype='f4'))
+    vao = ctx.vertex_array(program, [(vbo, '2f', 'in_vert')])
+
+    fbo.clear()
+    vao.render_multi(np.array([0, 3], dtype='i4'), np.array([1, 1], dtype='i4'), mode=moderngl.POINTS)
+    assert lit_pixels(fbo) == {(0, 0), (3, 0)}
+
+    with pytest.raises(moderngl.Error):
+        vao.render_multi(np.array([0], dtype='i4'), np.array([1], dtype='i4'), np.array([0], dtype='i4'))
+
+
+def test_render_multi_elements(ctx, program):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+
+    points = [pixel_center(x, y) for y in range(2) for x in range(4)]
+    vbo = ctx.buffer(np.array(points, dtype='f4'))
+    ibo = ctx.buffer(np.array([0, 1, 2, 3], dtype='i4'))
+    vao = ctx.vertex_array(program, [(vbo, '2f', 'in_vert')], index_buffer=ibo)
+
+    fbo.clear()
+    vao.render_multi(struct.pack('2i', 1, 2), struct.pack('2i', 1, 2), mode=moderngl.POINTS)
+    assert lit_pixels(fbo) == {(1, 0), (2, 0), (3, 0)}
+
+    fbo.clear()
+    firsts = np.array([0, 0], dtype='i4')
+    counts = np.array([1, 1], dtype='i4')
+    vao.render_multi(firsts, counts, np.array([0, 5], dtype='i4'), mode=moderngl.POINTS)
+    assert lit_pixels(fbo) == {(0, 0), (1, 1)}
+
+
+def test_render_multi_errors(ctx, program):
+    vbo = ctx.buffer(reserve=64)
+    vao = ctx.vertex_array(program, [(vbo, '2f', 'in_vert')])
+
+    with pytest.raises(moderngl.Error):
+        vao.render_multi(np.array([0, 1], dtype='i4'), np.array([1], dtype='i4'))
+
+    with pytest.raises(moderngl.Error):
+        vao.render_multi(np.array([0.0], dtype='f4'), np.array([1], dtype='i4'))
+
+    with pytest.raises(moderngl.Error):
+        vao.render_multi(np.array([0], dtype='i8'), np.array([1], dtype='i8'))
+
+    vao.render_multi(np.array([], dtype='i4'), np.array([], dtype='i4'))
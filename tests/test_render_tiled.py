@@ -0,0 +1,92 @@
+import io
+import struct
+
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def scene(ctx, fullscreen_vao):
+    program = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            uniform mat4 tile;
+
+            in vec2 in_vert;
+            out vec2 v_vert;
+
+            void main() {
+                v_vert = in_vert;
+                gl_Position = tile * vec4(in_vert, 0.0, 1.0);
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            uniform vec2 size;
+
+            in vec2 v_vert;
+            out vec4 color;
+
+            void main() {
+                // the pixel of the whole image, not the one of the tile
+                vec2 pixel = floor((v_vert * 0.5 + 0.5) * size);
+                color = vec4(mod(pixel, 256.0) / 255.0, 1.0, 1.0);
+            }
+        ''',
+    )
+    vao = fullscreen_vao(program)
+
+    def render(fbo, viewport, matrix):
+        fbo.clear()
+        program['tile'].write(struct.pack('16f', *matrix))
+        vao.render()
+
+    return program, render
+
+
+def expected_image(width, height):
+    y, x = np.mgrid[0:height, 0:width]
+    return np.stack([x % 256, y % 256, np.full_like(x, 255)], axis=-1).astype('u1')
+
+
+def test_render_tiled_buffer(ctx, scene):
+    program, render = scene
+    program['size'] = (37.0, 23.0)
+    image = np.zeros((23, 37, 3), dtype='u1')
+
+    tiles = []
+
+    def render_tile(fbo, viewport, matrix):
+        tiles.append(viewport)
+        render(fbo, viewport, matrix)
+
+    ctx.render_tiled((37, 23), render_tile, image, tile=(16, 8), buffers=2)
+
+    assert len(tiles) == 9
+    assert tiles[-1] == (32, 16, 5, 7)
+    np.testing.assert_array_equal(image, expected_image(37, 23))
+
+
+def test_render_tiled_file(ctx, scene):
+    program, render = scene
+    program['size'] = (20.0, 10.0)
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+
+    out = io.BytesIO(b'header')
+    out.seek(6)
+    ctx.render_tiled((20, 10), render, out, tile=(8, 8))
+
+    data = np.frombuffer(out.getvalue()[6:], dtype='u1').reshape(10, 20, 3)
+    np.testing.assert_array_equal(data, expected_image(20, 10))
+    assert ctx.fbo is fbo
+
+
+def test_render_tiled_errors(ctx, scene):
+    program, render = scene
+
+    with pytest.raises(moderngl.Error):
+        ctx.render_tiled((8, 8), render, bytearray(8 * 8 * 3 - 1))
@@ -0,0 +1,100 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def vao(ctx, fullscreen_vao):
+    program = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec2 in_vert;
+
+            void main() {
+                gl_Position = vec4(in_vert, 0.5, 1.0);
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            layout (location = 0) out vec4 color0;
+            layout (location = 1) out vec4 color1;
+
+            void main() {
+                color0 = vec4(1.0, 0.0, 0.0, 1.0);
+                color1 = vec4(0.0, 1.0, 0.0, 1.0);
+            }
+        ''',
+    )
+    return fullscreen_vao(program)
+
+
+def gbuffer(ctx, samples):
+    colors = [ctx.renderbuffer((4, 4), 4, samples=samples) for _ in range(2)]
+    return ctx.framebuffer(colors, ctx.depth_renderbuffer((4, 4), samples=samples))
+
+
+def read(fbo, attachment):
+    return np.frombuffer(fbo.read(components=4, attachment=attachment), dtype='u1').reshape(-1, 4)
+
+
+def test_resolve_all(ctx, vao):
+    samples = min(ctx.max_samples, 4)
+    src = gbuffer(ctx, samples)
+    dst = gbuffer(ctx, 0)
+
+    src.use()
+    src.clear()
+    ctx.enable(moderngl.DEPTH_TEST)
+    vao.render()
+    ctx.disable(moderngl.DEPTH_TEST)
+    dst.clear(depth=1.0)
+
+    ctx.resolve(dst, src)
+    np.testing.assert_array_equal(read(dst, 0), [[255, 0, 0, 255]] * 16)
+    np.testing.assert_array_equal(read(dst, 1), [[0, 255, 0, 255]] * 16)
+    depth = np.frombuffer(dst.read(components=1, attachment=-1, dtype='f4'), dtype='f4')
+    np.testing.assert_allclose(depth, [0.75] * 16, atol=1e-3)
+
+
+def test_resolve_selected(ctx, vao):
+    src = gbuffer(ctx, 0)
+    dst = gbuffer(ctx, 0)
+
+    src.use()
+    src.clear()
+    vao.render()
+    dst.clear()
+
+    # the scissor of the bound framebuffer does not limit the blit
+    src.scissor = (0, 0, 1, 1)
+    ctx.resolve(dst, src, attachments=[1], depth=False, filter='linear')
+    src.scissor = None
+
+    assert not read(dst, 0).any()
+    np.testing.assert_array_equal(read(dst, 1), [[0, 255, 0, 255]] * 16)
+
+    # the draw buffers of the destination are restored
+    dst.use()
+    dst.clear()
+    vao.render()
+    np.testing.assert_array_equal(read(dst, 0), [[255, 0, 0, 255]] * 16)
+
+
+def test_resolve_errors(ctx):
+    src = gbuffer(ctx, 0)
+    dst = ctx.simple_framebuffer((4, 4))
+
+    with pytest.raises(moderngl.Error):
+        ctx.resolve(dst, src)
+
+    with pytest.raises(moderngl.Error):
+        ctx.resolve(dst, src, attachments=[1])
+
+    with pytest.raises(moderngl.Error):
+        ctx.resolve(dst, src, filter='cubic')
+
+    if ctx.max_samples:
+        with pytest.raises(moderngl.Error):
+            ctx.resolve(ctx.simple_framebuffer((2, 2)), ctx.simple_framebuffer((4, 4), samples=min(ctx.max_samples, 4)))
@@ -0,0 +1,86 @@
+import pytest
+import moderngl
+
+VERTEX_SHADER = '''
+    #version 330
+
+    in vec2 in_vert;
+
+    void main() {
+        gl_Position = vec4(in_vert, 0.0, 1.0);
+    }
+'''
+
+FRAGMENT_SHADER = '''
+    #version 330
+
+    uniform float value;
+    out vec4 color;
+
+    void main() {
+        color = vec4(value * %s, 0.0, 0.0, 1.0);
+    }
+'''
+
+
+def test_shader_cache_shares_stages(ctx, fullscreen_vao):
+    ctx.clear_shader_cache()
+    assert ctx.shader_cache_stats == {'size': 0, 'hits': 0, 'misses': 0}
+
+    first = ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER % '1.0')
+    second = ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER % '0.5')
+    assert ctx.shader_cache_stats == {'size': 3, 'hits': 1, 'misses': 3}
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+
+    for program, expected in ((first, 255), (second, 128)):
+        program['value'] = 1.0
+        vao = fullscreen_vao(program)
+        fbo.clear()
+        vao.render()
+        assert fbo.read(components=1)[0] == expected
+
+    # shader objects are deleted with the last program using them
+    first.release()
+    assert ctx.shader_cache_stats['size'] == 2
+    third = ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER % '0.5')
+    assert ctx.shader_cache_stats == {'size': 2, 'hits': 3, 'misses': 3}
+    assert third.glo > 0
+
+    second.release()
+    third.release()
+    assert ctx.shader_cache_stats['size'] == 0
+
+    ctx.clear_shader_cache()
+    assert ctx.shader_cache_stats == {'size': 0, 'hits': 0, 'misses': 0}
+
+
+def test_shader_cache_includes(ctx):
+    ctx.clear_shader_cache()
+    ctx.includes['value'] = 'const float scale = 1.0;'
+    source = FRAGMENT_SHADER.replace('uniform float value;', '#include "value"\nuniform float value;') % 'scale'
+
+    program = ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=source)
+    assert ctx.shader_cache_stats['size'] == 2
+
+    # stages compiled from an outdated include are evicted
+    ctx.includes['value'] = 'const float scale = 0.5;'
+    assert ctx.shader_cache_stats['size'] == 1
+
+    # releasing the program skips the evicted entry
+    program.release()
+    assert ctx.shader_cache_stats['size'] == 0
+
+    ctx.includes.clear()
+    ctx.clear_shader_cache()
+
+
+def test_shader_cache_compile_error(ctx):
+    ctx.clear_shader_cache()
+
+    with pytest.raises(moderngl.Error):
+        ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER % 'undefined')
+
+    # the stages compiled before the error are not kept
+    assert ctx.shader_cache_stats == {'size': 0, 'hits': 0, 'misses': 2}
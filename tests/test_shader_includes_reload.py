@@ -0,0 +1,155 @@
+import pytest
+import moderngl
+
+VERTEX_SHADER = '''
+    #version 330
+
+    in vec2 in_vert;
+
+    void main() {
+        gl_Position = vec4(in_vert, 0.0, 1.0);
+    }
+'''
+
+FRAGMENT_SHADER = '''
+    #version 330
+
+    #include "color"
+
+    out vec4 color;
+
+    void main() {
+        color = vec4(get_color(), 1.0);
+    }
+'''
+
+
+@pytest.fixture
+def includes(ctx):
+    yield ctx.includes
+    ctx.auto_reload = False
+    ctx.includes.clear()
+
+
+def test_nested_includes(ctx, includes):
+    includes['common'] = 'const float HALF = 0.5;'
+    includes['color'] = '''
+        #include "common"
+        #include "common"
+        vec3 get_color() { return vec3(HALF, 0.0, 0.0); }
+    '''
+
+    source, names = ctx.mglo.preprocess(FRAGMENT_SHADER)
+    assert names == ('color', 'common')
+    assert source.count('const float HALF') == 1
+    assert '#include' not in source
+    assert ctx.mglo.preprocess(FRAGMENT_SHADER)[0] is source
+
+    program = ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER)
+    assert program.glo > 0
+    program.release()
+
+
+def test_missing_include(ctx, includes):
+    with pytest.raises(KeyError):
+        ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER)
+
+
+def test_include_error_legend(ctx, includes):
+    includes['color'] = 'vec3 get_color() { return undefined_value; }'
+
+    with pytest.raises(moderngl.Error) as error:
+        ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER)
+
+    assert '1: color' in str(error.value)
+
+
+def test_reload_programs(ctx, includes, fullscreen_vao):
+    includes['color'] = 'vec3 get_color() { return vec3(1.0, 0.0, 0.0); }'
+    program = ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER)
+    unrelated = ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER.replace('#include "color"', 'vec3 get_color() { return vec3(1.0); }'))
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    vao = fullscreen_vao(program)
+
+    fbo.clear()
+    vao.render()
+    assert fbo.read(components=3)[:3] == b'\xff\x00\x00'
+
+    includes['color'] = 'vec3 get_color() { return vec3(0.0, 1.0, 0.0); }'
+    assert ctx.stale_programs == (program,)
+    assert ctx.reload_programs() == 1
+    assert ctx.stale_programs == ()
+
+    fbo.clear()
+    vao.render()
+    assert fbo.read(components=3)[:3] == b'\x00\xff\x00'
+    unrelated.release()
+
+
+def test_auto_reload(ctx, includes):
+    includes['color'] = 'vec3 get_color() { return vec3(1.0, 0.0, 0.0); }'
+    program = ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER)
+    glo = program.glo
+
+    ctx.auto_reload = True
+    includes['color'] = 'vec3 get_color() { return vec3(0.0, 0.0, 1.0); }'
+    assert program.glo != glo
+    assert ctx.stale_programs == ()
+    program.release()
+
+
+def test_reload_keeps_members(ctx, includes, fullscreen_vao):
+    includes['color'] = 'uniform float red; vec3 get_color() { return vec3(red, 0.0, 0.0); }'
+    program = ctx.program(vertex_shader=VERTEX_SHADER, fragment_shader=FRAGMENT_SHADER)
+    red = program['red']
+    red.extra = 'kept'
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    vao = fullscreen_vao(program)
+
+    includes['color'] = 'uniform float red; vec3 get_color() { return vec3(red, 1.0, 0.0); }'
+    ctx.reload_programs()
+
+    # the uniform held before the reload writes to the new program
+    assert program['red'] is red and red.extra == 'kept'
+    red.value = 1.0
+    fbo.clear()
+    vao.render()
+    assert fbo.read(components=3)[:3] == b'\xff\xff\x00'
+    program.release()
+
+
+def test_reload_family_usage(ctx, includes, fullscreen_vao):
+    includes['color'] = 'vec3 get_color() { return vec3(1.0, 0.0, 0.0); }'
+    programs = ctx.program_family(
+        {'vertex_shader': VERTEX_SHADER, 'fragment_shader': FRAGMENT_SHADER},
+        {'GREEN': (0.0, 1.0)},
+    )
+    program = programs.get(GREEN=1.0)
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    vao = fullscreen_vao(program)
+
+    # the define is injected once the changed include uses it
+    includes['color'] = 'vec3 get_color() { return vec3(1.0, GREEN, 0.0); }'
+    assert ctx.reload_programs() == 1
+    fbo.clear()
+    vao.render()
+    assert fbo.read(components=3)[:3] == b'\xff\xff\x00'
+    programs.release()
+
+
+def test_include_cache_is_bounded(ctx, includes):
+    includes['color'] = 'vec3 get_color() { return vec3(1.0); }'
+    source = ctx.mglo.preprocess(FRAGMENT_SHADER)[0]
+
+    for i in range(300):
+        ctx.mglo.preprocess(FRAGMENT_SHADER + f'// {i}\n')
+
+    # the least recently used expansion was dropped and is expanded again
+    assert ctx.mglo.preprocess(FRAGMENT_SHADER)[0] is not source
+    assert ctx.mglo.preprocess(FRAGMENT_SHADER)[0] == source
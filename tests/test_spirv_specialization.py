@@ -0,0 +1,62 @@
+import struct
+
+import pytest
+from _moderngl import Spv, parse_spv_specialization_constants
+
+# Compute shader writing the VALUE (id 3), SCALE (id 7) and FLAG (id 9)
+# specialization constants to a storage buffer bound at 0.
+SPV = bytes.fromhex('''
+    0302230700000100000000001a0000000000000011000200010000000e0003000000000001000000
+    0f00050005000000010000006d61696e000000001000060001000000110000000100000001000000
+    0100000005000400010000006d61696e00000000050004000200000056414c554500000005000400
+    030000005343414c450000000500040004000000464c414700000000470004000200000001000000
+    03000000470004000300000001000000070000004700040004000000010000000900000047000300
+    05000000030000004800050005000000000000002300000000000000480005000500000001000000
+    23000000040000004800050005000000020000002300000008000000470004000600000022000000
+    00000000470004000600000021000000000000001300020007000000210003000800000007000000
+    15000400090000002000000000000000160003000a0000002000000014000200160000001e000500
+    05000000090000000a00000009000000200004000b0000000200000005000000200004000c000000
+    0200000009000000200004000d000000020000000a0000003b0004000b0000000600000002000000
+    150004000e00000020000000010000002b0004000e0000000f000000000000002b0004000e000000
+    10000000010000002b0004000e00000011000000020000002b000400090000001800000001000000
+    2b00040009000000190000000000000032000400090000000200000005000000320004000a000000
+    030000000000c03f3100030016000000040000003600050007000000010000000000000008000000
+    f800020012000000410005000c00000013000000060000000f0000003e0003001300000002000000
+    410005000d0000001400000006000000100000003e0003001400000003000000a900060009000000
+    17000000040000001800000019000000410005000c0000001500000006000000110000003e000300
+    1500000017000000fd00010038000100
+''')
+
+
+def test_spirv_specialization_parsing():
+    assert parse_spv_specialization_constants(SPV) == {
+        3: ('VALUE', Spv.UINT32, 5),
+        7: ('SCALE', Spv.FLOAT32, 1.5),
+        9: ('FLAG', Spv.BOOL, False),
+    }
+
+
+def test_spirv_specialization(ctx):
+    if 'GL_ARB_gl_spirv' not in ctx.extensions:
+        pytest.skip('SPIR-V not supported')
+
+    buf = ctx.buffer(reserve=12)
+    buf.bind_to_storage_buffer(0)
+
+    ctx.compute_shader(SPV).run()
+    assert struct.unpack('IfI', buf.read()) == (5, 1.5, 0)
+
+    specialized = ctx.compute_shader(SPV, specialization={3: 42, 7: 2, 9: True})
+    specialized.run()
+    assert struct.unpack('IfI', buf.read()) == (42, 2.0, 1)
+
+    assert ctx.compute_shader(SPV, specialization={7: 2, 9: True, 3: 42}) is specialized
+    assert ctx.compute_shader(SPV, specialization={3: 43}) is not specialized
+
+    specialized.release()
+    assert ctx.compute_shader(SPV, specialization={3: 42, 7: 2, 9: True}) is not specialized
+
+
+def test_spirv_specialization_unknown_constant(ctx):
+    with pytest.raises(KeyError):
+        ctx.compute_shader(SPV, specialization={1: 0})
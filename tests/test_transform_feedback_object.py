@@ -0,0 +1,151 @@
+import struct
+
+import numpy as np
+import pytest
+import moderngl
+
+
+draw_vertex_shader = '''
+    #version 330
+
+    in float in_value;
+    out float v_value;
+
+    void main() {
+        gl_Position = vec4(-0.75 + 0.5 * float(gl_VertexID), -0.75 + 0.5 * float(gl_InstanceID), 0.0, 1.0);
+        v_value = in_value;
+    }
+'''
+
+
+@pytest.fixture
+def scene(ctx):
+    if ctx.version_code < 400:
+        pytest.skip('transform feedback objects require OpenGL 4.0')
+
+    emit = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in float in_value;
+            out float out_value;
+
+            void main() {
+                out_value = in_value * 2.0;
+            }
+        ''',
+        varyings=['out_value'],
+    )
+    draw = ctx.program(
+        vertex_shader=draw_vertex_shader,
+        fragment_shader='''
+            #version 330
+
+            in float v_value;
+            out vec4 color;
+
+            void main() {
+                color = vec4(v_value / 8.0, 0.0, 0.0, 1.0);
+            }
+        ''',
+    )
+    return emit, draw
+
+
+def test_pause_resume(ctx, scene):
+    emit, _ = scene
+    vbo = ctx.buffer(np.array([1.0, 2.0, 3.0], dtype='f4'))
+    output = ctx.buffer(reserve=40)
+    vao = ctx.vertex_array(emit, [(vbo, 'f', 'in_value')])
+
+    feedback = ctx.transform_feedback([(output, 4)])
+    assert feedback.outputs == [output]
+    assert not feedback.active
+
+    vao.transform(feedback, moderngl.POINTS)
+    assert feedback.active
+    vao.transform(feedback, moderngl.POINTS, vertices=2, first=1)
+    feedback.end()
+    assert not feedback.active
+
+    # the second call appended after the first one
+    assert np.frombuffer(output.read(), dtype='f4')[1:6].tolist() == [2.0, 4.0, 6.0, 4.0, 6.0]
+
+    # a new capture starts at the beginning of the outputs again
+    vao.transform(feedback, moderngl.POINTS, vertices=1)
+    feedback.end()
+    assert np.frombuffer(output.read(), dtype='f4')[1:3].tolist() == [2.0, 4.0]
+    feedback.release()
+
+
+def test_render_feedback(ctx, scene):
+    emit, draw = scene
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+
+    vbo = ctx.buffer(np.array([1.0, 2.0, 3.0, 4.0], dtype='f4'))
+    output = ctx.buffer(reserve=64)
+    emit_vao = ctx.vertex_array(emit, [(vbo, 'f', 'in_value')])
+    draw_vao = ctx.vertex_array(draw, [(output, 'f', 'in_value')])
+
+    feedback = ctx.transform_feedback([output])
+
+    with pytest.raises(moderngl.Error):
+        draw_vao.render_feedback(feedback, moderngl.POINTS)
+
+    emit_vao.transform(feedback, moderngl.POINTS, vertices=3)
+
+    with pytest.raises(moderngl.Error):
+        draw_vao.render_feedback(feedback, moderngl.POINTS)
+
+    feedback.end()
+
+    # three vertices were captured, the count never leaves the GPU
+    fbo.clear()
+    draw_vao.render_feedback(feedback, moderngl.POINTS, instances=2)
+    data = np.frombuffer(fbo.read(components=1), dtype='u1').reshape(4, 4)
+    assert data[0].tolist() == [64, 128, 191, 0]
+    assert data[1].tolist() == [64, 128, 191, 0]
+    assert data[2].tolist() == [0, 0, 0, 0]
+
+    # another program with matching attribute locations draws the same capture
+    brighter = ctx.program(
+        vertex_shader=draw_vertex_shader,
+        fragment_shader='''
+            #version 330
+
+            in float v_value;
+            out vec4 color;
+
+            void main() {
+                color = vec4(v_value / 4.0, 0.0, 0.0, 1.0);
+            }
+        ''',
+    )
+    fbo.clear()
+    draw_vao.render_feedback(feedback, moderngl.POINTS, program=brighter)
+    data = np.frombuffer(fbo.read(components=1), dtype='u1').reshape(4, 4)
+    assert data[0].tolist() == [128, 255, 255, 0]
+
+
+def test_transform_feedback_errors(ctx, scene):
+    emit, _ = scene
+    vbo = ctx.buffer(reserve=16)
+    output = ctx.buffer(reserve=16)
+    vao = ctx.vertex_array(emit, [(vbo, 'f', 'in_value')])
+
+    with pytest.raises(moderngl.Error):
+        ctx.transform_feedback([(output, 2)])
+
+    with pytest.raises(moderngl.Error):
+        ctx.transform_feedback([(output, 0, 32)])
+
+    feedback = ctx.transform_feedback([output])
+    vao.transform(feedback, moderngl.POINTS)
+
+    # resuming requires the same primitive mode
+    with pytest.raises(moderngl.Error):
+        vao.transform(feedback, moderngl.LINES, vertices=2)
+
+    feedback.release()
+    feedback.release()
@@ -0,0 +1,153 @@
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def program(ctx):
+    if ctx.version_code < 400:
+        pytest.skip('transform feedback streams require OpenGL 4.0')
+
+    return ctx.program(
+        vertex_shader='''
+            #version 400
+
+            in float in_value;
+            out float v_value;
+
+            void main() {
+                v_value = in_value;
+            }
+        ''',
+        geometry_shader='''
+            #version 400
+
+            layout (points) in;
+            layout (points, max_vertices = 3) out;
+
+            in float v_value[];
+
+            layout (stream = 0) out float out_value;
+            layout (stream = 1) out float out_double;
+
+            void main() {
+                out_value = v_value[0];
+                EmitStreamVertex(0);
+
+                if (v_value[0] > 1.0) {
+                    out_double = v_value[0] * 2.0;
+                    EmitStreamVertex(1);
+                    EmitStreamVertex(1);
+                }
+            }
+        ''',
+        varyings=['out_value', 'gl_NextBuffer', 'out_double'],
+    )
+
+
+def test_stream_counters(ctx, program):
+    vbo = ctx.buffer(np.array([1.0, 2.0, 3.0], dtype='f4'))
+    first = ctx.buffer(reserve=64)
+    second = ctx.buffer(reserve=64)
+    vao = ctx.vertex_array(program, [(vbo, 'f', 'in_value')])
+
+    feedback = ctx.transform_feedback([first, second], streams=2)
+    assert feedback.streams == 2
+    assert feedback.primitives_written() == 0
+
+    vao.transform(feedback, moderngl.POINTS)
+
+    with pytest.raises(moderngl.Error):
+        feedback.primitives_written()
+
+    vao.transform(feedback, moderngl.POINTS, vertices=1, first=2)
+    feedback.end()
+
+    assert feedback.primitives_written(0, wait=True) == 4
+    assert feedback.primitives_written(1, wait=True) == 6
+    assert np.frombuffer(first.read(16), dtype='f4').tolist() == [1.0, 2.0, 3.0, 3.0]
+    assert np.frombuffer(second.read(24), dtype='f4').tolist() == [4.0, 4.0, 6.0, 6.0, 6.0, 6.0]
+
+    # the counters are available without blocking once the GPU is done
+    ctx.finish()
+    assert feedback.primitives_written(1) == 6
+
+    with pytest.raises(moderngl.Error):
+        feedback.primitives_written(2)
+
+
+def test_write_primitives_written(ctx, program):
+    if ctx.version_code < 440:
+        pytest.skip('query buffers require OpenGL 4.4')
+
+    vbo = ctx.buffer(np.array([1.0, 2.0, 3.0], dtype='f4'))
+    outputs = [ctx.buffer(reserve=64), ctx.buffer(reserve=64)]
+    vao = ctx.vertex_array(program, [(vbo, 'f', 'in_value')])
+    counters = ctx.buffer(reserve=8)
+
+    feedback = ctx.transform_feedback(outputs, streams=2)
+    vao.transform(feedback, moderngl.POINTS)
+    feedback.end()
+
+    feedback.write_primitives_written(counters, offset=0, stream=0)
+    feedback.write_primitives_written(counters, offset=4, stream=1)
+    assert np.frombuffer(counters.read(), dtype='u4').tolist() == [3, 4]
+
+
+def test_render_stream(ctx, program):
+    draw = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in float in_value;
+
+            void main() {
+                gl_Position = vec4(-0.75 + 0.5 * float(gl_VertexID), in_value / 16.0, 0.0, 1.0);
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            out vec4 color;
+
+            void main() {
+                color = vec4(1.0);
+            }
+        ''',
+    )
+
+    vbo = ctx.buffer(np.array([1.0, 2.0, 0.0], dtype='f4'))
+    outputs = [ctx.buffer(reserve=64), ctx.buffer(reserve=64)]
+    vao = ctx.vertex_array(program, [(vbo, 'f', 'in_value')])
+    draw_vao = ctx.vertex_array(draw, [(outputs[1], 'f', 'in_value')])
+
+    feedback = ctx.transform_feedback(outputs, streams=2)
+    vao.transform(feedback, moderngl.POINTS)
+    feedback.end()
+
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+    fbo.clear()
+    draw_vao.render_feedback(feedback, moderngl.POINTS, stream=1)
+    row = np.frombuffer(fbo.read(components=1), dtype='u1').reshape(4, 4)[2]
+    assert row.tolist() == [255, 255, 0, 0]
+
+
+def test_single_capture(ctx, program):
+    vbo = ctx.buffer(np.array([1.0], dtype='f4'))
+    outputs = [ctx.buffer(reserve=64), ctx.buffer(reserve=64)]
+    vao = ctx.vertex_array(program, [(vbo, 'f', 'in_value')])
+
+    first = ctx.transform_feedback(outputs, streams=2)
+    second = ctx.transform_feedback(outputs, streams=2)
+    vao.transform(first, moderngl.POINTS)
+
+    with pytest.raises(moderngl.Error):
+        vao.transform(second, moderngl.POINTS)
+
+    with pytest.raises(moderngl.Error):
+        vao.transform(outputs, moderngl.POINTS)
+
+    first.end()
+    vao.transform(second, moderngl.POINTS)
+    second.end()
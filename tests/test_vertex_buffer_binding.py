@@ -0,0 +1,157 @@
+import struct
+
+import numpy as np
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def program(ctx):
+    if ctx.version_code < 430:
+        pytest.skip('vertex buffer bindings require OpenGL 4.3')
+
+    return ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec2 in_vert;
+            in float in_value;
+            out float v_value;
+
+            void main() {
+                gl_Position = vec4(in_vert, 0.0, 1.0);
+                v_value = in_value;
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            in float v_value;
+            out vec4 color;
+
+            void main() {
+                color = vec4(v_value, 0.0, 0.0, 1.0);
+            }
+        ''',
+    )
+
+
+def pixel_center(x, y):
+    return -1.0 + (x + 0.5) / 2.0, -1.0 + (y + 0.5) / 2.0
+
+
+def lit_pixels(fbo):
+    data = np.frombuffer(fbo.read(components=1), dtype='u1').reshape(4, 4)
+    return {(x, y): int(data[y, x]) for y, x in zip(*np.nonzero(data))}
+
+
+def test_bind_vertex_buffer(ctx, program):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+
+    first = ctx.buffer(np.array([pixel_center(0, 0), pixel_center(1, 0)], dtype='f4'))
+    second = ctx.buffer(np.array([pixel_center(0, 1), pixel_center(1, 1), pixel_center(2, 1)], dtype='f4'))
+    values = ctx.buffer(np.array([1.0, 0.5, 1.0], dtype='f4'))
+    vao = ctx.vertex_array(program, [(first, '2f', 'in_vert'), (values, 'f', 'in_value')])
+    assert vao.vertices == 2
+
+    fbo.clear()
+    vao.render(moderngl.POINTS)
+    assert lit_pixels(fbo) == {(0, 0): 255, (1, 0): 128}
+
+    # the attribute formats are kept, only the buffer changes
+    vao.bind_vertex_buffer(0, second)
+    assert vao.vertices == 3
+
+    fbo.clear()
+    vao.render(moderngl.POINTS)
+    assert lit_pixels(fbo) == {(0, 1): 255, (1, 1): 128, (2, 1): 255}
+
+    vao.bind_vertex_buffer(0, second, offset=8)
+    vao.bind_vertex_buffer(1, values, offset=4)
+    assert vao.vertices == 2
+
+    fbo.clear()
+    vao.render(moderngl.POINTS)
+    assert lit_pixels(fbo) == {(1, 1): 128, (2, 1): 255}
+
+
+def test_bind_vertex_buffers(ctx, program):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+
+    interleaved = ctx.buffer(np.array([pixel_center(3, 3) + (1.0,), pixel_center(2, 2) + (0.5,)], dtype='f4'))
+    vbo = ctx.buffer(reserve=64)
+    vao = ctx.vertex_array(program, [(vbo, '2f', 'in_vert'), (vbo, 'f', 'in_value')])
+
+    vao.bind_vertex_buffers([(interleaved, 0, 12), (interleaved, 8, 12)])
+    assert vao.vertices == 2
+
+    fbo.clear()
+    vao.render(moderngl.POINTS)
+    assert lit_pixels(fbo) == {(3, 3): 255, (2, 2): 128}
+
+
+def test_bind_vertex_buffer_errors(ctx, program):
+    vbo = ctx.buffer(reserve=64)
+    vao = ctx.vertex_array(program, [(vbo, '2f', 'in_vert'), (vbo, 'f', 'in_value')])
+
+    with pytest.raises(moderngl.Error):
+        vao.bind_vertex_buffer(2, vbo)
+
+    with pytest.raises(moderngl.Error):
+        vao.bind_vertex_buffers([vbo, vbo], first=1)
+
+    with pytest.raises(moderngl.Error):
+        vao.bind_vertex_buffer(0, vbo, offset=-4)
+
+    vao.bind_vertex_buffers([vbo, (vbo, 16)])
+    assert vao.vertices == 8
+
+
+
+def test_bind_high_location(ctx, program):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+
+    high = ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec2 in_vert;
+            layout (location = 15) in float in_value;
+            out float v_value;
+
+            void main() {
+                gl_Position = vec4(in_vert, 0.0, 1.0);
+                v_value = in_value;
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            in float v_value;
+            out vec4 color;
+
+            void main() {
+                color = vec4(v_value, 0.0, 0.0, 1.0);
+            }
+        ''',
+    )
+
+    vertices = ctx.buffer(np.array([pixel_center(0, 0), pixel_center(3, 3)], dtype='f4'))
+    values = ctx.buffer(np.array([1.0, 0.5], dtype='f4'))
+    vao = ctx.vertex_array(high, [(vertices, '2f', 'in_vert')])
+
+    # binding 1 + 15 is out of range with 16 bindings, a free one is used
+    vao.bind(15, 'f', values, 'f')
+
+    fbo.clear()
+    vao.render(moderngl.POINTS)
+    assert lit_pixels(fbo) == {(0, 0): 255, (3, 3): 128}
+
+    # the content binding is not taken over
+    vao.bind_vertex_buffer(0, vertices, offset=8)
+    fbo.clear()
+    vao.render(moderngl.POINTS, vertices=1)
+    assert lit_pixels(fbo) == {(3, 3): 255}
@@ -0,0 +1,76 @@
+import struct
+
+import pytest
+import moderngl
+
+
+@pytest.fixture
+def program(ctx):
+    return ctx.program(
+        vertex_shader='''
+            #version 330
+
+            in vec2 in_vert;
+            in vec3 in_color;
+            out vec3 v_color;
+
+            void main() {
+                gl_Position = vec4(in_vert, 0.0, 1.0);
+                v_color = in_color;
+            }
+        ''',
+        fragment_shader='''
+            #version 330
+
+            in vec3 v_color;
+            out vec4 color;
+
+            void main() {
+                color = vec4(v_color, 1.0);
+            }
+        ''',
+    )
+
+
+def test_vertex_format_interned(ctx):
+    fmt = ctx.vertex_format('3f 3f 2f/v')
+    assert fmt is ctx.vertex_format('3f 3f 2f/v')
+    assert fmt == '3f 3f 2f/v'
+    assert hash(fmt) == hash('3f 3f 2f/v')
+    assert {fmt: 1}['3f 3f 2f/v'] == 1
+    assert (fmt.stride, fmt.divisor, fmt.attributes) == (32, 0, 3)
+
+    fmt = ctx.vertex_format('2f 4x 4f1/i')
+    assert (fmt.stride, fmt.divisor, fmt.attributes) == (16, 1, 2)
+
+    with pytest.raises(TypeError):
+        moderngl.VertexFormat('3f')
+
+    with pytest.raises(moderngl.Error):
+        ctx.vertex_format('3z')
+
+
+def test_vertex_format_in_vertex_array(ctx, program):
+    fbo = ctx.simple_framebuffer((4, 4))
+    fbo.use()
+
+    vbo = ctx.buffer(struct.pack('15f', -1.0, -1.0, 1.0, 0.0, 0.0, 3.0, -1.0, 1.0, 0.0, 0.0, -1.0, 3.0, 1.0, 0.0, 0.0))
+    fmt = ctx.vertex_format('2f 3f')
+    vao = ctx.vertex_array(program, [(vbo, fmt, 'in_vert', 'in_color')])
+    assert vao.vertices == 3
+
+    fbo.clear()
+    vao.render()
+    assert fbo.read(components=3)[:3] == b'\xff\x00\x00'
+
+
+def test_detect_format_memoized(ctx, program):
+    fmt = moderngl.detect_format(program, ('in_vert', 'in_color'))
+    assert fmt == '2f 3f'
+    assert fmt is moderngl.detect_format(program, ('in_vert', 'in_color'))
+    assert fmt is ctx.vertex_format('2f 3f')
+    assert moderngl.detect_format(program, ('in_color',)) == '3f'
+    assert moderngl.detect_format(program, ('in_vert', 'in_color'), mode='struct') == '2f 3f'
+
+    with pytest.raises(KeyError):
+        moderngl.detect_format(program, ('in_missing',))